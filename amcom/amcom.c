@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include "amcom.h"
+#include "amcom_parser.h"
 
 /// Start of packet character
 const uint8_t  AMCOM_SOP         = 0xA1;
@@ -17,13 +18,29 @@ static uint16_t AMCOM_UpdateCRC(uint8_t byte, uint16_t crc)
             ^ ((uint16_t)byte << 3));
 }
 
+uint16_t AMCOM_UpdateCRCBlock(uint16_t crc, const uint8_t* data, size_t dataSize) {
+    for (size_t i = 0; i < dataSize; ++i) {
+        crc = AMCOM_UpdateCRC(data[i], crc);
+    }
+    return crc;
+}
+
 void AMCOM_InitReceiver(AMCOM_Receiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext) {
     assert(receiver != NULL);
-    receiver->receivedPacketState = AMCOM_PACKET_STATE_EMPTY;
-    receiver->payloadCounter      = 0;
-    receiver->packetHandler       = packetHandlerCallback;
-    receiver->userContext         = userContext;
-    receiver->crc                 = AMCOM_INITIAL_CRC;
+    AMCOM_InitFrame(&receiver->frame);
+    receiver->packetHandler  = packetHandlerCallback;
+    receiver->userContext    = userContext;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+uint16_t AMCOM_CalculateCRC(uint8_t packetType, const void* payload, size_t payloadSize) {
+    uint16_t crc = AMCOM_INITIAL_CRC;
+    crc = AMCOM_UpdateCRC(packetType, crc);
+    crc = AMCOM_UpdateCRC((uint8_t)payloadSize, crc);
+    if (payload && payloadSize) {
+        crc = AMCOM_UpdateCRCBlock(crc, (const uint8_t*)payload, payloadSize);
+    }
+    return crc;
 }
 
 size_t AMCOM_Serialize(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer) {
@@ -36,16 +53,7 @@ size_t AMCOM_Serialize(uint8_t packetType, const void* payload, size_t payloadSi
     *p++ = packetType;
     *p++ = (uint8_t)payloadSize;
 
-    uint16_t crc = AMCOM_INITIAL_CRC;
-    crc = AMCOM_UpdateCRC(packetType, crc);
-    crc = AMCOM_UpdateCRC((uint8_t)payloadSize, crc);
-    if (payload && payloadSize) {
-        const uint8_t* data = (const uint8_t*)payload;
-        for (size_t i = 0; i < payloadSize; ++i) {
-            crc = AMCOM_UpdateCRC(data[i], crc);
-        }
-    }
-
+    uint16_t crc = AMCOM_CalculateCRC(packetType, payload, payloadSize);
     *p++ = (uint8_t)(crc & 0xFF);
     *p++ = (uint8_t)(crc >> 8);
 
@@ -57,72 +65,302 @@ size_t AMCOM_Serialize(uint8_t packetType, const void* payload, size_t payloadSi
     return (size_t)(p - destinationBuffer);
 }
 
-void AMCOM_Deserialize(AMCOM_Receiver* receiver, const void* data, size_t dataSize) {
-    assert(receiver && data);
-    const uint8_t* bytes = (const uint8_t*)data;
+/// Result of feeding a single byte to the receiver state machine
+typedef enum {
+    /// Byte was consumed, packet is not complete yet
+    AMCOM_BYTE_CONSUMED = 0,
+    /// Byte completed a packet with a valid CRC
+    AMCOM_BYTE_PACKET_READY,
+    /// Byte revealed that the buffered frame is invalid (bad length or CRC)
+    AMCOM_BYTE_FRAME_ERROR
+} AMCOM_ByteResult;
 
-    for (size_t i = 0; i < dataSize; ++i) {
-        uint8_t b = bytes[i];
-        switch (receiver->receivedPacketState) {
-
-        case AMCOM_PACKET_STATE_EMPTY:
-            if (b == AMCOM_SOP) {
-                receiver->receivedPacket.header.sop = b;
-                receiver->crc = AMCOM_INITIAL_CRC;
-                receiver->receivedPacketState = AMCOM_PACKET_STATE_GOT_SOP;
-                receiver->payloadCounter = 0;
-            }
-            break;
+void AMCOM_InitFrame(AMCOM_FrameState* frame) {
+    memset(frame, 0, sizeof(*frame));
+    frame->receivedPacketState = AMCOM_PACKET_STATE_EMPTY;
+    frame->crc                 = AMCOM_INITIAL_CRC;
+}
 
-        case AMCOM_PACKET_STATE_GOT_SOP:
-            receiver->receivedPacket.header.type = b;
-            receiver->crc = AMCOM_UpdateCRC(b, receiver->crc);
-            receiver->receivedPacketState = AMCOM_PACKET_STATE_GOT_TYPE;
-            break;
+void AMCOM_ResetFrame(AMCOM_FrameState* frame) {
+    frame->receivedPacketState = AMCOM_PACKET_STATE_EMPTY;
+    frame->payloadCounter      = 0;
+}
 
-        case AMCOM_PACKET_STATE_GOT_TYPE:
-            receiver->receivedPacket.header.length = b;
-            receiver->crc = AMCOM_UpdateCRC(b, receiver->crc);
-            if (b > AMCOM_MAX_PAYLOAD_SIZE) {
-                receiver->receivedPacketState = AMCOM_PACKET_STATE_EMPTY;
-            } else {
-                receiver->receivedPacketState = AMCOM_PACKET_STATE_GOT_LENGTH;
-            }
-            break;
+/**
+ * Feeds a single byte to the receiver state machine.
+ *
+ * Every byte that belongs to the frame is stored in the raw (wire-order) image of the received packet at
+ * the index equal to its position in the frame. Thanks to that the buffered bytes can be rescanned in place
+ * after a frame error (see @ref AMCOM_Rescan).
+ */
+static AMCOM_ByteResult AMCOM_ProcessByte(AMCOM_Parser* parser, uint8_t b) {
+    AMCOM_FrameState* frame = parser->frame;
+    AMCOM_Packet* packet = parser->packet;
+    uint8_t* raw = (uint8_t*)packet;
 
-        case AMCOM_PACKET_STATE_GOT_LENGTH:
-            receiver->receivedPacket.header.crc = b;
-            receiver->receivedPacketState = AMCOM_PACKET_STATE_GOT_CRC_LO;
-            break;
+    switch (frame->receivedPacketState) {
 
-        case AMCOM_PACKET_STATE_GOT_CRC_LO:
-            receiver->receivedPacket.header.crc |= (uint16_t)b << 8;
-            receiver->receivedPacketState =
-                (receiver->receivedPacket.header.length > 0)
-                  ? AMCOM_PACKET_STATE_GETTING_PAYLOAD
-                  : AMCOM_PACKET_STATE_GOT_WHOLE_PACKET;
-            break;
+    case AMCOM_PACKET_STATE_EMPTY:
+        if (b == AMCOM_SOP) {
+            raw[0] = b;
+            frame->crc = AMCOM_INITIAL_CRC;
+            frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_SOP;
+            frame->payloadCounter = 0;
+        } else {
+            parser->stats->bytesDiscarded++;
+        }
+        break;
+
+    case AMCOM_PACKET_STATE_GOT_SOP:
+        raw[1] = b;
+        frame->crc = AMCOM_UpdateCRC(b, frame->crc);
+        frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_TYPE;
+        break;
+
+    case AMCOM_PACKET_STATE_GOT_TYPE:
+        raw[2] = b;
+        frame->crc = AMCOM_UpdateCRC(b, frame->crc);
+        // the LENGTH byte is buffered even if it is invalid, so it can be rescanned as well
+        frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_LENGTH;
+        if (b > AMCOM_MAX_PAYLOAD_SIZE) {
+            parser->stats->lengthErrors++;
+            return AMCOM_BYTE_FRAME_ERROR;
+        }
+        break;
+
+    case AMCOM_PACKET_STATE_GOT_LENGTH:
+        raw[3] = b;
+        frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_CRC_LO;
+        break;
+
+    case AMCOM_PACKET_STATE_GOT_CRC_LO:
+        raw[4] = b;
+        frame->receivedPacketState =
+            (packet->header.length > 0)
+              ? AMCOM_PACKET_STATE_GETTING_PAYLOAD
+              : AMCOM_PACKET_STATE_GOT_WHOLE_PACKET;
+        break;
 
-        case AMCOM_PACKET_STATE_GETTING_PAYLOAD:
-            receiver->receivedPacket.payload[receiver->payloadCounter++] = b;
-            receiver->crc = AMCOM_UpdateCRC(b, receiver->crc);
-            if (receiver->payloadCounter >= receiver->receivedPacket.header.length) {
-                receiver->receivedPacketState = AMCOM_PACKET_STATE_GOT_WHOLE_PACKET;
+    case AMCOM_PACKET_STATE_GETTING_PAYLOAD:
+        packet->payload[frame->payloadCounter++] = b;
+        frame->crc = AMCOM_UpdateCRC(b, frame->crc);
+        if (frame->payloadCounter >= packet->header.length) {
+            frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_WHOLE_PACKET;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    if (frame->receivedPacketState == AMCOM_PACKET_STATE_GOT_WHOLE_PACKET) {
+        uint16_t crc = (uint16_t)(raw[3] | ((uint16_t)raw[4] << 8));
+        if (frame->crc != crc) {
+            parser->stats->crcErrors++;
+            return AMCOM_BYTE_FRAME_ERROR;
+        }
+        uint8_t length = packet->header.length;
+        parser->stats->packetsOk++;
+        parser->stats->payloadBytes += length;
+        if (length > parser->stats->maxPayloadSize) {
+            parser->stats->maxPayloadSize = length;
+        }
+        return AMCOM_BYTE_PACKET_READY;
+    }
+    return AMCOM_BYTE_CONSUMED;
+}
+
+/** Returns the number of frame bytes that are currently buffered in the receiver. */
+static size_t AMCOM_BufferedBytes(const AMCOM_FrameState* frame) {
+    switch (frame->receivedPacketState) {
+    case AMCOM_PACKET_STATE_GOT_SOP:          return 1;
+    case AMCOM_PACKET_STATE_GOT_TYPE:         return 2;
+    case AMCOM_PACKET_STATE_GOT_LENGTH:       return 3;
+    case AMCOM_PACKET_STATE_GOT_CRC_LO:       return 4;
+    case AMCOM_PACKET_STATE_GETTING_PAYLOAD:
+    case AMCOM_PACKET_STATE_GOT_WHOLE_PACKET: return sizeof(AMCOM_PacketHeader) + frame->payloadCounter;
+    default:                                  return 0;
+    }
+}
+
+/** Delivers the packet and prepares the parser for the next one. */
+static void AMCOM_DispatchPacket(AMCOM_Parser* parser, const uint8_t* history, size_t historySize) {
+    AMCOM_ResetFrame(parser->frame);
+    parser->packetReady = true;
+    parser->packet = parser->dispatch(parser->owner, parser->packet, history, historySize);
+}
+
+/**
+ * Rescans the bytes of a rejected frame.
+ *
+ * The frame image is used as the history buffer: whenever a SOP is found, the remaining history is moved
+ * to the front of the image and fed to the state machine again. Each byte is then written back to the very
+ * position it is read from, so the unread part of the history is never overwritten. Valid packets that
+ * started inside the rejected frame are dispatched as usual; a packet that is still incomplete when the
+ * history runs out is continued with the next incoming bytes. In the single packet mode the rescan stops
+ * after a dispatched packet and the unread history is kept in the frame state for the next call.
+ *
+ * @param parser pointer to the parser
+ * @param pos position of the first byte to rescan
+ * @param end number of bytes of the rejected frame that are buffered
+ */
+static void AMCOM_Rescan(AMCOM_Parser* parser, size_t pos, size_t end) {
+    while (pos < end) {
+        uint8_t* raw = (uint8_t*)parser->packet;
+        if (!raw) {
+            // the dispatch hook dropped the history
+            parser->stats->bytesDiscarded += (uint32_t)(end - pos);
+            return;
+        }
+
+        if (parser->frame->receivedPacketState == AMCOM_PACKET_STATE_EMPTY) {
+            const uint8_t* sop = (const uint8_t*)memchr(raw + pos, AMCOM_SOP, end - pos);
+            if (!sop) {
+                parser->stats->bytesDiscarded += (uint32_t)(end - pos);
+                return;
             }
-            break;
+            parser->stats->bytesDiscarded += (uint32_t)(sop - (raw + pos));
+            end -= (size_t)(sop - raw);
+            memmove(raw, sop, end);
+            AMCOM_ProcessByte(parser, raw[0]);
+            pos = 1;
+            continue;
+        }
 
+        switch (AMCOM_ProcessByte(parser, raw[pos++])) {
+        case AMCOM_BYTE_PACKET_READY:
+            AMCOM_DispatchPacket(parser, raw + pos, end - pos);
+            if (parser->singlePacket && pos < end) {
+                parser->frame->historyPos = (uint8_t)pos;
+                parser->frame->historyEnd = (uint8_t)end;
+                return;
+            }
+            break;
+        case AMCOM_BYTE_FRAME_ERROR:
+            parser->stats->bytesDiscarded++;
+            AMCOM_ResetFrame(parser->frame);
+            pos = 1;
+            break;
         default:
             break;
         }
+    }
+}
 
-        if (receiver->receivedPacketState == AMCOM_PACKET_STATE_GOT_WHOLE_PACKET) {
-            if (receiver->crc == receiver->receivedPacket.header.crc) {
-                if (receiver->packetHandler) {
-                    receiver->packetHandler(&receiver->receivedPacket, receiver->userContext);
-                }
+/** Rejects the buffered frame: drops its (false) SOP and rescans the bytes after it. */
+static void AMCOM_RejectFrame(AMCOM_Parser* parser) {
+    size_t end = AMCOM_BufferedBytes(parser->frame);
+    parser->stats->bytesDiscarded++;
+    AMCOM_ResetFrame(parser->frame);
+    AMCOM_Rescan(parser, 1, end);
+}
+
+size_t AMCOM_ParseChunk(AMCOM_Parser* parser, const uint8_t* bytes, size_t dataSize) {
+    AMCOM_FrameState* frame = parser->frame;
+    size_t i = 0;
+
+    parser->packetReady = false;
+    if (frame->historyPos < frame->historyEnd) {
+        // finish the rescan interrupted by a packet returned in the single packet mode
+        size_t pos = frame->historyPos;
+        size_t end = frame->historyEnd;
+        frame->historyPos = frame->historyEnd = 0;
+        AMCOM_Rescan(parser, pos, end);
+        if (parser->singlePacket && parser->packetReady) {
+            return 0;
+        }
+    }
+
+    for (; i < dataSize; ++i) {
+        if (frame->receivedPacketState == AMCOM_PACKET_STATE_EMPTY) {
+            // skip runs of non-SOP bytes in bulk (memchr is vectorised by glibc and word-at-a-time in newlib)
+            const uint8_t* sop = (const uint8_t*)memchr(&bytes[i], AMCOM_SOP, dataSize - i);
+            size_t skipped = sop ? (size_t)(sop - &bytes[i]) : (dataSize - i);
+            parser->stats->bytesDiscarded += (uint32_t)skipped;
+            i += skipped;
+            if (!sop) {
+                break;
             }
-            receiver->receivedPacketState = AMCOM_PACKET_STATE_EMPTY;
-            receiver->payloadCounter = 0;
+            if (!parser->packet && !(parser->packet = parser->acquire(parser->owner))) {
+                // no buffer for the frame: drop its SOP, the rest is skipped while hunting for the next one
+                parser->stats->bytesDiscarded++;
+                continue;
+            }
+        }
+
+        switch (AMCOM_ProcessByte(parser, bytes[i])) {
+        case AMCOM_BYTE_PACKET_READY:
+            AMCOM_DispatchPacket(parser, NULL, 0);
+            break;
+        case AMCOM_BYTE_FRAME_ERROR:
+            AMCOM_RejectFrame(parser);
+            break;
+        default:
+            break;
+        }
+        if (parser->singlePacket && parser->packetReady) {
+            i++;
+            break;
         }
     }
+
+    parser->stats->bytesReceived += (uint32_t)i;
+    return i;
+}
+
+/** Dispatch hook of the receiver with an embedded packet buffer. */
+static AMCOM_Packet* AMCOM_ReceiverDispatch(void* owner, AMCOM_Packet* packet, const uint8_t* history, size_t historySize) {
+    (void)history;
+    (void)historySize;
+    AMCOM_Receiver* receiver = (AMCOM_Receiver*)owner;
+    if (receiver->packetHandler) {
+        receiver->packetHandler(packet, receiver->userContext);
+    }
+    return packet;
+}
+
+void AMCOM_Deserialize(AMCOM_Receiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    AMCOM_Parser parser = {
+        &receiver->frame, &receiver->stats, &receiver->receivedPacket, NULL, AMCOM_ReceiverDispatch, receiver,
+        false, false
+    };
+    AMCOM_ParseChunk(&parser, (const uint8_t*)data, dataSize);
+}
+
+/** Dispatch hook of the pull mode: the packet is only marked as ready. */
+static AMCOM_Packet* AMCOM_PullDispatch(void* owner, AMCOM_Packet* packet, const uint8_t* history, size_t historySize) {
+    (void)owner;
+    (void)history;
+    (void)historySize;
+    return packet;
+}
+
+const AMCOM_Packet* AMCOM_Parse(AMCOM_Receiver* receiver, const void* data, size_t dataSize, size_t* consumed) {
+    assert(receiver && (data || dataSize == 0) && consumed);
+    AMCOM_Parser parser = {
+        &receiver->frame, &receiver->stats, &receiver->receivedPacket, NULL, AMCOM_PullDispatch, receiver,
+        true, false
+    };
+    *consumed = AMCOM_ParseChunk(&parser, (const uint8_t*)data, dataSize);
+    return parser.packetReady ? &receiver->receivedPacket : NULL;
+}
+
+void AMCOM_GetStats(const AMCOM_Receiver* receiver, AMCOM_ReceiverStats* stats) {
+    assert(receiver && stats);
+    *stats = receiver->stats;
+    stats->avgPayloadSize = (stats->packetsOk > 0)
+        ? (uint8_t)(stats->payloadBytes / stats->packetsOk)
+        : 0;
+}
+
+void AMCOM_ResetStats(AMCOM_Receiver* receiver) {
+    assert(receiver != NULL);
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+size_t AMCOM_SerializeStats(const AMCOM_Receiver* receiver, uint8_t* destinationBuffer) {
+    AMCOM_ReceiverStats stats;
+    AMCOM_GetStats(receiver, &stats);
+    return AMCOM_Serialize(AMCOM_STATS_PACKET_TYPE, &stats, sizeof(stats), destinationBuffer);
 }
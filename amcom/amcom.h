@@ -70,6 +70,37 @@ typedef struct AMPACKED {
 // static assertion to check that the packet structure is indeed packed
 static_assert(205 == sizeof(AMCOM_Packet), "205 != sizeof(AMCOM_Packet)");
 
+/**
+ * Packet types reserved for the built-in packets of the AMCOM library and its extensions.
+ * Applications should use types below @ref AMCOM_RESERVED_PACKET_TYPES_START for their own packets.
+ */
+enum {
+	/// First reserved packet type
+	AMCOM_RESERVED_PACKET_TYPES_START = 0xF0,
+	/// Data of the first virtual channel; channel N uses type 0xF0 + N, N < 6 (see amcom_mux.h)
+	AMCOM_MUX_DATA_PACKET_TYPE = 0xF0,
+	/// Credit update of the link flow control (see amcom_flow.h)
+	AMCOM_FLOW_CREDIT_PACKET_TYPE = 0xF6,
+	/// Credit update of the channel multiplexer (see amcom_mux.h)
+	AMCOM_MUX_CREDIT_PACKET_TYPE = 0xF7,
+	/// Link speed negotiation (see amcom_speed.h)
+	AMCOM_SPEED_PACKET_TYPE = 0xF8,
+	/// Request of the RPC layer (see amcom_rpc.h)
+	AMCOM_RPC_REQUEST_PACKET_TYPE = 0xF9,
+	/// Response of the RPC layer (see amcom_rpc.h)
+	AMCOM_RPC_RESPONSE_PACKET_TYPE = 0xFA,
+	/// Packet with a compressed payload (see amcom_compress.h)
+	AMCOM_COMPRESSED_PACKET_TYPE = 0xFB,
+	/// Data packet of the reliable transport (see amcom_reliable.h)
+	AMCOM_RELIABLE_DATA_PACKET_TYPE = 0xFC,
+	/// Acknowledgement of the reliable transport (see amcom_reliable.h)
+	AMCOM_RELIABLE_ACK_PACKET_TYPE = 0xFD,
+	/// Fragment of a message larger than a single packet (see amcom_fragment.h)
+	AMCOM_FRAGMENT_PACKET_TYPE = 0xFE,
+	/// Receiver statistics report (see @ref AMCOM_SerializeStats)
+	AMCOM_STATS_PACKET_TYPE = 0xFF
+};
+
 /**
  * Type describing a callback function that will be called when a packet is received.
  *
@@ -78,6 +109,32 @@ static_assert(205 == sizeof(AMCOM_Packet), "205 != sizeof(AMCOM_Packet)");
  */
 typedef void (*AMCOM_PacketHandler)(const AMCOM_Packet* packet, void* userContext);
 
+/**
+ * Type describing a callback function that will be called when a message of a higher protocol layer
+ * (e.g. a reassembled or reliably delivered message) is received.
+ *
+ * @param packetType type of the message
+ * @param message message data
+ * @param messageSize number of bytes in the message
+ * @param userContext user defined context associated with the layer instance
+ */
+typedef void (*AMCOM_MessageHandler)(uint8_t packetType, const uint8_t* message, size_t messageSize, void* userContext);
+
+/**
+ * Type describing a function that writes bytes to the link (e.g. USART_WriteData).
+ *
+ * @param data pointer to the data to write
+ * @param dataSize number of bytes to write
+ * @param userContext user defined context
+ * @return number of bytes written
+ */
+typedef size_t (*AMCOM_WriteFunction)(const void* data, size_t dataSize, void* userContext);
+
+/**
+ * Type describing a function that returns the current time in milliseconds (e.g. msGetTicks).
+ */
+typedef uint64_t (*AMCOM_TickFunction)(void);
+
 /** Possible states of the packet reception. */
 typedef enum {
 	/// Packet was not started yet
@@ -96,19 +153,56 @@ typedef enum {
 	AMCOM_PACKET_STATE_GOT_WHOLE_PACKET = 7
 } AMCOM_PacketState;
 
-/** Structure describing the AM packet receiver */
+/** Link statistics gathered by the packet receiver */
+typedef struct AMPACKED {
+	/// Number of bytes fed to the receiver
+	uint32_t bytesReceived;
+	/// Number of bytes discarded while hunting for SOP (including SOPs of rejected frames)
+	uint32_t bytesDiscarded;
+	/// Number of valid packets received
+	uint32_t packetsOk;
+	/// Number of frames rejected because of a CRC mismatch
+	uint32_t crcErrors;
+	/// Number of frames rejected because of a LENGTH above @ref AMCOM_MAX_PAYLOAD_SIZE
+	uint32_t lengthErrors;
+	/// Total number of payload bytes in valid packets (goodput)
+	uint32_t payloadBytes;
+	/// Largest payload size of a valid packet
+	uint8_t maxPayloadSize;
+	/// Average payload size of a valid packet (only filled in by @ref AMCOM_GetStats)
+	uint8_t avgPayloadSize;
+} AMCOM_ReceiverStats;
+
+// static assertion to check that the statistics structure is indeed packed (it is also the payload of the
+// AMCOM_STATS_PACKET_TYPE packet, all fields little-endian)
+static_assert(26 == sizeof(AMCOM_ReceiverStats), "26 != sizeof(AMCOM_ReceiverStats)");
+
+/** State of the frame being received (shared by all receivers parsing the SOP framing) */
 typedef struct {
-	/// Place to store the received packet
-	AMCOM_Packet receivedPacket;
 	/// Counter that will be used to count the number of received payload bytes
 	size_t payloadCounter;
 	/// State of the packet reception
 	AMCOM_PacketState receivedPacketState;
+	/// CRC calculated over the received bytes
+	uint16_t crc;
+	/// Position of the next byte of a rejected frame that is still to be rescanned (see @ref AMCOM_Parse)
+	uint8_t historyPos;
+	/// Number of buffered bytes of the rejected frame that is being rescanned
+	uint8_t historyEnd;
+} AMCOM_FrameState;
+
+/** Structure describing the AM packet receiver */
+typedef struct {
+	/// Place to store the received packet
+	AMCOM_Packet receivedPacket;
+	/// State of the frame being received
+	AMCOM_FrameState frame;
 	/// User-defined packet handler (callback)
 	AMCOM_PacketHandler packetHandler;
 	/// User-defined context (universal, general-purpose pointer)
 	void* userContext;
-	uint16_t crc;
+	/// Link statistics
+	AMCOM_ReceiverStats stats;
 } AMCOM_Receiver;
 
 
@@ -122,6 +216,18 @@ typedef struct {
  */
 void AMCOM_InitReceiver(AMCOM_Receiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext);
 
+/**
+ * @brief Calculates the CRC of a packet
+ *
+ * The CRC covers the TYPE and LENGTH fields followed by the payload.
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ *
+ * @return value of the CRC field
+ */
+uint16_t AMCOM_CalculateCRC(uint8_t packetType, const void* payload, size_t payloadSize);
+
 /**
  * @brief Serializes the packet
  *
@@ -146,12 +252,63 @@ size_t AMCOM_Serialize(uint8_t packetType, const void* payload, size_t payloadSi
  * AMCOM packet in this stream. The state of the packet reception shall be stored within the receiver structure.
  * If a valid packet is found and buffered, this function shall call the packetHandlerCallback function defined
  * through a previous call to @ref AMCOM_InitReceiver.
+ *
+ * When a frame is rejected (invalid LENGTH or CRC mismatch), the buffered bytes of that frame are rescanned
+ * starting from the byte after its SOP, so a valid packet that began inside the rejected frame (e.g. after
+ * a 0xA1 payload byte was mistaken for SOP) is not lost.
  * @param receiver pointer to the AMCOM receiver structure
  * @param data incoming data
  * @param dataSize number of bytes in the incoming data
  */
 void AMCOM_Deserialize(AMCOM_Receiver* receiver, const void* data, size_t dataSize);
 
+/**
+ * @brief Parses the chunk of data in pull mode, stopping after the first complete packet
+ *
+ * Unlike @ref AMCOM_Deserialize, this function does not call the packet handler. It consumes the data only up
+ * to (and including) the last byte of the first valid packet and returns that packet, so the caller bounds the
+ * work per call by dataSize and applies backpressure by not calling again until the packet is processed.
+ * Bytes that are not consumed must be passed again in the next call.
+ *
+ * When a packet is found while rescanning a rejected frame, the rest of that frame is rescanned by the next
+ * call before any new data is consumed, so such a call may return a packet with *consumed equal to 0.
+ * @param receiver pointer to the AMCOM receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data (upper bound of the bytes parsed by this call)
+ * @param consumed place to store the number of consumed bytes
+ *
+ * @return pointer to the received packet (valid until the next call for this receiver) or NULL if no packet
+ *         was completed
+ */
+const AMCOM_Packet* AMCOM_Parse(AMCOM_Receiver* receiver, const void* data, size_t dataSize, size_t* consumed);
+
+/**
+ * @brief Takes a snapshot of the receiver statistics.
+ *
+ * @param receiver pointer to the AMCOM receiver structure
+ * @param stats place to store the statistics
+ */
+void AMCOM_GetStats(const AMCOM_Receiver* receiver, AMCOM_ReceiverStats* stats);
+
+/**
+ * @brief Clears the receiver statistics.
+ *
+ * @param receiver pointer to the AMCOM receiver structure
+ */
+void AMCOM_ResetStats(AMCOM_Receiver* receiver);
+
+/**
+ * @brief Serializes a packet reporting the receiver statistics.
+ *
+ * The packet has the @ref AMCOM_STATS_PACKET_TYPE type and a snapshot of @ref AMCOM_ReceiverStats
+ * as the payload.
+ * @param receiver pointer to the AMCOM receiver structure
+ * @param destinationBuffer place to store the packet bytes (must be large enough!)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_SerializeStats(const AMCOM_Receiver* receiver, uint8_t* destinationBuffer);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
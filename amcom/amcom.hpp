@@ -0,0 +1,265 @@
+#ifndef AMCOM_HPP_
+#define AMCOM_HPP_
+
+/**
+ * This header file defines a header-only C++ variant of the AMCOM packet receiver.
+ *
+ * amcom::Receiver parses exactly the same wire format as @ref AMCOM_Deserialize, but the packet handler is
+ * a template parameter, so both the state machine and the handler can be inlined into the caller, and the
+ * payload storage is sized by the largest payload the link actually carries:
+ *
+ *     struct OnPacket {
+ *         void operator()(const amcom::Packet<16>& packet) { ... }
+ *     };
+ *
+ *     amcom::Receiver<OnPacket, 16> receiver;      // 21 bytes of packet storage instead of 205
+ *     receiver.deserialize(data, size);
+ *
+ * A LENGTH above MaxPayload is rejected like an invalid one: the receiver drops the SOP and hunts for the
+ * next SOP from the TYPE byte on, so a false SOP never makes it skip the packets that follow. Unlike
+ * @ref AMCOM_Deserialize, the receiver does not rescan the payload of a frame that fails the CRC check - it
+ * resumes hunting for SOP with the next byte.
+ *
+ * The header also builds constant frames at compile time (see amcom::makeFrame), so fixed frames such as
+ * heartbeats, ACKs or fixed status replies end up as complete byte arrays in flash and are sent with a single
+ * bulk write (or DMA transfer) without running the CRC at run time:
+ *
+ *     constexpr uint8_t statusOk[] = { 0x00, 0x01 };
+ *     static constexpr auto heartbeatFrame = amcom::makeFrame(0x10);
+ *     static constexpr auto statusFrame = amcom::makeFrame(0x11, statusOk);
+ *
+ *     USART_WriteData(heartbeatFrame.data(), heartbeatFrame.size());
+ *
+ * C code can use such frames through a small C++ translation unit that exports them:
+ *
+ *     extern "C" const uint8_t* const HEARTBEAT_FRAME = heartbeatFrame.data();
+ *     extern "C" const size_t HEARTBEAT_FRAME_SIZE = heartbeatFrame.size();
+ *
+ * Requires C++14.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "amcom.h"
+
+namespace amcom {
+
+/// Start of packet character
+constexpr uint8_t SOP = 0xA1;
+/// Initial value of the CRC
+constexpr uint16_t INITIAL_CRC = 0xFFFF;
+
+/**
+ * Updates the packet CRC with a single byte (same algorithm as used by AMCOM_Serialize).
+ * @param byte next byte covered by the CRC
+ * @param crc current CRC value
+ * @return updated CRC value
+ */
+constexpr uint16_t updateCrc(uint8_t byte, uint16_t crc) {
+	byte = (uint8_t)(byte ^ (uint8_t)(crc & 0x00ff));
+	byte = (uint8_t)(byte ^ (uint8_t)(byte << 4));
+	return (uint16_t)((((uint16_t)byte << 8) | (uint8_t)(crc >> 8))
+			^ (uint8_t)(byte >> 4)
+			^ ((uint16_t)byte << 3));
+}
+
+/**
+ * Calculates the packet CRC (same result as AMCOM_CalculateCRC).
+ * @param packetType type of packet
+ * @param payload payload data (may be NULL if payloadSize is 0)
+ * @param payloadSize number of bytes in the payload
+ * @return CRC of the packet
+ */
+constexpr uint16_t calculateCrc(uint8_t packetType, const uint8_t* payload, size_t payloadSize) {
+	uint16_t crc = updateCrc(packetType, INITIAL_CRC);
+	crc = updateCrc((uint8_t)payloadSize, crc);
+	for (size_t i = 0; i < payloadSize; ++i) {
+		crc = updateCrc(payload[i], crc);
+	}
+	return crc;
+}
+
+/**
+ * Complete serialized frame (header, CRC and payload) built at compile time.
+ * @tparam PayloadSize number of payload bytes (0..AMCOM_MAX_PAYLOAD_SIZE)
+ */
+template <size_t PayloadSize>
+struct Frame {
+	static_assert(PayloadSize <= AMCOM_MAX_PAYLOAD_SIZE, "PayloadSize must be 0..200");
+
+	uint8_t bytes[sizeof(AMCOM_PacketHeader) + PayloadSize];  ///< frame bytes, as AMCOM_Serialize writes them
+
+	/** Returns the frame bytes. */
+	constexpr const uint8_t* data() const { return bytes; }
+	/** Returns the number of frame bytes. */
+	static constexpr size_t size() { return sizeof(AMCOM_PacketHeader) + PayloadSize; }
+};
+
+namespace detail {
+
+/** Fills in the header of the frame whose payload is already in place. */
+template <size_t PayloadSize>
+constexpr void finishFrame(Frame<PayloadSize>& frame, uint8_t packetType) {
+	const uint16_t crc = calculateCrc(packetType, frame.bytes + sizeof(AMCOM_PacketHeader), PayloadSize);
+	frame.bytes[0] = SOP;
+	frame.bytes[1] = packetType;
+	frame.bytes[2] = (uint8_t)PayloadSize;
+	frame.bytes[3] = (uint8_t)(crc & 0xFF);
+	frame.bytes[4] = (uint8_t)(crc >> 8);
+}
+
+} // namespace detail
+
+/**
+ * Builds the frame of a packet with a fixed payload. Assign the result to a constexpr object to have
+ * the frame built by the compiler and placed in flash.
+ * @param packetType type of packet
+ * @param payload payload data
+ * @return frame bytes
+ */
+template <size_t PayloadSize>
+constexpr Frame<PayloadSize> makeFrame(uint8_t packetType, const uint8_t (&payload)[PayloadSize]) {
+	Frame<PayloadSize> frame{};
+	for (size_t i = 0; i < PayloadSize; ++i) {
+		frame.bytes[sizeof(AMCOM_PacketHeader) + i] = payload[i];
+	}
+	detail::finishFrame(frame, packetType);
+	return frame;
+}
+
+/**
+ * Builds the frame of a packet without payload (see the overload above).
+ * @param packetType type of packet
+ * @return frame bytes
+ */
+constexpr Frame<0> makeFrame(uint8_t packetType) {
+	Frame<0> frame{};
+	detail::finishFrame(frame, packetType);
+	return frame;
+}
+
+/**
+ * Packet with payload storage limited to MaxPayload bytes.
+ * @tparam MaxPayload maximum payload size (1..AMCOM_MAX_PAYLOAD_SIZE)
+ */
+template <size_t MaxPayload>
+struct AMPACKED Packet {
+	static_assert(MaxPayload >= 1 && MaxPayload <= AMCOM_MAX_PAYLOAD_SIZE, "MaxPayload must be 1..200");
+
+	AMCOM_PacketHeader header;    ///< packet header
+	uint8_t payload[MaxPayload];  ///< packet payload
+};
+
+/**
+ * AMCOM packet receiver with an inlined packet handler.
+ *
+ * @tparam Handler callable type invoked as handler(const Packet<MaxPayload>&) for every valid packet
+ * @tparam MaxPayload maximum payload size accepted by the receiver (1..AMCOM_MAX_PAYLOAD_SIZE)
+ */
+template <typename Handler, size_t MaxPayload = AMCOM_MAX_PAYLOAD_SIZE>
+class Receiver {
+public:
+	/**
+	 * Creates the receiver.
+	 * @param handler handler invoked for every valid packet
+	 */
+	explicit Receiver(Handler handler = Handler()) : handler_(handler) {}
+
+	/**
+	 * Deserializes the chunk of data, invoking the handler for every valid packet found.
+	 * @param data incoming data
+	 * @param dataSize number of bytes in the incoming data
+	 */
+	inline void deserialize(const void* data, size_t dataSize) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < dataSize; ++i) {
+			processByte(bytes[i]);
+		}
+	}
+
+	/** Returns the handler (e.g. to read the state it accumulated). */
+	Handler& handler() { return handler_; }
+
+private:
+	inline void processByte(uint8_t b) {
+		switch (state_) {
+		case AMCOM_PACKET_STATE_EMPTY:
+			if (b == SOP) {
+				packet_.header.sop = b;
+				crc_ = INITIAL_CRC;
+				payloadCounter_ = 0;
+				state_ = AMCOM_PACKET_STATE_GOT_SOP;
+			}
+			break;
+
+		case AMCOM_PACKET_STATE_GOT_SOP:
+			packet_.header.type = b;
+			crc_ = updateCrc(b, crc_);
+			state_ = AMCOM_PACKET_STATE_GOT_TYPE;
+			break;
+
+		case AMCOM_PACKET_STATE_GOT_TYPE:
+			packet_.header.length = b;
+			crc_ = updateCrc(b, crc_);
+			if (b > MaxPayload) {
+				rejectHeader();
+			} else {
+				state_ = AMCOM_PACKET_STATE_GOT_LENGTH;
+			}
+			break;
+
+		case AMCOM_PACKET_STATE_GOT_LENGTH:
+			receivedCrc_ = b;
+			state_ = AMCOM_PACKET_STATE_GOT_CRC_LO;
+			break;
+
+		case AMCOM_PACKET_STATE_GOT_CRC_LO:
+			receivedCrc_ = (uint16_t)(receivedCrc_ | ((uint16_t)b << 8));
+			packet_.header.crc = receivedCrc_;
+			if (packet_.header.length > 0) {
+				state_ = AMCOM_PACKET_STATE_GETTING_PAYLOAD;
+			} else {
+				finishPacket();
+			}
+			break;
+
+		case AMCOM_PACKET_STATE_GETTING_PAYLOAD:
+			packet_.payload[payloadCounter_] = b;
+			crc_ = updateCrc(b, crc_);
+			if (++payloadCounter_ >= packet_.header.length) {
+				finishPacket();
+			}
+			break;
+
+		default:
+			state_ = AMCOM_PACKET_STATE_EMPTY;
+			break;
+		}
+	}
+
+	/** Drops the SOP of a frame with a rejected LENGTH and hunts for the next SOP in its TYPE and LENGTH. */
+	inline void rejectHeader() {
+		state_ = AMCOM_PACKET_STATE_EMPTY;
+		// neither call recurses here again: a rescanned LENGTH can only become the TYPE of the next frame
+		processByte(packet_.header.type);
+		processByte(packet_.header.length);
+	}
+
+	inline void finishPacket() {
+		if (crc_ == receivedCrc_) {
+			handler_(static_cast<const Packet<MaxPayload>&>(packet_));
+		}
+		state_ = AMCOM_PACKET_STATE_EMPTY;
+	}
+
+	Packet<MaxPayload> packet_;
+	Handler handler_;
+	AMCOM_PacketState state_ = AMCOM_PACKET_STATE_EMPTY;
+	uint8_t payloadCounter_ = 0;
+	uint16_t crc_ = INITIAL_CRC;
+	uint16_t receivedCrc_ = 0;
+};
+
+} // namespace amcom
+
+#endif /* AMCOM_HPP_ */
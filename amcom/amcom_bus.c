@@ -0,0 +1,204 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_bus.h"
+#include "amcom_parser.h"
+
+/// Start of the addressed frame
+static const uint8_t AMCOM_BUS_SOP = 0xA3;
+/// Start of packet character reported in the delivered packets
+static const uint8_t AMCOM_BUS_PACKET_SOP = 0xA1;
+
+size_t AMCOM_BusSerialize(uint8_t address, uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer) {
+    if (!destinationBuffer || address == AMCOM_BUS_INVALID_ADDRESS || payloadSize > AMCOM_MAX_PAYLOAD_SIZE
+        || (!payload && payloadSize)) {
+        return 0;
+    }
+
+    const uint8_t header[3] = { address, packetType, (uint8_t)payloadSize };
+    uint16_t crc = AMCOM_UpdateCRCBlock(AMCOM_INITIAL_CRC, header, sizeof(header));
+    if (payloadSize) {
+        crc = AMCOM_UpdateCRCBlock(crc, (const uint8_t*)payload, payloadSize);
+    }
+
+    uint8_t* p = destinationBuffer;
+    *p++ = AMCOM_BUS_SOP;
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+    *p++ = (uint8_t)(crc & 0xFF);
+    *p++ = (uint8_t)(crc >> 8);
+    if (payloadSize) {
+        memcpy(p, payload, payloadSize);
+        p += payloadSize;
+    }
+
+    return (size_t)(p - destinationBuffer);
+}
+
+void AMCOM_InitBusReceiver(AMCOM_BusReceiver* receiver, uint8_t address, AMCOM_BusPacketHandler packetHandlerCallback,
+        void* userContext) {
+    assert(receiver != NULL);
+    receiver->state          = AMCOM_BUS_STATE_EMPTY;
+    receiver->address        = 0;
+    receiver->accepted       = false;
+    receiver->firstAddress   = address;
+    receiver->lastAddress    = address;
+    receiver->payloadCounter = 0;
+    receiver->crc            = AMCOM_INITIAL_CRC;
+    receiver->packetHandler  = packetHandlerCallback;
+    receiver->userContext    = userContext;
+    receiver->framesSkipped  = 0;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+void AMCOM_SetBusAddressRange(AMCOM_BusReceiver* receiver, uint8_t firstAddress, uint8_t lastAddress) {
+    assert(receiver && firstAddress <= lastAddress);
+    receiver->firstAddress = firstAddress;
+    receiver->lastAddress  = lastAddress;
+}
+
+/** Checks the CRC of a frame addressed to the node and delivers the packet. */
+static void AMCOM_BusFinishFrame(AMCOM_BusReceiver* receiver) {
+    AMCOM_Packet* packet = &receiver->receivedPacket;
+    receiver->state = AMCOM_BUS_STATE_EMPTY;
+
+    if (receiver->crc != packet->header.crc) {
+        receiver->stats.crcErrors++;
+        receiver->stats.bytesDiscarded += (uint32_t)(AMCOM_BUS_HEADER_SIZE + packet->header.length);
+        return;
+    }
+
+    receiver->stats.packetsOk++;
+    receiver->stats.payloadBytes += packet->header.length;
+    if (packet->header.length > receiver->stats.maxPayloadSize) {
+        receiver->stats.maxPayloadSize = packet->header.length;
+    }
+    packet->header.sop = AMCOM_BUS_PACKET_SOP;
+    if (receiver->packetHandler) {
+        receiver->packetHandler(packet, receiver->address, receiver->userContext);
+    }
+}
+
+static void AMCOM_BusParse(AMCOM_BusReceiver* receiver, const uint8_t* bytes, size_t dataSize) {
+    AMCOM_Packet* packet = &receiver->receivedPacket;
+    size_t i = 0;
+
+    while (i < dataSize) {
+        uint8_t b = bytes[i];
+
+        switch (receiver->state) {
+
+        case AMCOM_BUS_STATE_EMPTY: {
+            const uint8_t* sop = (const uint8_t*)memchr(&bytes[i], AMCOM_BUS_SOP, dataSize - i);
+            size_t skipped = sop ? (size_t)(sop - &bytes[i]) : (dataSize - i);
+            receiver->stats.bytesDiscarded += (uint32_t)skipped;
+            i += skipped;
+            if (sop) {
+                receiver->crc   = AMCOM_INITIAL_CRC;
+                receiver->state = AMCOM_BUS_STATE_GOT_SOP;
+                i++;
+            }
+            break;
+        }
+
+        case AMCOM_BUS_STATE_GOT_SOP:
+            if (b == AMCOM_BUS_SOP) {
+                // SOP is not a valid address: the previous SOP was false, the frame starts here
+                receiver->stats.bytesDiscarded++;
+                i++;
+                break;
+            }
+            // the early filter: the rest of the frame is either received or skipped
+            receiver->address  = b;
+            receiver->accepted = (b == AMCOM_BUS_BROADCAST_ADDRESS)
+                              || (b >= receiver->firstAddress && b <= receiver->lastAddress);
+            receiver->crc      = AMCOM_UpdateCRCBlock(receiver->crc, &b, 1);
+            receiver->state    = AMCOM_BUS_STATE_GOT_ADDRESS;
+            i++;
+            break;
+
+        case AMCOM_BUS_STATE_GOT_ADDRESS:
+            packet->header.type = b;
+            receiver->crc       = AMCOM_UpdateCRCBlock(receiver->crc, &b, 1);
+            receiver->state     = AMCOM_BUS_STATE_GOT_TYPE;
+            i++;
+            break;
+
+        case AMCOM_BUS_STATE_GOT_TYPE:
+            if (b > AMCOM_MAX_PAYLOAD_SIZE) {
+                // the false SOP is dropped, ADDRESS and TYPE are rescanned, the LENGTH is parsed again below
+                const uint8_t header[2] = { receiver->address, packet->header.type };
+                receiver->stats.lengthErrors++;
+                receiver->stats.bytesDiscarded++;
+                receiver->state = AMCOM_BUS_STATE_EMPTY;
+                AMCOM_BusParse(receiver, header, sizeof(header));
+                break;
+            }
+            i++;
+            packet->header.length = b;
+            if (receiver->accepted) {
+                receiver->crc   = AMCOM_UpdateCRCBlock(receiver->crc, &b, 1);
+                receiver->state = AMCOM_BUS_STATE_GOT_LENGTH;
+            } else {
+                receiver->payloadCounter = sizeof(packet->header.crc) + b;
+                receiver->state = AMCOM_BUS_STATE_SKIPPING;
+            }
+            break;
+
+        case AMCOM_BUS_STATE_GOT_LENGTH:
+            packet->header.crc = b;
+            receiver->state    = AMCOM_BUS_STATE_GOT_CRC_LO;
+            i++;
+            break;
+
+        case AMCOM_BUS_STATE_GOT_CRC_LO:
+            packet->header.crc = (uint16_t)(packet->header.crc | ((uint16_t)b << 8));
+            i++;
+            if (packet->header.length == 0) {
+                AMCOM_BusFinishFrame(receiver);
+            } else {
+                receiver->payloadCounter = 0;
+                receiver->state = AMCOM_BUS_STATE_GETTING_PAYLOAD;
+            }
+            break;
+
+        case AMCOM_BUS_STATE_GETTING_PAYLOAD: {
+            size_t run = packet->header.length - receiver->payloadCounter;
+            if (run > dataSize - i) {
+                run = dataSize - i;
+            }
+            memcpy(&packet->payload[receiver->payloadCounter], &bytes[i], run);
+            receiver->crc = AMCOM_UpdateCRCBlock(receiver->crc, &bytes[i], run);
+            receiver->payloadCounter += run;
+            i += run;
+            if (receiver->payloadCounter >= packet->header.length) {
+                AMCOM_BusFinishFrame(receiver);
+            }
+            break;
+        }
+
+        case AMCOM_BUS_STATE_SKIPPING: {
+            size_t run = receiver->payloadCounter;
+            if (run > dataSize - i) {
+                run = dataSize - i;
+            }
+            receiver->payloadCounter -= run;
+            i += run;
+            if (receiver->payloadCounter == 0) {
+                receiver->framesSkipped++;
+                receiver->state = AMCOM_BUS_STATE_EMPTY;
+            }
+            break;
+        }
+
+        default:
+            receiver->state = AMCOM_BUS_STATE_EMPTY;
+            break;
+        }
+    }
+}
+
+void AMCOM_BusDeserialize(AMCOM_BusReceiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    receiver->stats.bytesReceived += (uint32_t)dataSize;
+    AMCOM_BusParse(receiver, (const uint8_t*)data, dataSize);
+}
@@ -0,0 +1,157 @@
+#ifndef AMCOM_BUS_H_
+#define AMCOM_BUS_H_
+
+/**
+ * This header file defines the API of the addressed (multi-drop) variant of AMCOM for RS-485 buses.
+ *
+ * The frame is the regular AMCOM packet with its own SOP and an ADDRESS field in front of TYPE:
+ *
+ * +--------+---------+--------+--------+--------+--------+--------------------------------------------+
+ * | SOP    | ADDRESS | TYPE   | LENGTH | CRC             | PAYLOAD                                    |
+ * | 1B     | 1B      | 1B     | 1B     | 2B              | 0..200B                                    |
+ * +--------+---------+--------+--------+--------+--------+--------------------------------------------+
+ * <----- size of header is 6 bytes --------------------->
+ *
+ * SOP - always 0xA3, so the variant can never be mistaken for a regular packet.
+ * ADDRESS - address of the destination node. @ref AMCOM_BUS_BROADCAST_ADDRESS addresses all nodes. 0xA3 is
+ *           not a valid address: a SOP in its place restarts the frame, so a noise byte equal to SOP right
+ *           before a frame does not make the nodes skip that frame.
+ * CRC - the regular AMCOM CRC, calculated over ADDRESS, TYPE, LENGTH and PAYLOAD.
+ *
+ * Every node filters the frames as soon as the ADDRESS arrives. The receiver then skips a frame for
+ * another node by its LENGTH: its payload is neither copied nor covered by the CRC, so the CPU load
+ * of a node does not grow with the traffic of the other nodes on the bus.
+ *
+ * The price is that a frame cannot be rescanned after an error. A frame for another node with a corrupted
+ * LENGTH makes the receiver skip the wrong number of bytes. After a CRC error, hunting for SOP resumes
+ * after the rejected frame. In both cases a frame that starts inside the skipped bytes is lost. Only the
+ * header bytes are rescanned after an invalid LENGTH.
+ *
+ * Received packets are delivered with the SOP field set to 0xA1 and the received CRC (which covers
+ * the ADDRESS as well).
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/// Address accepted by every node
+	AMCOM_BUS_BROADCAST_ADDRESS = 0xFF,
+	/// Address that must not be used (equal to the SOP)
+	AMCOM_BUS_INVALID_ADDRESS = 0xA3,
+	/// Size of the addressed frame header
+	AMCOM_BUS_HEADER_SIZE = 6,
+	/// Maximum size of the whole addressed frame
+	AMCOM_BUS_MAX_FRAME_SIZE = (AMCOM_BUS_HEADER_SIZE + AMCOM_MAX_PAYLOAD_SIZE)
+};
+
+/**
+ * Type describing a callback function that will be called when a bus receiver gets a packet.
+ *
+ * @param packet packet that is received
+ * @param address destination address of the frame (the node's own one or @ref AMCOM_BUS_BROADCAST_ADDRESS)
+ * @param userContext user defined context associated with the receiver
+ */
+typedef void (*AMCOM_BusPacketHandler)(const AMCOM_Packet* packet, uint8_t address, void* userContext);
+
+/** Possible states of the addressed frame reception. */
+typedef enum {
+	/// Hunting for SOP
+	AMCOM_BUS_STATE_EMPTY = 0,
+	/// Got SOP field
+	AMCOM_BUS_STATE_GOT_SOP,
+	/// Got ADDRESS field
+	AMCOM_BUS_STATE_GOT_ADDRESS,
+	/// Got TYPE field
+	AMCOM_BUS_STATE_GOT_TYPE,
+	/// Got LENGTH field
+	AMCOM_BUS_STATE_GOT_LENGTH,
+	/// Got first byte of CRC
+	AMCOM_BUS_STATE_GOT_CRC_LO,
+	/// Getting payload data
+	AMCOM_BUS_STATE_GETTING_PAYLOAD,
+	/// Skipping the rest of a frame for another node
+	AMCOM_BUS_STATE_SKIPPING
+} AMCOM_BusState;
+
+/** Structure describing the bus receiver */
+typedef struct {
+	/// Place to store the received packet
+	AMCOM_Packet receivedPacket;
+	/// State of the frame reception
+	AMCOM_BusState state;
+	/// Destination address of the frame being received
+	uint8_t address;
+	/// Flag stating if the frame being received is addressed to this node
+	bool accepted;
+	/// First address accepted by the node
+	uint8_t firstAddress;
+	/// Last address accepted by the node
+	uint8_t lastAddress;
+	/// Number of payload bytes received (or bytes left to skip while skipping)
+	size_t payloadCounter;
+	/// CRC calculated over the received bytes
+	uint16_t crc;
+	/// User-defined packet handler (callback)
+	AMCOM_BusPacketHandler packetHandler;
+	/// User-defined context
+	void* userContext;
+	/// Number of frames skipped because they were addressed to another node
+	uint32_t framesSkipped;
+	/// Link statistics (the bytes of skipped frames are counted neither as discarded nor as payload)
+	AMCOM_ReceiverStats stats;
+} AMCOM_BusReceiver;
+
+/**
+ * @brief Serializes the packet as an addressed frame
+ *
+ * In case of invalid input arguments, this function shall not write anything to the destinationBuffer and return 0.
+ * @param address destination address (not @ref AMCOM_BUS_INVALID_ADDRESS)
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ * @param destinationBuffer place to store the frame bytes (at least @ref AMCOM_BUS_MAX_FRAME_SIZE bytes)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_BusSerialize(uint8_t address, uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer);
+
+/**
+ * @brief Initializes the bus receiver of a node with a single address.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param address address of the node
+ * @param packetHandlerCallback callback function that will be called each time a packet is received
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ */
+void AMCOM_InitBusReceiver(AMCOM_BusReceiver* receiver, uint8_t address, AMCOM_BusPacketHandler packetHandlerCallback,
+		void* userContext);
+
+/**
+ * @brief Makes the node accept a range of addresses (e.g. a gateway or a bus monitor).
+ *
+ * Frames sent to @ref AMCOM_BUS_BROADCAST_ADDRESS are accepted regardless of the range.
+ * @param receiver pointer to the receiver structure
+ * @param firstAddress first accepted address
+ * @param lastAddress last accepted address (inclusive)
+ */
+void AMCOM_SetBusAddressRange(AMCOM_BusReceiver* receiver, uint8_t firstAddress, uint8_t lastAddress);
+
+/**
+ * @brief Deserializes the chunk of data, delivering the frames addressed to the node
+ *
+ * @param receiver pointer to the receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_BusDeserialize(AMCOM_BusReceiver* receiver, const void* data, size_t dataSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_BUS_H_ */
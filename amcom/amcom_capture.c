@@ -0,0 +1,104 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_capture.h"
+
+/// Magic bytes at the start of a capture
+static const uint8_t AMCOM_CAPTURE_MAGIC[4] = { 'A', 'M', 'C', 'P' };
+/// Direction bit of the DIR+LENGTH field
+#define AMCOM_CAPTURE_DIRECTION_BIT     0x8000u
+
+void AMCOM_InitCaptureRecorder(AMCOM_CaptureRecorder* recorder, AMCOM_CaptureWriter writer,
+        AMCOM_CaptureClock clock, void* userContext) {
+    assert(recorder && writer && clock);
+    recorder->writer      = writer;
+    recorder->clock       = clock;
+    recorder->userContext = userContext;
+    recorder->enabled     = true;
+
+    uint8_t header[AMCOM_CAPTURE_FILE_HEADER_SIZE] = {0};
+    memcpy(header, AMCOM_CAPTURE_MAGIC, sizeof(AMCOM_CAPTURE_MAGIC));
+    header[4] = (uint8_t)(AMCOM_CAPTURE_VERSION & 0xFF);
+    header[5] = (uint8_t)(AMCOM_CAPTURE_VERSION >> 8);
+    writer(header, sizeof(header), userContext);
+}
+
+void AMCOM_EnableCaptureRecorder(AMCOM_CaptureRecorder* recorder, bool enabled) {
+    assert(recorder != NULL);
+    recorder->enabled = enabled;
+}
+
+void AMCOM_CaptureRecordChunk(AMCOM_CaptureRecorder* recorder, AMCOM_CaptureDirection direction,
+        const void* data, size_t dataSize) {
+    assert(recorder && (data || dataSize == 0));
+    if (!recorder->enabled || dataSize == 0) {
+        return;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t timestamp = recorder->clock(recorder->userContext);
+    while (dataSize > 0) {
+        size_t length = (dataSize > AMCOM_CAPTURE_MAX_RECORD_SIZE) ? AMCOM_CAPTURE_MAX_RECORD_SIZE : dataSize;
+        uint16_t field = (uint16_t)length | ((direction == AMCOM_CAPTURE_TX) ? AMCOM_CAPTURE_DIRECTION_BIT : 0);
+
+        uint8_t header[AMCOM_CAPTURE_RECORD_HEADER_SIZE];
+        header[0] = (uint8_t)(timestamp & 0xFF);
+        header[1] = (uint8_t)(timestamp >> 8);
+        header[2] = (uint8_t)(timestamp >> 16);
+        header[3] = (uint8_t)(timestamp >> 24);
+        header[4] = (uint8_t)(field & 0xFF);
+        header[5] = (uint8_t)(field >> 8);
+        recorder->writer(header, sizeof(header), recorder->userContext);
+        recorder->writer(bytes, length, recorder->userContext);
+
+        bytes += length;
+        dataSize -= length;
+    }
+}
+
+void AMCOM_CaptureDeserialize(AMCOM_CaptureRecorder* recorder, AMCOM_Receiver* receiver,
+        const void* data, size_t dataSize) {
+    if (recorder) {
+        AMCOM_CaptureRecordChunk(recorder, AMCOM_CAPTURE_RX, data, dataSize);
+    }
+    AMCOM_Deserialize(receiver, data, dataSize);
+}
+
+bool AMCOM_InitCaptureReader(AMCOM_CaptureReader* reader, const void* data, size_t dataSize) {
+    assert(reader && (data || dataSize == 0));
+    const uint8_t* bytes = (const uint8_t*)data;
+    reader->data     = bytes;
+    reader->dataSize = dataSize;
+    reader->offset   = AMCOM_CAPTURE_FILE_HEADER_SIZE;
+
+    if (dataSize < AMCOM_CAPTURE_FILE_HEADER_SIZE || memcmp(bytes, AMCOM_CAPTURE_MAGIC, sizeof(AMCOM_CAPTURE_MAGIC)) != 0) {
+        reader->offset = dataSize;
+        return false;
+    }
+    uint16_t version = (uint16_t)(bytes[4] | (bytes[5] << 8));
+    if (version != AMCOM_CAPTURE_VERSION) {
+        reader->offset = dataSize;
+        return false;
+    }
+    return true;
+}
+
+bool AMCOM_ReadCaptureRecord(AMCOM_CaptureReader* reader, AMCOM_CaptureRecord* record) {
+    assert(reader && record);
+    if (reader->dataSize - reader->offset < AMCOM_CAPTURE_RECORD_HEADER_SIZE) {
+        return false;
+    }
+
+    const uint8_t* p = reader->data + reader->offset;
+    uint16_t field = (uint16_t)(p[4] | (p[5] << 8));
+    size_t length = field & ~AMCOM_CAPTURE_DIRECTION_BIT;
+    if (reader->dataSize - reader->offset - AMCOM_CAPTURE_RECORD_HEADER_SIZE < length) {
+        return false;
+    }
+
+    record->timestampUs = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    record->direction   = (field & AMCOM_CAPTURE_DIRECTION_BIT) ? AMCOM_CAPTURE_TX : AMCOM_CAPTURE_RX;
+    record->data        = p + AMCOM_CAPTURE_RECORD_HEADER_SIZE;
+    record->dataSize    = length;
+    reader->offset     += AMCOM_CAPTURE_RECORD_HEADER_SIZE + length;
+    return true;
+}
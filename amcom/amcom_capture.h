@@ -0,0 +1,180 @@
+#ifndef AMCOM_CAPTURE_H_
+#define AMCOM_CAPTURE_H_
+
+/**
+ * This header file defines the AMCOM capture format and its recorder and reader.
+ *
+ * A capture holds the raw byte chunks of a link, each with a timestamp and a direction, so the traffic can be
+ * replayed later exactly as it was fed to @ref AMCOM_Deserialize. All fields are little-endian.
+ *
+ * File header (8 bytes):
+ *
+ * +--------+--------+--------+--------+--------+--------+--------+--------+
+ * | MAGIC "AMCP"                      | VERSION         | RESERVED        |
+ * +--------+--------+--------+--------+--------+--------+--------+--------+
+ *
+ * Record header (6 bytes), followed by LENGTH bytes of data:
+ *
+ * +--------+--------+--------+--------+--------+--------+
+ * | TIMESTAMP [us]                    | DIR+LENGTH      |
+ * +--------+--------+--------+--------+--------+--------+
+ *
+ * TIMESTAMP - free-running microsecond clock. It wraps after ~71 minutes, so readers use the unsigned
+ *             difference between consecutive records.
+ * DIR+LENGTH - bit 15 is the direction (0 - received, 1 - transmitted), bits 0..14 are the data length.
+ *
+ * Typical usage (recording the receive path):
+ *
+ *     AMCOM_CaptureRecorder recorder;
+ *     AMCOM_InitCaptureRecorder(&recorder, flashLogWrite, microsecondClock, NULL);
+ *     ...
+ *     size_t n = USART_ReadData(buf, sizeof(buf));
+ *     AMCOM_CaptureDeserialize(&recorder, &receiver, buf, n);
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/// Version of the capture format
+	AMCOM_CAPTURE_VERSION = 1,
+	/// Size of the file header
+	AMCOM_CAPTURE_FILE_HEADER_SIZE = 8,
+	/// Size of the record header
+	AMCOM_CAPTURE_RECORD_HEADER_SIZE = 6,
+	/// Maximum number of data bytes in a single record (longer chunks are split)
+	AMCOM_CAPTURE_MAX_RECORD_SIZE = 0x7FFF
+};
+
+/** Direction of the recorded chunk */
+typedef enum {
+	/// Bytes received from the link
+	AMCOM_CAPTURE_RX = 0,
+	/// Bytes transmitted to the link
+	AMCOM_CAPTURE_TX = 1
+} AMCOM_CaptureDirection;
+
+/**
+ * Type describing a function that stores the capture bytes (e.g. in a file, a RAM log or a spare USART).
+ *
+ * @param data bytes to store
+ * @param dataSize number of bytes to store
+ * @param userContext user defined context associated with the recorder
+ */
+typedef void (*AMCOM_CaptureWriter)(const void* data, size_t dataSize, void* userContext);
+
+/**
+ * Type describing a function that returns the current time in microseconds.
+ *
+ * @param userContext user defined context associated with the recorder
+ */
+typedef uint32_t (*AMCOM_CaptureClock)(void* userContext);
+
+/** Structure describing the capture recorder */
+typedef struct {
+	/// Function storing the capture bytes
+	AMCOM_CaptureWriter writer;
+	/// Function returning the timestamps
+	AMCOM_CaptureClock clock;
+	/// User-defined context passed to the writer and the clock
+	void* userContext;
+	/// Recording is active
+	bool enabled;
+} AMCOM_CaptureRecorder;
+
+/** Single record of a capture */
+typedef struct {
+	/// Timestamp of the record in microseconds
+	uint32_t timestampUs;
+	/// Direction of the recorded chunk
+	AMCOM_CaptureDirection direction;
+	/// Recorded bytes (points into the capture)
+	const uint8_t* data;
+	/// Number of recorded bytes
+	size_t dataSize;
+} AMCOM_CaptureRecord;
+
+/** Structure describing the capture reader */
+typedef struct {
+	/// Capture bytes
+	const uint8_t* data;
+	/// Number of capture bytes
+	size_t dataSize;
+	/// Offset of the next record
+	size_t offset;
+} AMCOM_CaptureReader;
+
+/**
+ * @brief Initializes the capture recorder and writes the file header.
+ *
+ * @param recorder pointer to the recorder structure
+ * @param writer function storing the capture bytes
+ * @param clock function returning the timestamps
+ * @param userContext user defined context passed to the writer and the clock
+ */
+void AMCOM_InitCaptureRecorder(AMCOM_CaptureRecorder* recorder, AMCOM_CaptureWriter writer,
+		AMCOM_CaptureClock clock, void* userContext);
+
+/**
+ * @brief Enables or disables recording.
+ *
+ * A disabled recorder drops all chunks, so the hook can stay in the data path at the cost of one branch.
+ * @param recorder pointer to the recorder structure
+ * @param enabled true to record, false to pause
+ */
+void AMCOM_EnableCaptureRecorder(AMCOM_CaptureRecorder* recorder, bool enabled);
+
+/**
+ * @brief Records a chunk of link traffic.
+ *
+ * Chunks longer than @ref AMCOM_CAPTURE_MAX_RECORD_SIZE are split into several records with the same timestamp.
+ * @param recorder pointer to the recorder structure
+ * @param direction direction of the chunk
+ * @param data chunk bytes
+ * @param dataSize number of bytes in the chunk
+ */
+void AMCOM_CaptureRecordChunk(AMCOM_CaptureRecorder* recorder, AMCOM_CaptureDirection direction,
+		const void* data, size_t dataSize);
+
+/**
+ * @brief Records a received chunk and feeds it to the receiver.
+ *
+ * This is a drop-in replacement for @ref AMCOM_Deserialize in the receive path.
+ * @param recorder pointer to the recorder structure (may be NULL to only deserialize)
+ * @param receiver pointer to the AMCOM receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_CaptureDeserialize(AMCOM_CaptureRecorder* recorder, AMCOM_Receiver* receiver,
+		const void* data, size_t dataSize);
+
+/**
+ * @brief Initializes the capture reader and validates the file header.
+ *
+ * @param reader pointer to the reader structure
+ * @param data capture bytes (must stay valid while the reader is used)
+ * @param dataSize number of capture bytes
+ *
+ * @return true if the capture has a valid header of a supported version, false otherwise
+ */
+bool AMCOM_InitCaptureReader(AMCOM_CaptureReader* reader, const void* data, size_t dataSize);
+
+/**
+ * @brief Reads the next record of the capture.
+ *
+ * @param reader pointer to the reader structure
+ * @param record place to store the record
+ *
+ * @return true if a record was read, false at the end of the capture or if the last record is truncated
+ */
+bool AMCOM_ReadCaptureRecord(AMCOM_CaptureReader* reader, AMCOM_CaptureRecord* record);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_CAPTURE_H_ */
@@ -0,0 +1,145 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_cobs.h"
+
+/// Frame delimiter
+static const uint8_t AMCOM_COBS_DELIMITER = 0x00;
+/// Start of packet character reported in the delivered packets
+static const uint8_t AMCOM_COBS_SOP = 0xA1;
+
+size_t AMCOM_CobsSerialize(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer) {
+    if (!destinationBuffer || payloadSize > AMCOM_MAX_PAYLOAD_SIZE || (!payload && payloadSize)) {
+        return 0;
+    }
+
+    uint16_t crc = AMCOM_CalculateCRC(packetType, payload, payloadSize);
+    const uint8_t header[4] = { packetType, (uint8_t)payloadSize, (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8) };
+    const uint8_t* data = (const uint8_t*)payload;
+
+    // the frame is shorter than 254 bytes, so every block ends with a (removed) zero or the end of data
+    uint8_t* code = destinationBuffer;
+    uint8_t* p = destinationBuffer + 1;
+    for (size_t i = 0; i < sizeof(header) + payloadSize; ++i) {
+        uint8_t b = (i < sizeof(header)) ? header[i] : data[i - sizeof(header)];
+        if (b == AMCOM_COBS_DELIMITER) {
+            *code = (uint8_t)(p - code);
+            code = p++;
+        } else {
+            *p++ = b;
+        }
+    }
+    *code = (uint8_t)(p - code);
+    *p++ = AMCOM_COBS_DELIMITER;
+
+    return (size_t)(p - destinationBuffer);
+}
+
+/** Prepares the receiver for the next frame. */
+static void AMCOM_CobsResetFrame(AMCOM_CobsReceiver* receiver) {
+    receiver->decodedCounter = 0;
+    receiver->frameBytes     = 0;
+    receiver->blockRemaining = 0;
+    receiver->pendingZero    = false;
+    receiver->skipping       = false;
+}
+
+/** Appends a decoded byte to the packet, returns false if the frame is too long. */
+static bool AMCOM_CobsPutByte(AMCOM_CobsReceiver* receiver, uint8_t b) {
+    if (receiver->decodedCounter >= sizeof(AMCOM_Packet) - 1) {
+        return false;
+    }
+    ((uint8_t*)&receiver->receivedPacket)[1 + receiver->decodedCounter++] = b;
+    return true;
+}
+
+/**
+ * Validates a complete frame and calls the user handler.
+ *
+ * @return true if the frame was valid, false otherwise
+ */
+static bool AMCOM_CobsFinishFrame(AMCOM_CobsReceiver* receiver) {
+    AMCOM_Packet* packet = &receiver->receivedPacket;
+    const uint8_t* raw = (const uint8_t*)packet;
+
+    if (receiver->blockRemaining != 0 || receiver->decodedCounter < sizeof(AMCOM_PacketHeader) - 1
+        || packet->header.length != receiver->decodedCounter - (sizeof(AMCOM_PacketHeader) - 1)) {
+        receiver->stats.lengthErrors++;
+        return false;
+    }
+
+    uint16_t crc = (uint16_t)(raw[3] | ((uint16_t)raw[4] << 8));
+    if (crc != AMCOM_CalculateCRC(packet->header.type, packet->payload, packet->header.length)) {
+        receiver->stats.crcErrors++;
+        return false;
+    }
+
+    receiver->stats.packetsOk++;
+    receiver->stats.payloadBytes += packet->header.length;
+    if (packet->header.length > receiver->stats.maxPayloadSize) {
+        receiver->stats.maxPayloadSize = packet->header.length;
+    }
+    packet->header.sop = AMCOM_COBS_SOP;
+    if (receiver->packetHandler) {
+        receiver->packetHandler(packet, receiver->userContext);
+    }
+    return true;
+}
+
+void AMCOM_InitCobsReceiver(AMCOM_CobsReceiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext) {
+    assert(receiver != NULL);
+    AMCOM_CobsResetFrame(receiver);
+    receiver->packetHandler = packetHandlerCallback;
+    receiver->userContext   = userContext;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+void AMCOM_CobsDeserialize(AMCOM_CobsReceiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    const uint8_t* bytes = (const uint8_t*)data;
+    const uint8_t* end = bytes + dataSize;
+
+    receiver->stats.bytesReceived += (uint32_t)dataSize;
+    while (bytes < end) {
+        if (receiver->skipping) {
+            // resynchronize at the next delimiter
+            const uint8_t* delimiter = (const uint8_t*)memchr(bytes, AMCOM_COBS_DELIMITER, (size_t)(end - bytes));
+            if (!delimiter) {
+                receiver->frameBytes += (size_t)(end - bytes);
+                return;
+            }
+            receiver->stats.bytesDiscarded += (uint32_t)(receiver->frameBytes + (size_t)(delimiter - bytes) + 1);
+            bytes = delimiter + 1;
+            AMCOM_CobsResetFrame(receiver);
+            continue;
+        }
+
+        uint8_t b = *bytes++;
+        if (b == AMCOM_COBS_DELIMITER) {
+            // an empty frame is just a (discarded) filler delimiter
+            if (receiver->frameBytes == 0 || !AMCOM_CobsFinishFrame(receiver)) {
+                receiver->stats.bytesDiscarded += (uint32_t)(receiver->frameBytes + 1);
+            }
+            AMCOM_CobsResetFrame(receiver);
+            continue;
+        }
+
+        receiver->frameBytes++;
+        if (receiver->blockRemaining == 0) {
+            // block code: the previous block (if any) ended with a removed zero
+            if (receiver->pendingZero && !AMCOM_CobsPutByte(receiver, 0)) {
+                receiver->stats.lengthErrors++;
+                receiver->skipping = true;
+                continue;
+            }
+            receiver->blockRemaining = (uint8_t)(b - 1);
+            receiver->pendingZero    = (b != 0xFF);
+        } else {
+            if (!AMCOM_CobsPutByte(receiver, b)) {
+                receiver->stats.lengthErrors++;
+                receiver->skipping = true;
+                continue;
+            }
+            receiver->blockRemaining--;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef AMCOM_COBS_H_
+#define AMCOM_COBS_H_
+
+/**
+ * This header file defines the API of the COBS-framed variant of AMCOM.
+ *
+ * Instead of starting with SOP, each frame consists of the TYPE, LENGTH, CRC and PAYLOAD fields (with the
+ * same meaning and CRC as in the regular AMCOM packet) encoded with COBS (Consistent Overhead Byte
+ * Stuffing), followed by a single 0x00 delimiter:
+ *
+ * +-----------------------------------------------------------------------------------+--------+
+ * | COBS( TYPE | LENGTH | CRC | PAYLOAD )                                             | 0x00   |
+ * | 5..205B                                                                           | 1B     |
+ * +-----------------------------------------------------------------------------------+--------+
+ *
+ * COBS removes every 0x00 byte from the encoded data at the cost of one extra byte per frame (frames are
+ * shorter than 254 bytes), so 0x00 can only appear as the delimiter. After an error the receiver skips
+ * straight to the next delimiter and payload bytes can never be mistaken for the start of a frame.
+ *
+ * Received packets are delivered through the regular @ref AMCOM_PacketHandler, with the SOP field set to 0xA1.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/// Maximum size of the whole COBS frame (including the delimiter)
+	AMCOM_COBS_MAX_FRAME_SIZE = (AMCOM_MAX_PACKET_SIZE - 1 + 1 + 1)
+};
+
+/** Structure describing the COBS frame receiver */
+typedef struct {
+	/// Place to store the received packet
+	AMCOM_Packet receivedPacket;
+	/// Number of decoded bytes of the current frame
+	size_t decodedCounter;
+	/// Number of encoded bytes of the current frame received so far
+	size_t frameBytes;
+	/// Number of data bytes left in the current COBS block (0 - next byte is a block code)
+	uint8_t blockRemaining;
+	/// Flag stating if a zero has to be inserted before the next block
+	bool pendingZero;
+	/// Flag stating if the current frame is invalid and shall be skipped until the next delimiter
+	bool skipping;
+	/// User-defined packet handler (callback)
+	AMCOM_PacketHandler packetHandler;
+	/// User-defined context
+	void* userContext;
+	/// Link statistics (length errors also count malformed frames)
+	AMCOM_ReceiverStats stats;
+} AMCOM_CobsReceiver;
+
+/**
+ * @brief Serializes the packet as a COBS frame
+ *
+ * In case of invalid input arguments, this function shall not write anything to the destinationBuffer and return 0.
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ * @param destinationBuffer place to store the frame bytes (at least @ref AMCOM_COBS_MAX_FRAME_SIZE bytes)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_CobsSerialize(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer);
+
+/**
+ * @brief Initializes the COBS frame receiver.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param packetHandlerCallback callback function that will be called each time a packet is received
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ */
+void AMCOM_InitCobsReceiver(AMCOM_CobsReceiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext);
+
+/**
+ * @brief Deserializes the chunk of data, searching for valid COBS frames
+ *
+ * @param receiver pointer to the receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_CobsDeserialize(AMCOM_CobsReceiver* receiver, const void* data, size_t dataSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_COBS_H_ */
@@ -0,0 +1,196 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_compress.h"
+
+enum {
+    /// Shortest match worth encoding
+    AMCOM_LZSS_MIN_MATCH = 3,
+    /// Longest match that can be encoded
+    AMCOM_LZSS_MAX_MATCH = AMCOM_LZSS_MIN_MATCH + 255,
+    /// Longest distance that can be encoded
+    AMCOM_LZSS_MAX_OFFSET = 256,
+    /// Number of candidates examined for each position
+    AMCOM_LZSS_MAX_CHAIN = 16,
+    /// Number of hash buckets
+    AMCOM_LZSS_HASH_SIZE = 256
+};
+
+/// Match finder state: positions are stored +1, 0 means "none"
+typedef struct {
+    uint8_t head[AMCOM_LZSS_HASH_SIZE];
+    uint8_t prev[AMCOM_MAX_PAYLOAD_SIZE];
+} AMCOM_LzssState;
+
+static inline uint8_t AMCOM_LzssHash(const uint8_t* p) {
+    return (uint8_t)((p[0] << 3) ^ (p[1] << 1) ^ p[2] ^ (p[2] >> 3));
+}
+
+size_t AMCOM_Compress(const void* input, size_t inputSize, uint8_t* output, size_t outputCapacity) {
+    assert(input || inputSize == 0);
+    assert(output);
+    if (inputSize > AMCOM_MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    const uint8_t* in = (const uint8_t*)input;
+    AMCOM_LzssState state;
+    memset(state.head, 0, sizeof(state.head));
+
+    size_t out = 0;
+    size_t flagPos = 0;
+    uint8_t flagBit = 8;
+    size_t pos = 0;
+
+    while (pos < inputSize) {
+        if (flagBit == 8) {
+            if (out >= outputCapacity) {
+                return 0;
+            }
+            flagPos = out;
+            output[out++] = 0;
+            flagBit = 0;
+        }
+
+        // find the longest match among the recent positions with the same hash
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        if (pos + AMCOM_LZSS_MIN_MATCH <= inputSize) {
+            uint8_t hash = AMCOM_LzssHash(&in[pos]);
+            size_t maxLength = inputSize - pos;
+            if (maxLength > AMCOM_LZSS_MAX_MATCH) {
+                maxLength = AMCOM_LZSS_MAX_MATCH;
+            }
+            uint8_t candidate = state.head[hash];
+            for (int chain = 0; candidate && chain < AMCOM_LZSS_MAX_CHAIN; ++chain) {
+                size_t start = candidate - 1u;
+                size_t length = 0;
+                while (length < maxLength && in[start + length] == in[pos + length]) {
+                    length++;
+                }
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = pos - start;
+                }
+                candidate = state.prev[start];
+            }
+            state.prev[pos] = state.head[hash];
+            state.head[hash] = (uint8_t)(pos + 1);
+        }
+
+        if (bestLength >= AMCOM_LZSS_MIN_MATCH) {
+            if (out + 2 > outputCapacity) {
+                return 0;
+            }
+            output[flagPos] |= (uint8_t)(1u << flagBit);
+            output[out++] = (uint8_t)(bestOffset - 1);
+            output[out++] = (uint8_t)(bestLength - AMCOM_LZSS_MIN_MATCH);
+
+            // register the positions covered by the match
+            for (size_t end = pos + bestLength, p = pos + 1; p < end; ++p) {
+                if (p + AMCOM_LZSS_MIN_MATCH <= inputSize) {
+                    uint8_t hash = AMCOM_LzssHash(&in[p]);
+                    state.prev[p] = state.head[hash];
+                    state.head[hash] = (uint8_t)(p + 1);
+                }
+            }
+            pos += bestLength;
+        } else {
+            if (out >= outputCapacity) {
+                return 0;
+            }
+            output[out++] = in[pos++];
+        }
+        flagBit++;
+    }
+
+    return out;
+}
+
+bool AMCOM_Decompress(const void* input, size_t inputSize, uint8_t* output, size_t outputCapacity, size_t* outputSize) {
+    assert(input || inputSize == 0);
+    assert(output && outputSize);
+
+    const uint8_t* in = (const uint8_t*)input;
+    size_t pos = 0;
+    size_t out = 0;
+
+    while (pos < inputSize) {
+        uint8_t flags = in[pos++];
+        for (int bit = 0; bit < 8 && pos < inputSize; ++bit) {
+            if (flags & (1u << bit)) {
+                if (pos + 2 > inputSize) {
+                    return false;
+                }
+                size_t offset = in[pos] + 1u;
+                size_t length = in[pos + 1] + (size_t)AMCOM_LZSS_MIN_MATCH;
+                pos += 2;
+                if (offset > out || out + length > outputCapacity) {
+                    return false;
+                }
+                // byte by byte: the source may overlap the destination
+                for (size_t i = 0; i < length; ++i, ++out) {
+                    output[out] = output[out - offset];
+                }
+            } else {
+                if (out >= outputCapacity) {
+                    return false;
+                }
+                output[out++] = in[pos++];
+            }
+        }
+    }
+
+    *outputSize = out;
+    return true;
+}
+
+size_t AMCOM_SerializeCompressed(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer) {
+    if (!destinationBuffer || payloadSize > AMCOM_MAX_PAYLOAD_SIZE) {
+        return 0;
+    }
+
+    uint8_t compressed[AMCOM_MAX_PAYLOAD_SIZE];
+    compressed[0] = packetType;
+    // only accept output that is shorter than the original payload (including the TYPE byte)
+    size_t capacity = (payloadSize > 2) ? payloadSize - 2 : 0;
+    size_t size = (capacity > 0) ? AMCOM_Compress(payload, payloadSize, &compressed[1], capacity) : 0;
+    if (size == 0) {
+        return AMCOM_Serialize(packetType, payload, payloadSize, destinationBuffer);
+    }
+    return AMCOM_Serialize(AMCOM_COMPRESSED_PACKET_TYPE, compressed, size + 1, destinationBuffer);
+}
+
+void AMCOM_InitDecompressor(AMCOM_Decompressor* decompressor, AMCOM_PacketHandler packetHandlerCallback, void* userContext) {
+    assert(decompressor != NULL);
+    decompressor->packetHandler = packetHandlerCallback;
+    decompressor->userContext   = userContext;
+    decompressor->errors        = 0;
+}
+
+void AMCOM_DecompressPacket(const AMCOM_Packet* packet, void* decompressor) {
+    assert(packet && decompressor);
+    AMCOM_Decompressor* d = (AMCOM_Decompressor*)decompressor;
+
+    if (packet->header.type != AMCOM_COMPRESSED_PACKET_TYPE) {
+        if (d->packetHandler) {
+            d->packetHandler(packet, d->userContext);
+        }
+        return;
+    }
+
+    size_t size;
+    if (packet->header.length < 1
+        || !AMCOM_Decompress(&packet->payload[1], packet->header.length - 1u,
+                             d->packet.payload, sizeof(d->packet.payload), &size)) {
+        d->errors++;
+        return;
+    }
+
+    d->packet.header.sop    = packet->header.sop;
+    d->packet.header.type   = packet->payload[0];
+    d->packet.header.length = (uint8_t)size;
+    d->packet.header.crc    = packet->header.crc;
+    if (d->packetHandler) {
+        d->packetHandler(&d->packet, d->userContext);
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef AMCOM_COMPRESS_H_
+#define AMCOM_COMPRESS_H_
+
+/**
+ * This header file defines the API of the optional AMCOM payload compression.
+ *
+ * Payloads are compressed with a small LZSS codec. Each packet is compressed independently, so a lost
+ * packet never prevents the following ones from being decompressed. A compressed packet has the
+ * @ref AMCOM_COMPRESSED_PACKET_TYPE type and the following payload:
+ *
+ * +--------+--------------------------------------------------------------------------------------+
+ * | TYPE   | COMPRESSED DATA                                                                      |
+ * | 1B     | 1..199B                                                                              |
+ * +--------+--------------------------------------------------------------------------------------+
+ *
+ * TYPE - type of the original packet.
+ *
+ * The compressed data is a sequence of groups, each starting with a flag byte followed by up to eight items.
+ * Bit n of the flag byte (LSB first) describes item n: 0 - one literal byte, 1 - a two-byte match
+ * (OFFSET-1, LENGTH-3) copying LENGTH bytes starting OFFSET bytes back in the already decoded data.
+ *
+ * AMCOM_Compress uses 560 bytes of stack (measured with gcc -O2 -fstack-usage), most of it the 456-byte match
+ * table, and no static memory. The decompressor needs no buffers of its own.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Structure describing the packet decompressor */
+typedef struct {
+	/// Place to store the decompressed packet
+	AMCOM_Packet packet;
+	/// User-defined packet handler (callback)
+	AMCOM_PacketHandler packetHandler;
+	/// User-defined context
+	void* userContext;
+	/// Number of compressed packets that could not be decompressed
+	uint32_t errors;
+} AMCOM_Decompressor;
+
+/**
+ * @brief Compresses a block of data.
+ *
+ * @param input data to compress
+ * @param inputSize number of bytes to compress (0..AMCOM_MAX_PAYLOAD_SIZE)
+ * @param output place to store the compressed data
+ * @param outputCapacity size of the output buffer
+ * @return number of bytes of compressed data or 0 if it does not fit into the output buffer
+ */
+size_t AMCOM_Compress(const void* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+
+/**
+ * @brief Decompresses a block of data.
+ *
+ * @param input compressed data
+ * @param inputSize number of bytes of compressed data
+ * @param output place to store the decompressed data
+ * @param outputCapacity size of the output buffer
+ * @param outputSize place to store the number of decompressed bytes
+ * @return true if the data was decompressed, false if it is malformed or does not fit into the output buffer
+ */
+bool AMCOM_Decompress(const void* input, size_t inputSize, uint8_t* output, size_t outputCapacity, size_t* outputSize);
+
+/**
+ * @brief Serializes the packet, compressing the payload if it pays off
+ *
+ * The packet is serialized as an @ref AMCOM_COMPRESSED_PACKET_TYPE packet if that makes it shorter,
+ * otherwise it is serialized exactly like with @ref AMCOM_Serialize.
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ * @param destinationBuffer place to store the packet bytes (must be large enough!)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_SerializeCompressed(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer);
+
+/**
+ * @brief Initializes the packet decompressor.
+ *
+ * @param decompressor pointer to the decompressor structure
+ * @param packetHandlerCallback callback function that will be called with each (decompressed) packet
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ */
+void AMCOM_InitDecompressor(AMCOM_Decompressor* decompressor, AMCOM_PacketHandler packetHandlerCallback, void* userContext);
+
+/**
+ * @brief Feeds a received packet to the decompressor.
+ *
+ * Compressed packets are decompressed and passed to the packet handler with the original type and payload
+ * (the CRC field is that of the compressed frame). Other packets are passed through unchanged. This function
+ * has the @ref AMCOM_PacketHandler signature, so it can be used directly as the receiver handler.
+ * @param packet received packet
+ * @param decompressor pointer to the decompressor structure
+ */
+void AMCOM_DecompressPacket(const AMCOM_Packet* packet, void* decompressor);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_COMPRESS_H_ */
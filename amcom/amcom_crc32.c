@@ -0,0 +1,293 @@
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "amcom_crc32.h"
+
+#ifdef AMCOM_CRC32_HARDWARE
+#include "stm32f4xx.h"
+#endif
+
+/// Start of the CRC-32 frame
+static const uint8_t AMCOM_CRC32_SOP = 0xA2;
+/// Start of packet character reported in the delivered packets
+static const uint8_t AMCOM_CRC32_PACKET_SOP = 0xA1;
+
+/// Result of checking the frame buffer
+typedef enum {
+    /// Frame is not complete yet
+    AMCOM_CRC32_FRAME_INCOMPLETE = 0,
+    /// Frame is complete and valid
+    AMCOM_CRC32_FRAME_VALID,
+    /// Frame is invalid (bad length or CRC)
+    AMCOM_CRC32_FRAME_INVALID
+} AMCOM_Crc32FrameResult;
+
+#ifdef AMCOM_CRC32_HARDWARE
+
+void AMCOM_InitCRC32(void) {
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    // dummy read-back: the clock is running when the register write has completed
+    (void)RCC->AHB1ENR;
+}
+
+/** Feeds the header word and the payload words to the CRC unit. */
+static uint32_t AMCOM_CRC32Packet(uint32_t headerWord, const uint8_t* data, size_t dataSize) {
+    CRC->CR = CRC_CR_RESET;
+    CRC->DR = headerWord;
+    // Cortex-M4 loads unaligned words in a single instruction, so memcpy compiles to a plain LDR
+    for (; dataSize >= 4; data += 4, dataSize -= 4) {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        CRC->DR = word;
+    }
+    if (dataSize) {
+        uint32_t word = 0;
+        memcpy(&word, data, dataSize);
+        CRC->DR = word;
+    }
+    return CRC->DR;
+}
+
+#else
+
+/// Generator polynomial of the CRC unit
+static const uint32_t AMCOM_CRC32_POLYNOMIAL = 0x04C11DB7;
+
+/// Slicing-by-8 lookup tables (table k advances the CRC by a byte followed by k zero bytes)
+static uint32_t AMCOM_CRC32Table[8][256];
+/// Flag stating if the tables are built
+static bool AMCOM_CRC32TableReady = false;
+
+void AMCOM_InitCRC32(void) {
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t crc = n << 24;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80000000u) ? ((crc << 1) ^ AMCOM_CRC32_POLYNOMIAL) : (crc << 1);
+        }
+        AMCOM_CRC32Table[0][n] = crc;
+    }
+    for (uint32_t n = 0; n < 256; ++n) {
+        for (int k = 1; k < 8; ++k) {
+            uint32_t crc = AMCOM_CRC32Table[k - 1][n];
+            AMCOM_CRC32Table[k][n] = (crc << 8) ^ AMCOM_CRC32Table[0][crc >> 24];
+        }
+    }
+    AMCOM_CRC32TableReady = true;
+}
+
+/** Loads a little-endian word (independent of the host byte order). */
+static uint32_t AMCOM_LoadWord(const uint8_t* data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/** Advances the CRC by one word, most significant byte first (as the CRC unit does). */
+static uint32_t AMCOM_CRC32Word(uint32_t crc, uint32_t word) {
+    crc ^= word;
+    return AMCOM_CRC32Table[3][crc >> 24] ^ AMCOM_CRC32Table[2][(crc >> 16) & 0xFF]
+         ^ AMCOM_CRC32Table[1][(crc >> 8) & 0xFF] ^ AMCOM_CRC32Table[0][crc & 0xFF];
+}
+
+/** Calculates the CRC of the header word and the payload words, two words per step. */
+static uint32_t AMCOM_CRC32Packet(uint32_t headerWord, const uint8_t* data, size_t dataSize) {
+    uint32_t crc = AMCOM_CRC32Word(0xFFFFFFFFu, headerWord);
+    for (; dataSize >= 8; data += 8, dataSize -= 8) {
+        uint32_t lo = crc ^ AMCOM_LoadWord(data);
+        uint32_t hi = AMCOM_LoadWord(data + 4);
+        crc = AMCOM_CRC32Table[7][lo >> 24] ^ AMCOM_CRC32Table[6][(lo >> 16) & 0xFF]
+            ^ AMCOM_CRC32Table[5][(lo >> 8) & 0xFF] ^ AMCOM_CRC32Table[4][lo & 0xFF]
+            ^ AMCOM_CRC32Table[3][hi >> 24] ^ AMCOM_CRC32Table[2][(hi >> 16) & 0xFF]
+            ^ AMCOM_CRC32Table[1][(hi >> 8) & 0xFF] ^ AMCOM_CRC32Table[0][hi & 0xFF];
+    }
+    if (dataSize >= 4) {
+        crc = AMCOM_CRC32Word(crc, AMCOM_LoadWord(data));
+        data += 4;
+        dataSize -= 4;
+    }
+    if (dataSize) {
+        uint8_t last[4] = { 0 };
+        memcpy(last, data, dataSize);
+        crc = AMCOM_CRC32Word(crc, AMCOM_LoadWord(last));
+    }
+    return crc;
+}
+
+#endif
+
+uint32_t AMCOM_CalculateCRC32(uint8_t packetType, const void* payload, size_t payloadSize) {
+#ifndef AMCOM_CRC32_HARDWARE
+    assert(AMCOM_CRC32TableReady);
+#endif
+    uint32_t headerWord = (uint32_t)packetType | ((uint32_t)(uint8_t)payloadSize << 8);
+    if (!payload) {
+        payloadSize = 0;
+    }
+    return AMCOM_CRC32Packet(headerWord, (const uint8_t*)payload, payloadSize);
+}
+
+size_t AMCOM_Crc32Serialize(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer) {
+    if (!destinationBuffer || payloadSize > AMCOM_MAX_PAYLOAD_SIZE || (!payload && payloadSize)) {
+        return 0;
+    }
+
+    uint32_t crc = AMCOM_CalculateCRC32(packetType, payload, payloadSize);
+    uint8_t* p = destinationBuffer;
+    *p++ = AMCOM_CRC32_SOP;
+    *p++ = packetType;
+    *p++ = (uint8_t)payloadSize;
+    for (int i = 0; i < 4; ++i) {
+        *p++ = (uint8_t)(crc >> (8 * i));
+    }
+
+    if (payloadSize) {
+        memcpy(p, payload, payloadSize);
+        p += payloadSize;
+    }
+
+    return (size_t)(p - destinationBuffer);
+}
+
+void AMCOM_InitCrc32Receiver(AMCOM_Crc32Receiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext) {
+    assert(receiver != NULL);
+    receiver->frameBytes    = 0;
+    receiver->packetHandler = packetHandlerCallback;
+    receiver->userContext   = userContext;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+/** Returns the number of bytes still missing in the frame buffer. */
+static size_t AMCOM_Crc32MissingBytes(const AMCOM_Crc32Receiver* receiver) {
+    if (receiver->frameBytes < AMCOM_CRC32_HEADER_SIZE) {
+        // header bytes are taken one by one, so an invalid LENGTH is caught at once
+        return 1;
+    }
+    return AMCOM_CRC32_HEADER_SIZE + receiver->frame[2] - receiver->frameBytes;
+}
+
+/** Checks the frame buffer after new bytes were added. */
+static AMCOM_Crc32FrameResult AMCOM_Crc32CheckFrame(AMCOM_Crc32Receiver* receiver) {
+    const uint8_t* frame = receiver->frame;
+    if (receiver->frameBytes == 3 && frame[2] > AMCOM_MAX_PAYLOAD_SIZE) {
+        receiver->stats.lengthErrors++;
+        return AMCOM_CRC32_FRAME_INVALID;
+    }
+    if (receiver->frameBytes < AMCOM_CRC32_HEADER_SIZE ||
+        receiver->frameBytes < (size_t)AMCOM_CRC32_HEADER_SIZE + frame[2]) {
+        return AMCOM_CRC32_FRAME_INCOMPLETE;
+    }
+
+    uint32_t crc = (uint32_t)frame[3] | ((uint32_t)frame[4] << 8) | ((uint32_t)frame[5] << 16) | ((uint32_t)frame[6] << 24);
+    if (crc != AMCOM_CalculateCRC32(frame[1], &frame[AMCOM_CRC32_HEADER_SIZE], frame[2])) {
+        receiver->stats.crcErrors++;
+        return AMCOM_CRC32_FRAME_INVALID;
+    }
+    return AMCOM_CRC32_FRAME_VALID;
+}
+
+/** Copies the valid frame to the packet and calls the user handler. The frame buffer is left intact. */
+static void AMCOM_Crc32DispatchFrame(AMCOM_Crc32Receiver* receiver) {
+    uint8_t length = receiver->frame[2];
+    receiver->frameBytes = 0;
+
+    receiver->receivedPacket.header.sop    = AMCOM_CRC32_PACKET_SOP;
+    receiver->receivedPacket.header.type   = receiver->frame[1];
+    receiver->receivedPacket.header.length = length;
+    receiver->receivedPacket.header.crc    = 0;
+    memcpy(receiver->receivedPacket.payload, &receiver->frame[AMCOM_CRC32_HEADER_SIZE], length);
+
+    receiver->stats.packetsOk++;
+    receiver->stats.payloadBytes += length;
+    if (length > receiver->stats.maxPayloadSize) {
+        receiver->stats.maxPayloadSize = length;
+    }
+    if (receiver->packetHandler) {
+        receiver->packetHandler(&receiver->receivedPacket, receiver->userContext);
+    }
+}
+
+/**
+ * Rejects the buffered frame and rescans the bytes following its (false) SOP.
+ *
+ * As in @ref AMCOM_Deserialize, the frame buffer is used as the history: whenever a SOP is found, the
+ * remaining history is moved to the front of the buffer, so the bytes are rescanned in place.
+ */
+static void AMCOM_Crc32RejectFrame(AMCOM_Crc32Receiver* receiver) {
+    uint8_t* frame = receiver->frame;
+    size_t end = receiver->frameBytes;
+    size_t pos = 1;
+
+    receiver->stats.bytesDiscarded++;
+    receiver->frameBytes = 0;
+    while (pos < end) {
+        if (receiver->frameBytes == 0) {
+            const uint8_t* sop = (const uint8_t*)memchr(&frame[pos], AMCOM_CRC32_SOP, end - pos);
+            if (!sop) {
+                receiver->stats.bytesDiscarded += (uint32_t)(end - pos);
+                return;
+            }
+            receiver->stats.bytesDiscarded += (uint32_t)(sop - &frame[pos]);
+            end -= (size_t)(sop - frame);
+            memmove(frame, sop, end);
+            pos = 0;
+        }
+
+        // the bytes to take are already in place (pos == frameBytes)
+        size_t run = AMCOM_Crc32MissingBytes(receiver);
+        if (run > end - pos) {
+            run = end - pos;
+        }
+        receiver->frameBytes += run;
+        pos += run;
+
+        switch (AMCOM_Crc32CheckFrame(receiver)) {
+        case AMCOM_CRC32_FRAME_VALID:
+            AMCOM_Crc32DispatchFrame(receiver);
+            break;
+        case AMCOM_CRC32_FRAME_INVALID:
+            receiver->stats.bytesDiscarded++;
+            receiver->frameBytes = 0;
+            pos = 1;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void AMCOM_Crc32Deserialize(AMCOM_Crc32Receiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t i = 0;
+
+    receiver->stats.bytesReceived += (uint32_t)dataSize;
+    while (i < dataSize) {
+        if (receiver->frameBytes == 0) {
+            const uint8_t* sop = (const uint8_t*)memchr(&bytes[i], AMCOM_CRC32_SOP, dataSize - i);
+            size_t skipped = sop ? (size_t)(sop - &bytes[i]) : (dataSize - i);
+            receiver->stats.bytesDiscarded += (uint32_t)skipped;
+            i += skipped;
+            if (!sop) {
+                break;
+            }
+        }
+
+        // the payload is copied in runs, the CRC is checked once the frame is complete
+        size_t run = AMCOM_Crc32MissingBytes(receiver);
+        if (run > dataSize - i) {
+            run = dataSize - i;
+        }
+        memcpy(&receiver->frame[receiver->frameBytes], &bytes[i], run);
+        receiver->frameBytes += run;
+        i += run;
+
+        switch (AMCOM_Crc32CheckFrame(receiver)) {
+        case AMCOM_CRC32_FRAME_VALID:
+            AMCOM_Crc32DispatchFrame(receiver);
+            break;
+        case AMCOM_CRC32_FRAME_INVALID:
+            AMCOM_Crc32RejectFrame(receiver);
+            break;
+        default:
+            break;
+        }
+    }
+}
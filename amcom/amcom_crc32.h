@@ -0,0 +1,118 @@
+#ifndef AMCOM_CRC32_H_
+#define AMCOM_CRC32_H_
+
+/**
+ * This header file defines the API of the CRC-32 variant of AMCOM.
+ *
+ * The frame has the same structure as the regular AMCOM packet, but starts with its own SOP and carries
+ * a four-byte CRC-32:
+ *
+ * +--------+--------+--------+-----------------------------------+--------------------------------------+
+ * | SOP    | TYPE   | LENGTH | CRC32                             | PAYLOAD                              |
+ * | 1B     | 1B     | 1B     | 4B                                | 0..200B                              |
+ * +--------+--------+--------+-----------------------------------+--------------------------------------+
+ * <----- size of header is 7 bytes ------------------------------>
+ *
+ * SOP - always 0xA2, so the variant can never be mistaken for a regular packet.
+ * CRC32 - checksum of the packet. Encoding: little-endian (LSB first).
+ *
+ * The CRC-32 is defined the way the CRC calculation unit of the STM32F4 computes it: polynomial 0x04C11DB7,
+ * initial value 0xFFFFFFFF, no reflection and no final XOR, fed with 32-bit words, most significant bit first.
+ * The words are:
+ * - TYPE | (LENGTH << 8) (the two upper bytes are zero),
+ * - the payload loaded as little-endian words, with the last word padded with zeros.
+ *
+ * The calculation is done by the CRC unit when the library is built with AMCOM_CRC32_HARDWARE defined
+ * (STM32F4 target, requires the CMSIS device header), and by a slicing-by-8 table implementation otherwise.
+ * Both give the same results, see tools/amcom_crc32_check.c. The CRC unit is a single shared peripheral:
+ * do not calculate CRCs from an interrupt and the main loop at the same time.
+ *
+ * Received packets are delivered through the regular @ref AMCOM_PacketHandler, with the SOP field set to 0xA1
+ * and the CRC field set to 0.
+ */
+
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+	/// Size of the CRC-32 frame header
+	AMCOM_CRC32_HEADER_SIZE = 7,
+	/// Maximum size of the whole CRC-32 frame
+	AMCOM_CRC32_MAX_FRAME_SIZE = (AMCOM_CRC32_HEADER_SIZE + AMCOM_MAX_PAYLOAD_SIZE)
+};
+
+/** Structure describing the CRC-32 frame receiver */
+typedef struct {
+	/// Place to store the received packet
+	AMCOM_Packet receivedPacket;
+	/// Raw bytes of the frame being received (kept for rescanning after a rejected frame)
+	uint8_t frame[AMCOM_CRC32_MAX_FRAME_SIZE];
+	/// Number of bytes in the frame buffer (0 - hunting for SOP)
+	size_t frameBytes;
+	/// User-defined packet handler (callback)
+	AMCOM_PacketHandler packetHandler;
+	/// User-defined context
+	void* userContext;
+	/// Link statistics
+	AMCOM_ReceiverStats stats;
+} AMCOM_Crc32Receiver;
+
+/**
+ * @brief Prepares the CRC-32 calculation (enables the clock of the CRC unit or builds the lookup tables).
+ *
+ * Must be called once before any other function of this module.
+ */
+void AMCOM_InitCRC32(void);
+
+/**
+ * @brief Calculates the CRC-32 of the packet
+ *
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ *
+ * @return CRC-32 of the packet
+ */
+uint32_t AMCOM_CalculateCRC32(uint8_t packetType, const void* payload, size_t payloadSize);
+
+/**
+ * @brief Serializes the packet as a CRC-32 frame
+ *
+ * In case of invalid input arguments, this function shall not write anything to the destinationBuffer and return 0.
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ * @param destinationBuffer place to store the frame bytes (at least @ref AMCOM_CRC32_MAX_FRAME_SIZE bytes)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_Crc32Serialize(uint8_t packetType, const void* payload, size_t payloadSize, uint8_t* destinationBuffer);
+
+/**
+ * @brief Initializes the CRC-32 frame receiver.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param packetHandlerCallback callback function that will be called each time a packet is received
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ */
+void AMCOM_InitCrc32Receiver(AMCOM_Crc32Receiver* receiver, AMCOM_PacketHandler packetHandlerCallback, void* userContext);
+
+/**
+ * @brief Deserializes the chunk of data, searching for valid CRC-32 frames
+ *
+ * The CRC is checked once per frame, when its last byte arrives. Like @ref AMCOM_Deserialize, the bytes of
+ * a rejected frame are rescanned, so a frame starting inside a corrupted one is not lost.
+ * @param receiver pointer to the receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_Crc32Deserialize(AMCOM_Crc32Receiver* receiver, const void* data, size_t dataSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_CRC32_H_ */
@@ -0,0 +1,35 @@
+#include <stddef.h>
+#include <assert.h>
+#include "amcom_dispatcher.h"
+
+void AMCOM_InitDispatcher(AMCOM_Dispatcher* dispatcher, AMCOM_PacketHandler defaultHandler, void* defaultContext) {
+    assert(dispatcher != NULL);
+    dispatcher->defaultEntry.handler     = defaultHandler;
+    dispatcher->defaultEntry.userContext = defaultContext;
+    for (size_t i = 0; i < 256; ++i) {
+        dispatcher->entries[i] = dispatcher->defaultEntry;
+    }
+}
+
+void AMCOM_RegisterHandler(AMCOM_Dispatcher* dispatcher, uint8_t packetType, AMCOM_PacketHandler handler, void* userContext) {
+    assert(dispatcher != NULL);
+    if (handler == NULL) {
+        AMCOM_UnregisterHandler(dispatcher, packetType);
+        return;
+    }
+    dispatcher->entries[packetType].handler     = handler;
+    dispatcher->entries[packetType].userContext = userContext;
+}
+
+void AMCOM_UnregisterHandler(AMCOM_Dispatcher* dispatcher, uint8_t packetType) {
+    assert(dispatcher != NULL);
+    dispatcher->entries[packetType] = dispatcher->defaultEntry;
+}
+
+void AMCOM_Dispatch(const AMCOM_Packet* packet, void* dispatcher) {
+    assert(packet && dispatcher);
+    const AMCOM_DispatchEntry* entry = &((const AMCOM_Dispatcher*)dispatcher)->entries[packet->header.type];
+    if (entry->handler) {
+        entry->handler(packet, entry->userContext);
+    }
+}
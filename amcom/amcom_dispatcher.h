@@ -0,0 +1,203 @@
+#ifndef AMCOM_DISPATCHER_H_
+#define AMCOM_DISPATCHER_H_
+
+/**
+ * This header file defines the API of the AMCOM packet dispatcher.
+ *
+ * The dispatcher replaces the usual `switch (packet->header.type)` inside a single @ref AMCOM_PacketHandler
+ * with a 256-entry table indexed by the packet type. Every entry holds a handler and its own user context.
+ * Types without a registered handler are routed to the default handler, so dispatching a packet costs one
+ * indexed load and one call regardless of the number of registered types.
+ *
+ * Typical usage:
+ *
+ *     AMCOM_Dispatcher dispatcher;
+ *     AMCOM_InitDispatcher(&dispatcher, unknownPacketHandler, NULL);
+ *     AMCOM_RegisterHandler(&dispatcher, MY_STATUS_TYPE, statusHandler, &statusContext);
+ *     AMCOM_InitReceiver(&receiver, AMCOM_Dispatch, &dispatcher);
+ */
+
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Single entry of the dispatch table */
+typedef struct {
+	/// Handler called for packets of the given type
+	AMCOM_PacketHandler handler;
+	/// User-defined context passed to the handler
+	void* userContext;
+} AMCOM_DispatchEntry;
+
+/** Structure describing the AMCOM packet dispatcher */
+typedef struct {
+	/// Dispatch table indexed by the packet type
+	AMCOM_DispatchEntry entries[256];
+	/// Entry used for types that have no handler registered
+	AMCOM_DispatchEntry defaultEntry;
+} AMCOM_Dispatcher;
+
+/**
+ * @brief Initializes the AMCOM packet dispatcher.
+ *
+ * All packet types are routed to the default handler until a dedicated handler is registered.
+ * @param dispatcher pointer to the AMCOM dispatcher structure
+ * @param defaultHandler handler called for packets of unregistered types (may be NULL to ignore them)
+ * @param defaultContext user defined context passed to the default handler
+ */
+void AMCOM_InitDispatcher(AMCOM_Dispatcher* dispatcher, AMCOM_PacketHandler defaultHandler, void* defaultContext);
+
+/**
+ * @brief Registers a handler for the given packet type.
+ *
+ * Registering a handler for a type that already has one replaces the previous handler. Registering NULL
+ * is the same as @ref AMCOM_UnregisterHandler: the packets of the type go to the default handler again.
+ * @param dispatcher pointer to the AMCOM dispatcher structure
+ * @param packetType type of packets that shall be routed to the handler
+ * @param handler handler to be called (NULL to route the type to the default handler)
+ * @param userContext user defined context passed to the handler
+ */
+void AMCOM_RegisterHandler(AMCOM_Dispatcher* dispatcher, uint8_t packetType, AMCOM_PacketHandler handler, void* userContext);
+
+/**
+ * @brief Unregisters the handler of the given packet type.
+ *
+ * Packets of this type will be routed to the default handler again.
+ * @param dispatcher pointer to the AMCOM dispatcher structure
+ * @param packetType packet type to unregister
+ */
+void AMCOM_UnregisterHandler(AMCOM_Dispatcher* dispatcher, uint8_t packetType);
+
+/**
+ * @brief Routes the packet to the handler registered for its type.
+ *
+ * This function has the @ref AMCOM_PacketHandler signature, so it can be passed directly to
+ * @ref AMCOM_InitReceiver with the dispatcher as the user context.
+ * @param packet packet to dispatch
+ * @param dispatcher pointer to the AMCOM dispatcher structure
+ */
+void AMCOM_Dispatch(const AMCOM_Packet* packet, void* dispatcher);
+
+#ifdef __cplusplus
+} // extern "C"
+
+namespace amcom {
+
+namespace detail {
+
+/** Checks that no packet type is listed twice. */
+template <uint8_t... Types>
+constexpr bool uniqueTypes() {
+	const uint8_t types[] = { Types..., 0 };
+	for (size_t i = 0; i < sizeof...(Types); ++i) {
+		for (size_t j = 0; j < i; ++j) {
+			if (types[i] == types[j]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Calls the handler (a direct call the compiler can inline). A nullptr handler passes the packet to the
+ * fallback handler instead; if that is nullptr as well, the packet is ignored.
+ */
+template <AMCOM_PacketHandler Handler, AMCOM_PacketHandler Fallback = nullptr>
+struct Invoke {
+	static void call(const AMCOM_Packet* packet, void* userContext) {
+		Handler(packet, userContext);
+	}
+};
+
+template <AMCOM_PacketHandler Fallback>
+struct Invoke<nullptr, Fallback> {
+	static void call(const AMCOM_Packet* packet, void* userContext) {
+		Invoke<Fallback>::call(packet, userContext);
+	}
+};
+
+template <>
+struct Invoke<nullptr, nullptr> {
+	static void call(const AMCOM_Packet*, void*) {}
+};
+
+} // namespace detail
+
+/**
+ * Compile-time route of a single packet type to a handler.
+ *
+ * @tparam Type packet type
+ * @tparam Handler handler called for packets of this type (nullptr passes them to the default handler)
+ */
+template <uint8_t Type, AMCOM_PacketHandler Handler>
+struct Route {
+	static constexpr uint8_t type = Type;
+	static constexpr AMCOM_PacketHandler handler = Handler;
+
+	/** Calls the handler, or the fallback handler if the handler is nullptr. */
+	template <AMCOM_PacketHandler Fallback>
+	static void call(const AMCOM_Packet* packet, void* userContext) {
+		detail::Invoke<Handler, Fallback>::call(packet, userContext);
+	}
+};
+
+/**
+ * Dispatcher whose routes are resolved at compile time.
+ *
+ * The routes expand into a chain of comparisons against constant types, each followed by a direct call of
+ * its handler, so the handlers are inlined into @ref dispatch, as in a hand-written switch. No RAM and no
+ * initialization is needed. For a few routes the comparisons cost less than the indirect call of a table;
+ * for many routes (or routes added at run time) use @ref AMCOM_Dispatcher, whose cost does not grow with
+ * the number of routes. All handlers share the context passed to @ref dispatch, which has the
+ * @ref AMCOM_PacketHandler signature.
+ *
+ *     using MyDispatcher = amcom::StaticDispatcher<onUnknown,
+ *                                                  amcom::Route<0x01, onStatus>,
+ *                                                  amcom::Route<0x02, onCommand>>;
+ *     AMCOM_InitReceiver(&receiver, MyDispatcher::dispatch, &context);
+ *
+ * @tparam Default handler called for packet types that have no route (may be nullptr to ignore them)
+ * @tparam Routes list of @ref Route types, at most one per packet type
+ */
+template <AMCOM_PacketHandler Default, typename... Routes>
+class StaticDispatcher {
+	static_assert(detail::uniqueTypes<Routes::type...>(), "a packet type may have one route only");
+
+	/** Calls the handler of the first route matching the type, or the default handler. */
+	template <typename... Rest>
+	struct Select {
+		static void call(uint8_t, const AMCOM_Packet* packet, void* userContext) {
+			detail::Invoke<Default>::call(packet, userContext);
+		}
+	};
+
+	template <typename First, typename... Rest>
+	struct Select<First, Rest...> {
+		static void call(uint8_t type, const AMCOM_Packet* packet, void* userContext) {
+			if (type == First::type) {
+				First::template call<Default>(packet, userContext);
+			} else {
+				Select<Rest...>::call(type, packet, userContext);
+			}
+		}
+	};
+
+public:
+	/**
+	 * Routes the packet to the handler of its type.
+	 * @param packet packet to dispatch
+	 * @param userContext user defined context passed to the handler
+	 */
+	static void dispatch(const AMCOM_Packet* packet, void* userContext) {
+		Select<Routes...>::call(packet->header.type, packet, userContext);
+	}
+};
+
+} // namespace amcom
+
+#endif // __cplusplus
+
+#endif /* AMCOM_DISPATCHER_H_ */
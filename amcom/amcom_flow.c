@@ -0,0 +1,261 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_flow.h"
+
+/// Start of packet character (frame boundaries of the outgoing stream are tracked by it)
+static const uint8_t AMCOM_FLOW_PACKET_SOP = 0xA1;
+
+enum {
+    /// Size of the frame header the tracker needs to know the frame size (SOP, TYPE, LENGTH)
+    AMCOM_FLOW_FRAME_HEADER_SIZE = 3,
+    /// Part of the receive buffer left for the credit packets of the peer, which do not wait for credit
+    AMCOM_FLOW_RESERVE = AMCOM_FLOW_RESERVED_CREDITS * AMCOM_FLOW_CREDIT_PACKET_SIZE
+};
+
+static_assert(AMCOM_FLOW_RESERVE + AMCOM_MAX_PACKET_SIZE <= AMCOM_FLOW_MAX_BUFFER_SIZE,
+              "AMCOM_FLOW_RESERVED_CREDITS is too large");
+
+static void AMCOM_FlowPutU16(uint8_t* dest, uint16_t value) {
+    dest[0] = (uint8_t)(value & 0xFF);
+    dest[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t AMCOM_FlowGetU16(const uint8_t* src) {
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+/** Advances the stream position of the transmit side by bytes written to the link. */
+static void AMCOM_FlowSent(AMCOM_Flow* flow, size_t written) {
+    flow->txNext = (uint16_t)(flow->txNext + written);
+    size_t total = flow->txTotal + written;
+    flow->txTotal = (uint16_t)((total > AMCOM_FLOW_MAX_BUFFER_SIZE) ? AMCOM_FLOW_MAX_BUFFER_SIZE : total);
+}
+
+/**
+ * Advances the frame tracker over bytes of the outgoing stream, stopping at the end of a frame.
+ * A byte that does not start a frame (no SOP) is a frame of its own.
+ * @return number of bytes passed
+ */
+static size_t AMCOM_FlowTrack(AMCOM_Flow* flow, const uint8_t* data, size_t dataSize) {
+    size_t i = 0;
+    while (i < dataSize) {
+        if (flow->frameHeaderSize < AMCOM_FLOW_FRAME_HEADER_SIZE) {
+            uint8_t b = data[i++];
+            if (flow->frameHeaderSize == 0 && b != AMCOM_FLOW_PACKET_SOP) {
+                return i;
+            }
+            if (++flow->frameHeaderSize < AMCOM_FLOW_FRAME_HEADER_SIZE) {
+                continue;
+            }
+            // an invalid LENGTH is rejected by the receiver right away, so the frame ends with it
+            flow->frameRemaining = (b <= AMCOM_MAX_PAYLOAD_SIZE) ? sizeof(uint16_t) + b : 0;
+        } else {
+            size_t n = dataSize - i;
+            if (n > flow->frameRemaining) {
+                n = flow->frameRemaining;
+            }
+            i += n;
+            flow->frameRemaining -= n;
+        }
+        if (flow->frameRemaining == 0) {
+            flow->frameHeaderSize = 0;
+            return i;
+        }
+    }
+    return i;
+}
+
+/** Returns the number of bytes of the frame starting at data (the worst case while its LENGTH is not known). */
+static size_t AMCOM_FlowFrameSize(const uint8_t* data, size_t dataSize) {
+    if (data[0] != AMCOM_FLOW_PACKET_SOP) {
+        return 1;
+    }
+    if (dataSize < AMCOM_FLOW_FRAME_HEADER_SIZE) {
+        return AMCOM_MAX_PACKET_SIZE;
+    }
+    uint8_t length = data[AMCOM_FLOW_FRAME_HEADER_SIZE - 1];
+    return (length <= AMCOM_MAX_PAYLOAD_SIZE) ? sizeof(AMCOM_PacketHeader) + length : AMCOM_FLOW_FRAME_HEADER_SIZE;
+}
+
+/**
+ * Checks if a credit packet is due (on request, periodically, or when the reader has consumed a quarter of the
+ * window) and the peer has room for it. A credit packet that tells the peer something new may go past the
+ * window into the reserve, as long as the credit packets already there leave room for it; the reserve is
+ * freed by a credit packet of the peer that shows it has read them. A repeat waits for room in the window,
+ * so the credit packets of a peer whose reader stalls cannot overrun it.
+ */
+static bool AMCOM_FlowCreditDue(const AMCOM_Flow* flow) {
+    int16_t available = (int16_t)(flow->txLimit - flow->txNext);
+    bool news = flow->creditPending || flow->rxNext != flow->rxAnnounced;
+    if (available < (int16_t)AMCOM_FLOW_CREDIT_PACKET_SIZE
+        && (!news || available + AMCOM_FLOW_RESERVE < (int16_t)AMCOM_FLOW_CREDIT_PACKET_SIZE)) {
+        return false;
+    }
+    return flow->creditPending
+        || flow->getTicks() - flow->lastCreditTime >= AMCOM_FLOW_CREDIT_INTERVAL_MS
+        || (uint16_t)(flow->rxNext - flow->rxAnnounced) >= flow->rxWindow / 4;
+}
+
+/** Prepares the credit packet. Its POSITION is the stream position of its first byte. */
+static void AMCOM_FlowBuildCredit(AMCOM_Flow* flow) {
+    uint8_t payload[AMCOM_FLOW_CREDIT_SIZE];
+    AMCOM_FlowPutU16(payload, flow->rxNext);
+    AMCOM_FlowPutU16(payload + 2, flow->rxWindow);
+    AMCOM_FlowPutU16(payload + 4, flow->txNext);
+    AMCOM_Serialize(AMCOM_FLOW_CREDIT_PACKET_TYPE, payload, sizeof(payload), flow->credit);
+    flow->creditOffset = 0;
+    flow->rxAnnounced = flow->rxNext;
+    flow->creditPending = false;
+    flow->lastCreditTime = flow->getTicks();
+    flow->stats.creditsSent++;
+}
+
+/**
+ * Writes the credit packet, preparing one first if it is due. Must be called between frames only.
+ * @param written place to add the number of bytes written to
+ * @return true if no credit packet is left incomplete
+ */
+static bool AMCOM_FlowSendCredit(AMCOM_Flow* flow, size_t* written) {
+    if (flow->creditOffset == AMCOM_FLOW_CREDIT_PACKET_SIZE && AMCOM_FlowCreditDue(flow)) {
+        AMCOM_FlowBuildCredit(flow);
+    }
+    while (flow->creditOffset < AMCOM_FLOW_CREDIT_PACKET_SIZE) {
+        size_t n = flow->write(flow->credit + flow->creditOffset, AMCOM_FLOW_CREDIT_PACKET_SIZE - flow->creditOffset,
+                               flow->writeContext);
+        if (n == 0) {
+            return false;
+        }
+        flow->creditOffset += n;
+        *written += n;
+        AMCOM_FlowSent(flow, n);
+    }
+    return true;
+}
+
+bool AMCOM_InitFlow(AMCOM_Flow* flow, AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks,
+                    size_t rxBufferSize) {
+    assert(flow && write && getTicks);
+    if (rxBufferSize < AMCOM_FLOW_RESERVE + AMCOM_MAX_PACKET_SIZE || rxBufferSize > AMCOM_FLOW_MAX_BUFFER_SIZE) {
+        return false;
+    }
+
+    memset(flow, 0, sizeof(*flow));
+    flow->write = write;
+    flow->writeContext = writeContext;
+    flow->getTicks = getTicks;
+    flow->rxWindow = (uint16_t)(rxBufferSize - AMCOM_FLOW_RESERVE);
+    flow->creditOffset = AMCOM_FLOW_CREDIT_PACKET_SIZE;
+    flow->creditPending = true;
+    flow->lastCreditTime = getTicks();
+    return true;
+}
+
+size_t AMCOM_FlowWrite(const void* data, size_t dataSize, void* context) {
+    AMCOM_Flow* flow = (AMCOM_Flow*)context;
+    assert(flow && (data || dataSize == 0));
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t total = 0;
+
+    while (total < dataSize) {
+        if (flow->frameHeaderSize == 0) {
+            size_t credit = 0;
+            if (!AMCOM_FlowSendCredit(flow, &credit)) {
+                break;
+            }
+            // a frame is started only if it fits, so it never waits for credit half-written
+            int16_t available = (int16_t)(flow->txLimit - flow->txNext);
+            if (available < (int16_t)AMCOM_FlowFrameSize(bytes + total, dataSize - total)) {
+                flow->stats.windowStalls++;
+                break;
+            }
+        }
+
+        // write up to the end of the frame, so a due credit packet can follow it
+        uint8_t headerSize = flow->frameHeaderSize;
+        size_t remaining = flow->frameRemaining;
+        size_t span = AMCOM_FlowTrack(flow, bytes + total, dataSize - total);
+        flow->frameHeaderSize = headerSize;
+        flow->frameRemaining = remaining;
+
+        size_t written = flow->write(bytes + total, span, flow->writeContext);
+        AMCOM_FlowTrack(flow, bytes + total, written);
+        AMCOM_FlowSent(flow, written);
+        total += written;
+        if (written < span) {
+            break;
+        }
+    }
+    return total;
+}
+
+void AMCOM_FlowDeserialize(AMCOM_Flow* flow, AMCOM_Receiver* receiver, const void* data, size_t dataSize) {
+    assert(flow && receiver && (data || dataSize == 0));
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t offset = 0, consumed;
+    const AMCOM_Packet* packet;
+
+    // the position is advanced packet by packet, so a credit packet finds it exactly at its own end
+    while ((packet = AMCOM_Parse(receiver, bytes + offset, dataSize - offset, &consumed)) != NULL) {
+        offset += consumed;
+        flow->rxNext = (uint16_t)(flow->rxNext + consumed);
+        if (receiver->packetHandler) {
+            receiver->packetHandler(packet, receiver->userContext);
+        }
+    }
+    flow->rxNext = (uint16_t)(flow->rxNext + consumed);
+}
+
+void AMCOM_FlowHandlePacket(const AMCOM_Packet* packet, void* context) {
+    AMCOM_Flow* flow = (AMCOM_Flow*)context;
+    assert(packet && flow);
+    if (packet->header.type != AMCOM_FLOW_CREDIT_PACKET_TYPE || packet->header.length != AMCOM_FLOW_CREDIT_SIZE) {
+        return;
+    }
+    uint16_t peerNext = AMCOM_FlowGetU16(packet->payload);
+    uint16_t peerWindow = AMCOM_FlowGetU16(packet->payload + 2);
+    uint16_t peerPosition = AMCOM_FlowGetU16(packet->payload + 4);
+    flow->stats.creditsReceived++;
+
+    // Receive side: continue from the position the peer has sent up to. Bytes lost on the wire would
+    // otherwise hold their credit forever; a restarted peer starts counting anew.
+    uint16_t position = (uint16_t)(peerPosition + AMCOM_FLOW_CREDIT_PACKET_SIZE);
+    int16_t lost = (int16_t)(position - flow->rxNext);
+    if (lost > 0) {
+        // the peer cannot send more than the buffer takes between two credit packets, unless it has restarted
+        if ((size_t)lost <= (size_t)flow->rxWindow + AMCOM_FLOW_RESERVE) {
+            flow->stats.bytesLost += (uint32_t)lost;
+        }
+        flow->creditPending = true;
+    }
+    flow->rxNext = position;
+
+    // Transmit side: the peer cannot have read more than was sent. Such a credit comes from before a restart
+    // of either end and is ignored until the peer adopts the position of the next credit packet sent.
+    // Until then nothing is known about the buffer of the peer, so only the reserve is used, for the credit
+    // packet that passes the position to the peer.
+    uint16_t inFlight = (uint16_t)(flow->txNext - peerNext);
+    if (inFlight > flow->txTotal) {
+        flow->stats.staleCredits++;
+        flow->txLimit = flow->txNext;
+        flow->creditPending = true;
+        return;
+    }
+    if (peerWindow > AMCOM_FLOW_MAX_BUFFER_SIZE) {
+        peerWindow = AMCOM_FLOW_MAX_BUFFER_SIZE;
+    }
+    flow->txLimit = (uint16_t)(peerNext + peerWindow);
+}
+
+size_t AMCOM_FlowPoll(AMCOM_Flow* flow) {
+    assert(flow);
+    size_t written = 0;
+    if (flow->frameHeaderSize == 0) {
+        AMCOM_FlowSendCredit(flow, &written);
+    }
+    return written;
+}
+
+void AMCOM_GetFlowStats(const AMCOM_Flow* flow, AMCOM_FlowStats* stats) {
+    assert(flow && stats);
+    *stats = flow->stats;
+}
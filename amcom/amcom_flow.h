@@ -0,0 +1,196 @@
+#ifndef AMCOM_FLOW_H_
+#define AMCOM_FLOW_H_
+
+/**
+ * This header file defines the API of the AMCOM link flow control.
+ *
+ * The flow control keeps a sender from overrunning the receive buffer of the peer (e.g. the USART receive
+ * ring, which otherwise drops bytes in the middle of frames when the application does not read fast enough).
+ * Both ends count the bytes of the link in stream positions (modulo 2^16):
+ *
+ * - the receiver announces in credit packets the position of the next byte it will read (NEXT) and the
+ *   number of bytes it can take beyond it (WINDOW, the receive buffer size less a reserve),
+ * - the sender starts a frame only if all of its bytes fit below NEXT + WINDOW, so a frame never stalls
+ *   half-written for lack of credit,
+ * - credit packets do not wait for the frames; when the window is used up, a credit packet that carries news
+ *   (a new NEXT or POSITION) goes into the reserve, which leaves room for @ref AMCOM_FLOW_RESERVED_CREDITS of
+ *   them in the peer buffer until a credit packet of the peer shows that they have been read.
+ *
+ * Payload of the @ref AMCOM_FLOW_CREDIT_PACKET_TYPE packet:
+ *
+ * +-----------------+-----------------+-----------------+
+ * | NEXT            | WINDOW          | POSITION        |
+ * | 2B              | 2B              | 2B              |
+ * +-----------------+-----------------+-----------------+
+ *
+ * POSITION - stream position of the credit packet itself at its sender. The receiver of the credit packet
+ * adopts it, so bytes lost on the wire (or a restart of the peer) do not shrink the window for good. A credit
+ * packet that claims more bytes received than were sent (e.g. a stale one after a restart) is ignored.
+ * All fields are little-endian.
+ *
+ * Credit packets are sent when the reader has consumed a quarter of the window since the last one and at
+ * least every @ref AMCOM_FLOW_CREDIT_INTERVAL_MS (a repeat of the last one only if it fits in the window, so
+ * that a credit packet lost on the wire is made up for), always between two frames of the outgoing stream.
+ *
+ * Typical usage:
+ *
+ *     AMCOM_InitFlow(&flow, usartWrite, NULL, msGetTicks, USART_RX_BUFFER_SIZE);
+ *     AMCOM_RegisterHandler(&dispatcher, AMCOM_FLOW_CREDIT_PACKET_TYPE, AMCOM_FlowHandlePacket, &flow);
+ *     AMCOM_InitScheduler(&scheduler, AMCOM_FlowWrite, &flow, ...); // or any other user of AMCOM_WriteFunction
+ *     ...
+ *     n = USART_ReadData(buffer, sizeof(buffer));
+ *     AMCOM_FlowDeserialize(&flow, &receiver, buffer, n); // instead of AMCOM_Deserialize
+ *     AMCOM_FlowPoll(&flow);
+ *
+ * All bytes read from the receive buffer must go through @ref AMCOM_FlowDeserialize and all bytes sent
+ * through @ref AMCOM_FlowWrite, since both ends count them. The flow control is not reentrant.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_FLOW_CREDIT_INTERVAL_MS
+/// Longest interval between two credit packets [ms]
+#define AMCOM_FLOW_CREDIT_INTERVAL_MS		100
+#endif
+
+#ifndef AMCOM_FLOW_RESERVED_CREDITS
+/// Number of credit packets the window leaves room for in the receive buffer
+#define AMCOM_FLOW_RESERVED_CREDITS			4
+#endif
+
+enum {
+	/// Size of the credit packet payload
+	AMCOM_FLOW_CREDIT_SIZE = 6,
+	/// Size of the whole credit packet
+	AMCOM_FLOW_CREDIT_PACKET_SIZE = (sizeof(AMCOM_PacketHeader) + AMCOM_FLOW_CREDIT_SIZE),
+	/// Maximum size of the receive buffer (half of the stream position space)
+	AMCOM_FLOW_MAX_BUFFER_SIZE = 0x7FFF
+};
+
+/** Statistics of the flow control */
+typedef struct {
+	/// Number of credit packets sent
+	uint32_t creditsSent;
+	/// Number of credit packets received
+	uint32_t creditsReceived;
+	/// Number of credit packets ignored because they did not match the sent stream
+	uint32_t staleCredits;
+	/// Number of bytes the peer sent that were lost on the wire
+	uint32_t bytesLost;
+	/// Number of times a frame had to wait for credit
+	uint32_t windowStalls;
+} AMCOM_FlowStats;
+
+/** Structure describing the flow control of a link */
+typedef struct {
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// User-defined context of the write function
+	void* writeContext;
+	/// Function returning the current time in milliseconds
+	AMCOM_TickFunction getTicks;
+	/// Window announced to the peer (receive buffer size less the reserve)
+	uint16_t rxWindow;
+	/// Stream position of the next byte to be read
+	uint16_t rxNext;
+	/// NEXT of the last credit packet sent
+	uint16_t rxAnnounced;
+	/// Stream position of the next byte to be sent
+	uint16_t txNext;
+	/// Stream position up to which the peer has granted credit
+	uint16_t txLimit;
+	/// Number of bytes sent since the initialization (saturated at AMCOM_FLOW_MAX_BUFFER_SIZE)
+	uint16_t txTotal;
+	/// Number of header bytes (SOP, TYPE, LENGTH) of the outgoing frame written so far, 0 between frames
+	uint8_t frameHeaderSize;
+	/// Number of bytes left to the end of the outgoing frame once its header is complete
+	size_t frameRemaining;
+	/// Flag stating if a credit packet shall be sent as soon as possible
+	bool creditPending;
+	/// Time of the last credit packet
+	uint64_t lastCreditTime;
+	/// Credit packet being written
+	uint8_t credit[AMCOM_FLOW_CREDIT_PACKET_SIZE];
+	/// Number of bytes of the credit packet already written (AMCOM_FLOW_CREDIT_PACKET_SIZE if none pending)
+	size_t creditOffset;
+	/// Statistics
+	AMCOM_FlowStats stats;
+} AMCOM_Flow;
+
+/**
+ * @brief Initializes the flow control of a link.
+ *
+ * Nothing is sent until the first credit packet of the peer arrives.
+ * @param flow pointer to the flow control structure
+ * @param write function writing bytes to the link (e.g. USART_WriteData)
+ * @param writeContext user defined context of the write function
+ * @param getTicks function returning the current time in milliseconds
+ * @param rxBufferSize size of the local receive buffer (e.g. USART_RX_BUFFER_SIZE)
+ * @return true if all arguments are valid, false if the buffer is too small for a frame and the reserve or
+ *         larger than @ref AMCOM_FLOW_MAX_BUFFER_SIZE
+ */
+bool AMCOM_InitFlow(AMCOM_Flow* flow, AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks,
+		size_t rxBufferSize);
+
+/**
+ * @brief Writes whole frames as long as the peer has credit for them.
+ *
+ * This function has the @ref AMCOM_WriteFunction signature, so it can be used by every layer that writes
+ * through one (scheduler, multiplexer, RPC, ...). Pending credit packets are sent first.
+ * @param data frames to send (a frame may also be continued from a previous call)
+ * @param dataSize number of bytes to send
+ * @param flow pointer to the flow control structure
+ * @return number of bytes accepted, ending at a frame boundary unless the write function took fewer bytes
+ */
+size_t AMCOM_FlowWrite(const void* data, size_t dataSize, void* flow);
+
+/**
+ * @brief Deserializes bytes read from the receive buffer, keeping the stream position exact.
+ *
+ * Works like @ref AMCOM_Deserialize (the packet handler of the receiver is called for every packet) and
+ * returns the bytes to the credit of the peer.
+ * @param flow pointer to the flow control structure
+ * @param receiver receiver of the link
+ * @param data bytes read from the receive buffer
+ * @param dataSize number of bytes
+ */
+void AMCOM_FlowDeserialize(AMCOM_Flow* flow, AMCOM_Receiver* receiver, const void* data, size_t dataSize);
+
+/**
+ * @brief Processes a received credit packet.
+ *
+ * This function has the @ref AMCOM_PacketHandler signature, so it can be registered with the dispatcher for
+ * @ref AMCOM_FLOW_CREDIT_PACKET_TYPE. Other packets are ignored. The packet must come from
+ * @ref AMCOM_FlowDeserialize of the same flow control.
+ * @param packet received packet
+ * @param flow pointer to the flow control structure
+ */
+void AMCOM_FlowHandlePacket(const AMCOM_Packet* packet, void* flow);
+
+/**
+ * @brief Sends a credit packet when one is due and the outgoing stream is between frames.
+ *
+ * Call it from the main loop, so credit is returned even when nothing else is sent.
+ * @param flow pointer to the flow control structure
+ * @return number of bytes accepted by the write function
+ */
+size_t AMCOM_FlowPoll(AMCOM_Flow* flow);
+
+/**
+ * @brief Takes a snapshot of the flow control statistics.
+ *
+ * @param flow pointer to the flow control structure
+ * @param stats place to store the statistics
+ */
+void AMCOM_GetFlowStats(const AMCOM_Flow* flow, AMCOM_FlowStats* stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_FLOW_H_ */
@@ -0,0 +1,227 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_fragment.h"
+
+/// Largest message that can be described by the 16-bit COUNT field
+static const size_t AMCOM_FRAGMENT_MAX_MESSAGE_SIZE = 65535u * AMCOM_FRAGMENT_MAX_DATA_SIZE;
+
+/**
+ * Decodes the sub-header of a fragment packet.
+ *
+ * @return true if the packet is a well-formed fragment, false otherwise
+ */
+static bool AMCOM_ParseFragment(const AMCOM_Packet* packet, AMCOM_FragmentHeader* header) {
+    if (packet->header.type != AMCOM_FRAGMENT_PACKET_TYPE || packet->header.length < sizeof(AMCOM_FragmentHeader)) {
+        return false;
+    }
+    const uint8_t* p = packet->payload;
+    header->type      = p[0];
+    header->messageId = p[1];
+    header->index     = (uint16_t)(p[2] | ((uint16_t)p[3] << 8));
+    header->count     = (uint16_t)(p[4] | ((uint16_t)p[5] << 8));
+
+    // all fragments but the last one must be full
+    size_t dataSize = packet->header.length - sizeof(AMCOM_FragmentHeader);
+    return (header->count > 0)
+        && (header->index < header->count)
+        && (header->index + 1 == header->count || dataSize == AMCOM_FRAGMENT_MAX_DATA_SIZE);
+}
+
+size_t AMCOM_GetFragmentCount(size_t messageSize) {
+    if (messageSize > AMCOM_FRAGMENT_MAX_MESSAGE_SIZE) {
+        return 0;
+    }
+    if (messageSize == 0) {
+        return 1;
+    }
+    return (messageSize + AMCOM_FRAGMENT_MAX_DATA_SIZE - 1) / AMCOM_FRAGMENT_MAX_DATA_SIZE;
+}
+
+size_t AMCOM_SerializeFragment(uint8_t packetType, uint8_t messageId, const void* message, size_t messageSize,
+                               size_t fragmentIndex, uint8_t* destinationBuffer) {
+    size_t count = AMCOM_GetFragmentCount(messageSize);
+    if (!destinationBuffer || count == 0 || fragmentIndex >= count || (!message && messageSize)) {
+        return 0;
+    }
+
+    size_t offset = fragmentIndex * AMCOM_FRAGMENT_MAX_DATA_SIZE;
+    size_t dataSize = messageSize - offset;
+    if (dataSize > AMCOM_FRAGMENT_MAX_DATA_SIZE) {
+        dataSize = AMCOM_FRAGMENT_MAX_DATA_SIZE;
+    }
+
+    uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+    payload[0] = packetType;
+    payload[1] = messageId;
+    payload[2] = (uint8_t)(fragmentIndex & 0xFF);
+    payload[3] = (uint8_t)(fragmentIndex >> 8);
+    payload[4] = (uint8_t)(count & 0xFF);
+    payload[5] = (uint8_t)(count >> 8);
+    if (dataSize) {
+        memcpy(&payload[sizeof(AMCOM_FragmentHeader)], (const uint8_t*)message + offset, dataSize);
+    }
+
+    return AMCOM_Serialize(AMCOM_FRAGMENT_PACKET_TYPE, payload, sizeof(AMCOM_FragmentHeader) + dataSize, destinationBuffer);
+}
+
+bool AMCOM_InitReassembler(AMCOM_Reassembler* reassembler, AMCOM_ReassemblySlot* slots, size_t slotCount,
+                           uint8_t* pool, size_t poolSize, AMCOM_MessageHandler messageHandlerCallback, void* userContext) {
+    assert(reassembler);
+    assert(slots && slotCount > 0);
+    assert(pool && poolSize >= slotCount);
+
+    if (!reassembler || !slots || slotCount == 0 || !pool || poolSize < slotCount) {
+        return false;
+    }
+
+    size_t slotCapacity = poolSize / slotCount;
+    for (size_t i = 0; i < slotCount; ++i) {
+        slots[i].inUse    = false;
+        slots[i].buffer   = pool + i * slotCapacity;
+        slots[i].capacity = slotCapacity;
+    }
+    reassembler->slots           = slots;
+    reassembler->slotCount       = slotCount;
+    reassembler->messageHandler  = messageHandlerCallback;
+    reassembler->userContext     = userContext;
+    reassembler->fragmentCounter = 0;
+    reassembler->droppedMessages = 0;
+    return true;
+}
+
+void AMCOM_Reassemble(const AMCOM_Packet* packet, void* reassembler) {
+    assert(packet && reassembler);
+    AMCOM_Reassembler* r = (AMCOM_Reassembler*)reassembler;
+
+    AMCOM_FragmentHeader header;
+    if (!AMCOM_ParseFragment(packet, &header)) {
+        return;
+    }
+
+    // look for the slot of this message (and for a free or the stalest one, in case this is the first fragment)
+    AMCOM_ReassemblySlot* slot = NULL;
+    AMCOM_ReassemblySlot* freeSlot = NULL;
+    AMCOM_ReassemblySlot* stalestSlot = NULL;
+    for (size_t i = 0; i < r->slotCount; ++i) {
+        AMCOM_ReassemblySlot* s = &r->slots[i];
+        if (s->inUse && s->type == header.type && s->messageId == header.messageId) {
+            slot = s;
+        } else if (!s->inUse) {
+            if (!freeSlot) {
+                freeSlot = s;
+            }
+        } else if (!stalestSlot
+                   || (uint32_t)(r->fragmentCounter - s->lastFragment)
+                      > (uint32_t)(r->fragmentCounter - stalestSlot->lastFragment)) {
+            stalestSlot = s;
+        }
+    }
+
+    if (header.index == 0) {
+        if ((size_t)(header.count - 1) * AMCOM_FRAGMENT_MAX_DATA_SIZE > r->slots[0].capacity) {
+            // the message cannot fit into any slot, so do not evict one for it
+            if (slot) {
+                slot->inUse = false;
+                r->droppedMessages++;
+            }
+            r->droppedMessages++;
+            return;
+        }
+        if (!slot) {
+            slot = freeSlot;
+        }
+        if (!slot) {
+            // the stalest message has most likely lost its last fragment
+            slot = stalestSlot;
+        }
+        if (slot->inUse) {
+            // a message that was never completed
+            r->droppedMessages++;
+        }
+        slot->inUse     = true;
+        slot->type      = header.type;
+        slot->messageId = header.messageId;
+        slot->count     = header.count;
+        slot->nextIndex = 0;
+        slot->size      = 0;
+    } else if (!slot) {
+        // the beginning of the message was lost or dropped already
+        return;
+    }
+
+    size_t dataSize = packet->header.length - sizeof(AMCOM_FragmentHeader);
+    if (header.index != slot->nextIndex || header.count != slot->count || slot->size + dataSize > slot->capacity) {
+        slot->inUse = false;
+        r->droppedMessages++;
+        return;
+    }
+
+    memcpy(slot->buffer + slot->size, &packet->payload[sizeof(AMCOM_FragmentHeader)], dataSize);
+    slot->size += dataSize;
+    slot->nextIndex++;
+    slot->lastFragment = ++r->fragmentCounter;
+
+    if (slot->nextIndex == slot->count) {
+        slot->inUse = false;
+        if (r->messageHandler) {
+            r->messageHandler(slot->type, slot->buffer, slot->size, r->userContext);
+        }
+    }
+}
+
+void AMCOM_InitFragmentStream(AMCOM_FragmentStream* stream, AMCOM_FragmentHandler fragmentHandlerCallback,
+                              AMCOM_FragmentAbortHandler abortHandlerCallback, void* userContext) {
+    assert(stream != NULL);
+    stream->active          = false;
+    stream->fragmentHandler = fragmentHandlerCallback;
+    stream->abortHandler    = abortHandlerCallback;
+    stream->userContext     = userContext;
+}
+
+/** Aborts the message being streamed (if any). */
+static void AMCOM_AbortStream(AMCOM_FragmentStream* stream) {
+    if (stream->active) {
+        stream->active = false;
+        if (stream->abortHandler) {
+            stream->abortHandler(stream->type, stream->messageId, stream->userContext);
+        }
+    }
+}
+
+void AMCOM_StreamFragment(const AMCOM_Packet* packet, void* stream) {
+    assert(packet && stream);
+    AMCOM_FragmentStream* s = (AMCOM_FragmentStream*)stream;
+
+    AMCOM_FragmentHeader header;
+    if (!AMCOM_ParseFragment(packet, &header)) {
+        return;
+    }
+
+    if (header.index == 0) {
+        AMCOM_AbortStream(s);
+        s->active    = true;
+        s->type      = header.type;
+        s->messageId = header.messageId;
+        s->count     = header.count;
+        s->nextIndex = 0;
+        s->offset    = 0;
+    } else if (!s->active) {
+        return;
+    } else if (header.type != s->type || header.messageId != s->messageId
+               || header.count != s->count || header.index != s->nextIndex) {
+        AMCOM_AbortStream(s);
+        return;
+    }
+
+    size_t dataSize = packet->header.length - sizeof(AMCOM_FragmentHeader);
+    bool isLast = (header.index + 1 == header.count);
+    if (isLast) {
+        s->active = false;
+    }
+    if (s->fragmentHandler) {
+        s->fragmentHandler(header.type, header.messageId, s->offset,
+                           &packet->payload[sizeof(AMCOM_FragmentHeader)], dataSize, isLast, s->userContext);
+    }
+    s->offset += dataSize;
+    s->nextIndex++;
+}
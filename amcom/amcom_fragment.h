@@ -0,0 +1,217 @@
+#ifndef AMCOM_FRAGMENT_H_
+#define AMCOM_FRAGMENT_H_
+
+/**
+ * This header file defines the API of the optional AMCOM fragmentation layer, which transfers messages
+ * larger than @ref AMCOM_MAX_PAYLOAD_SIZE as a series of @ref AMCOM_FRAGMENT_PACKET_TYPE packets.
+ *
+ * The payload of each fragment packet starts with a sub-header:
+ *
+ * +--------+--------+--------+--------+--------+--------+-----------------------------------------+
+ * | TYPE   | MSG ID | INDEX           | COUNT           | DATA                                    |
+ * | 1B     | 1B     | 2B              | 2B              | 0..194B                                 |
+ * +--------+--------+--------+--------+--------+--------+-----------------------------------------+
+ *
+ * TYPE - type of the fragmented message (application defined).
+ * MSG ID - identifier distinguishing consecutive messages of the same type.
+ * INDEX - index of the fragment (0..COUNT-1). Encoding: little-endian.
+ * COUNT - number of fragments in the message (1..65535). Encoding: little-endian.
+ *
+ * Every fragment except the last one carries exactly @ref AMCOM_FRAGMENT_MAX_DATA_SIZE bytes of data.
+ * Fragments are expected in order (AMCOM links do not reorder packets); a missing fragment aborts the message.
+ *
+ * Two receiving variants are provided:
+ * - @ref AMCOM_Reassembler buffers whole messages in a bounded pool and delivers them once complete,
+ * - @ref AMCOM_FragmentStream delivers the fragments in order as they arrive, without buffering the message.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Structure defining the fragment sub-header */
+typedef struct AMPACKED {
+	uint8_t type;       ///< Type of the fragmented message
+	uint8_t messageId;  ///< Message identifier
+	uint16_t index;     ///< Fragment index
+	uint16_t count;     ///< Number of fragments in the message
+} AMCOM_FragmentHeader;
+
+// static assertion to check that the fragment header structure is indeed packed
+static_assert(6 == sizeof(AMCOM_FragmentHeader), "6 != sizeof(AMCOM_FragmentHeader)");
+
+enum {
+	/// Maximum number of message bytes carried by a single fragment
+	AMCOM_FRAGMENT_MAX_DATA_SIZE = (AMCOM_MAX_PAYLOAD_SIZE - sizeof(AMCOM_FragmentHeader))
+};
+
+/** Structure describing a single reassembly slot */
+typedef struct {
+	/// Flag stating if the slot holds a message being reassembled
+	bool inUse;
+	/// Type of the message
+	uint8_t type;
+	/// Identifier of the message
+	uint8_t messageId;
+	/// Number of fragments in the message
+	uint16_t count;
+	/// Index of the next expected fragment
+	uint16_t nextIndex;
+	/// Number of message bytes collected so far
+	size_t size;
+	/// Memory for the message data (part of the reassembler pool)
+	uint8_t* buffer;
+	/// Size of the buffer
+	size_t capacity;
+	/// Value of the fragment counter of the reassembler when the slot last took a fragment
+	uint32_t lastFragment;
+} AMCOM_ReassemblySlot;
+
+/** Structure describing the message reassembler */
+typedef struct {
+	/// Reassembly slots (one per message reassembled concurrently)
+	AMCOM_ReassemblySlot* slots;
+	/// Number of slots
+	size_t slotCount;
+	/// User-defined message handler (callback)
+	AMCOM_MessageHandler messageHandler;
+	/// User-defined context
+	void* userContext;
+	/// Number of fragments taken by the slots so far (the age of a slot is measured in fragments)
+	uint32_t fragmentCounter;
+	/// Number of messages dropped (evicted, message too large or missing fragment)
+	uint32_t droppedMessages;
+} AMCOM_Reassembler;
+
+/**
+ * Type describing a callback function that will be called for each in-order fragment of a streamed message.
+ *
+ * @param packetType type of the message
+ * @param messageId identifier of the message
+ * @param offset offset of the data within the message
+ * @param data fragment data
+ * @param dataSize number of bytes in the fragment data
+ * @param isLast true if this is the last fragment of the message
+ * @param userContext user defined context associated with the stream
+ */
+typedef void (*AMCOM_FragmentHandler)(uint8_t packetType, uint8_t messageId, size_t offset, const uint8_t* data,
+                                      size_t dataSize, bool isLast, void* userContext);
+
+/**
+ * Type describing a callback function that will be called when a streamed message is aborted
+ * (a fragment was lost or a new message started before the previous one was complete).
+ *
+ * @param packetType type of the message
+ * @param messageId identifier of the message
+ * @param userContext user defined context associated with the stream
+ */
+typedef void (*AMCOM_FragmentAbortHandler)(uint8_t packetType, uint8_t messageId, void* userContext);
+
+/** Structure describing the streaming fragment receiver */
+typedef struct {
+	/// Flag stating if a message is being received
+	bool active;
+	/// Type of the message
+	uint8_t type;
+	/// Identifier of the message
+	uint8_t messageId;
+	/// Number of fragments in the message
+	uint16_t count;
+	/// Index of the next expected fragment
+	uint16_t nextIndex;
+	/// Offset of the next expected data byte
+	size_t offset;
+	/// User-defined fragment handler (callback)
+	AMCOM_FragmentHandler fragmentHandler;
+	/// User-defined abort handler (callback, optional)
+	AMCOM_FragmentAbortHandler abortHandler;
+	/// User-defined context
+	void* userContext;
+} AMCOM_FragmentStream;
+
+/**
+ * @brief Returns the number of fragments needed to transfer a message.
+ *
+ * @param messageSize number of bytes in the message
+ * @return number of fragments or 0 if the message is too large to be fragmented
+ */
+size_t AMCOM_GetFragmentCount(size_t messageSize);
+
+/**
+ * @brief Serializes a single fragment of a message
+ *
+ * This function serializes the fragment with the given index as a complete AMCOM packet of the
+ * @ref AMCOM_FRAGMENT_PACKET_TYPE type. The sender shall call it for indices 0..count-1, where count
+ * is returned by @ref AMCOM_GetFragmentCount. In case of invalid input arguments, this function shall
+ * not write anything to the destinationBuffer and return 0.
+ * @param packetType type of the message
+ * @param messageId identifier of the message
+ * @param message pointer to the message data (may be NULL if messageSize is 0)
+ * @param messageSize number of bytes in the message
+ * @param fragmentIndex index of the fragment to serialize
+ * @param destinationBuffer place to store the packet bytes (at least @ref AMCOM_MAX_PACKET_SIZE bytes)
+ *
+ * @return number of bytes written to the destinationBuffer
+ */
+size_t AMCOM_SerializeFragment(uint8_t packetType, uint8_t messageId, const void* message, size_t messageSize,
+                               size_t fragmentIndex, uint8_t* destinationBuffer);
+
+/**
+ * @brief Initializes the message reassembler.
+ *
+ * The memory pool is split evenly between the slots, so the largest message that can be reassembled
+ * is poolSize / slotCount bytes and at most slotCount messages can be reassembled concurrently. When a
+ * message starts and no slot is free, the slot that has gone longest without a fragment is reused and its
+ * message is dropped, so messages whose last fragment was lost do not hold their slots for good.
+ * @param reassembler pointer to the reassembler structure
+ * @param slots array of reassembly slots
+ * @param slotCount number of slots in the array
+ * @param pool memory pool for the message data
+ * @param poolSize size of the memory pool in bytes
+ * @param messageHandlerCallback callback function that will be called each time a message is reassembled
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ * @return true if all arguments are valid and the reassembler is initialized successfully, false otherwise
+ */
+bool AMCOM_InitReassembler(AMCOM_Reassembler* reassembler, AMCOM_ReassemblySlot* slots, size_t slotCount,
+                           uint8_t* pool, size_t poolSize, AMCOM_MessageHandler messageHandlerCallback, void* userContext);
+
+/**
+ * @brief Feeds a received packet to the reassembler.
+ *
+ * Packets of types other than @ref AMCOM_FRAGMENT_PACKET_TYPE are ignored. This function has the
+ * @ref AMCOM_PacketHandler signature, so it can be used directly as a receiver or dispatcher handler.
+ * @param packet received packet
+ * @param reassembler pointer to the reassembler structure
+ */
+void AMCOM_Reassemble(const AMCOM_Packet* packet, void* reassembler);
+
+/**
+ * @brief Initializes the streaming fragment receiver.
+ *
+ * @param stream pointer to the stream structure
+ * @param fragmentHandlerCallback callback function that will be called for each in-order fragment
+ * @param abortHandlerCallback callback function that will be called when a message is aborted (may be NULL)
+ * @param userContext user defined, general purpose context, that will be fed back to the callback functions
+ */
+void AMCOM_InitFragmentStream(AMCOM_FragmentStream* stream, AMCOM_FragmentHandler fragmentHandlerCallback,
+                              AMCOM_FragmentAbortHandler abortHandlerCallback, void* userContext);
+
+/**
+ * @brief Feeds a received packet to the streaming fragment receiver.
+ *
+ * Packets of types other than @ref AMCOM_FRAGMENT_PACKET_TYPE are ignored. Fragments are delivered only
+ * in order, starting from index 0; after a lost fragment the rest of the message is skipped. This function
+ * has the @ref AMCOM_PacketHandler signature.
+ * @param packet received packet
+ * @param stream pointer to the stream structure
+ */
+void AMCOM_StreamFragment(const AMCOM_Packet* packet, void* stream);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_FRAGMENT_H_ */
@@ -0,0 +1,72 @@
+#ifndef AMCOM_MESSAGE_H_
+#define AMCOM_MESSAGE_H_
+
+/**
+ * This header file provides typed AMCOM messages generated from a small schema description.
+ *
+ * A message is described by a list of fields (an "X-macro") and defined with @ref AMCOM_DEFINE_MESSAGE:
+ *
+ *     #define MOTOR_STATUS_FIELDS(FIELD)   \
+ *         FIELD(uint16_t, rpm)             \
+ *         FIELD(int16_t,  current)         \
+ *         FIELD(uint8_t,  flags)
+ *
+ *     AMCOM_DEFINE_MESSAGE(MotorStatus, 0x10, MOTOR_STATUS_FIELDS)
+ *
+ * which generates:
+ * - `MotorStatus` - packed structure with the given fields, which is also the wire format of the payload,
+ * - `MotorStatus_TYPE` and `MotorStatus_SIZE` - packet type and payload size,
+ * - `MotorStatus_Serialize(const MotorStatus*, uint8_t*)` - serializes the message as a complete packet,
+ * - `MotorStatus_View(const AMCOM_Packet*)` - returns a typed view of a received packet's payload,
+ *   or NULL if the packet type or length do not match (checked with a single comparison).
+ *
+ * The sizes are checked at compile time. Multi-byte fields are little-endian on the wire, which matches the
+ * memory layout of the supported targets (checked at compile time as well), so no per-field conversion is needed.
+ * Fields shall be scalar types or other packed structures.
+ */
+
+#include "amcom.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error "AMCOM typed messages require a little-endian target"
+#endif
+
+/// Expands a schema field into a structure member
+#define AMCOM_MESSAGE_FIELD(fieldType, fieldName)			fieldType fieldName;
+
+/// Expands a schema field into its size on the wire
+#define AMCOM_MESSAGE_FIELD_SIZE(fieldType, fieldName)		+ sizeof(fieldType)
+
+/**
+ * Defines a typed message.
+ *
+ * @param name name of the generated structure (also used as the prefix of the generated functions)
+ * @param packetType type of the packet carrying the message
+ * @param FIELDS X-macro listing the fields as FIELD(type, name)
+ */
+#define AMCOM_DEFINE_MESSAGE(name, packetType, FIELDS)												\
+	typedef struct AMPACKED {																		\
+		FIELDS(AMCOM_MESSAGE_FIELD)																	\
+	} name;																							\
+																									\
+	enum {																							\
+		name##_TYPE = (packetType),																	\
+		name##_SIZE = (0 FIELDS(AMCOM_MESSAGE_FIELD_SIZE))											\
+	};																								\
+																									\
+	static_assert((packetType) >= 0 && (packetType) <= 255, #name ": invalid packet type");			\
+	static_assert(name##_SIZE == sizeof(name), #name ": structure is not packed");					\
+	static_assert((int)name##_SIZE <= (int)AMCOM_MAX_PAYLOAD_SIZE, #name ": message does not fit into a packet");	\
+																									\
+	static inline size_t name##_Serialize(const name* message, uint8_t* destinationBuffer) {		\
+		return AMCOM_Serialize(name##_TYPE, message, name##_SIZE, destinationBuffer);				\
+	}																								\
+																									\
+	static inline const name* name##_View(const AMCOM_Packet* packet) {							\
+		uint16_t typeAndLength = (uint16_t)((packet->header.type << 8) | packet->header.length);	\
+		return (typeAndLength == ((name##_TYPE << 8) | name##_SIZE))								\
+			? (const name*)packet->payload															\
+			: NULL;																					\
+	}
+
+#endif /* AMCOM_MESSAGE_H_ */
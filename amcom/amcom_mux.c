@@ -0,0 +1,259 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_mux.h"
+
+enum {
+    /// Size of the stream position in front of the data
+    AMCOM_MUX_OFFSET_SIZE = 2,
+    /// Size of one entry of the credit packet
+    AMCOM_MUX_CREDIT_ENTRY_SIZE = 5
+};
+
+static_assert(AMCOM_MUX_CHANNELS * AMCOM_MUX_CREDIT_ENTRY_SIZE <= AMCOM_MAX_PAYLOAD_SIZE,
+              "credit packet must fit into one AMCOM packet");
+
+static void AMCOM_MuxPutU16(uint8_t* dest, uint16_t value) {
+    dest[0] = (uint8_t)(value & 0xFF);
+    dest[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t AMCOM_MuxGetU16(const uint8_t* src) {
+    return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+/** Returns the credit limit the receive side of the channel can announce now. */
+static uint16_t AMCOM_MuxRxLimit(const AMCOM_MuxChannel* channel) {
+    size_t free = RingBuffer_GetCapacity(&channel->rx) - RingBuffer_GetLen(&channel->rx);
+    return (uint16_t)(channel->rxNext + free);
+}
+
+/** Checks if a credit update is due: periodically, or when a channel has freed a quarter of its receive ring. */
+static bool AMCOM_MuxCreditDue(const AMCOM_Mux* mux) {
+    if (mux->creditPending || mux->getTicks() - mux->lastCreditTime >= AMCOM_MUX_CREDIT_INTERVAL_MS) {
+        return true;
+    }
+    for (size_t i = 0; i < AMCOM_MUX_CHANNELS; ++i) {
+        const AMCOM_MuxChannel* channel = &mux->channels[i];
+        if (!channel->configured) {
+            continue;
+        }
+        int16_t grown = (int16_t)(AMCOM_MuxRxLimit(channel) - channel->rxAnnounced);
+        size_t threshold = RingBuffer_GetCapacity(&channel->rx) / 4;
+        if (grown > 0 && (size_t)grown >= (threshold ? threshold : 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Prepares the credit packet with the limits of all configured channels. */
+static void AMCOM_MuxBuildCredit(AMCOM_Mux* mux) {
+    uint8_t payload[AMCOM_MUX_CHANNELS * AMCOM_MUX_CREDIT_ENTRY_SIZE];
+    size_t size = 0;
+
+    for (size_t i = 0; i < AMCOM_MUX_CHANNELS; ++i) {
+        AMCOM_MuxChannel* channel = &mux->channels[i];
+        if (!channel->configured) {
+            continue;
+        }
+        uint16_t limit = AMCOM_MuxRxLimit(channel);
+        payload[size] = (uint8_t)i;
+        AMCOM_MuxPutU16(payload + size + 1, channel->rxNext);
+        AMCOM_MuxPutU16(payload + size + 3, (uint16_t)(limit - channel->rxNext));
+        size += AMCOM_MUX_CREDIT_ENTRY_SIZE;
+        channel->rxAnnounced = limit;
+    }
+    mux->packetSize = AMCOM_Serialize(AMCOM_MUX_CREDIT_PACKET_TYPE, payload, size, mux->packet);
+    mux->packetOffset = 0;
+    mux->creditPending = false;
+    mux->lastCreditTime = mux->getTicks();
+}
+
+/** Prepares a data packet of the next channel (round robin) with data and credit. Returns false if there is none. */
+static bool AMCOM_MuxBuildData(AMCOM_Mux* mux) {
+    for (size_t n = 1; n <= AMCOM_MUX_CHANNELS; ++n) {
+        uint8_t index = (uint8_t)((mux->currentChannel + n) % AMCOM_MUX_CHANNELS);
+        AMCOM_MuxChannel* channel = &mux->channels[index];
+        if (!channel->configured) {
+            continue;
+        }
+        int16_t credit = (int16_t)(channel->txLimit - channel->txNext);
+        size_t size = RingBuffer_GetLen(&channel->tx);
+        if (size > 0 && credit <= 0) {
+            channel->stats.creditStalls++;
+        }
+        if (size == 0 || credit <= 0) {
+            if (!channel->probePending) {
+                continue;
+            }
+            size = 0;
+            credit = 0;
+        }
+
+        if (size > (size_t)credit) {
+            size = (size_t)credit;
+        }
+        if (size > AMCOM_MUX_MAX_DATA_SIZE) {
+            size = AMCOM_MUX_MAX_DATA_SIZE;
+        }
+
+        uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+        AMCOM_MuxPutU16(payload, channel->txNext);
+        for (size_t i = 0; i < size; ++i) {
+            RingBuffer_GetChar(&channel->tx, (char*)&payload[AMCOM_MUX_OFFSET_SIZE + i]);
+        }
+        mux->packetSize = AMCOM_Serialize((uint8_t)(AMCOM_MUX_DATA_PACKET_TYPE + index), payload,
+                                          AMCOM_MUX_OFFSET_SIZE + size, mux->packet);
+        mux->packetOffset = 0;
+        mux->currentChannel = index;
+        channel->probePending = false;
+        channel->txNext = (uint16_t)(channel->txNext + size);
+        channel->stats.bytesSent += size;
+        return true;
+    }
+    return false;
+}
+
+/** Applies a credit entry of the peer to the transmit side of a channel. */
+static void AMCOM_MuxApplyCredit(AMCOM_MuxChannel* channel, uint16_t peerNext, uint16_t peerFree) {
+    uint16_t limit = (uint16_t)(peerNext + peerFree);
+    // The peer can neither expect bytes that were not sent yet nor withdraw credit that was granted:
+    // either end has restarted, so continue from the position the peer expects.
+    if ((int16_t)(peerNext - channel->txNext) > 0 || (int16_t)(limit - channel->txNext) < 0) {
+        channel->txNext = peerNext;
+    }
+    channel->txLimit = limit;
+    // Bytes the peer has not got are either in flight or lost. If they exhaust the credit, tell the peer
+    // where the stream continues, otherwise lost bytes would hold the credit forever.
+    channel->probePending = ((int16_t)(limit - channel->txNext) <= 0) && (peerNext != channel->txNext);
+}
+
+/** Stores the data of a received data packet in the receive ring of its channel. */
+static void AMCOM_MuxReceiveData(AMCOM_Mux* mux, AMCOM_MuxChannel* channel, const uint8_t* payload, size_t size) {
+    uint16_t offset = AMCOM_MuxGetU16(payload);
+    if (offset != channel->rxNext) {
+        uint16_t gap = (uint16_t)(offset - channel->rxNext);
+        if (gap <= AMCOM_MUX_MAX_RING_SIZE) {
+            channel->stats.bytesLost += gap;
+        }
+        channel->rxNext = offset;
+        // the skipped bytes return their credit to the sender
+        mux->creditPending = true;
+    }
+
+    const uint8_t* data = payload + AMCOM_MUX_OFFSET_SIZE;
+    size_t dataSize = size - AMCOM_MUX_OFFSET_SIZE;
+    for (size_t i = 0; i < dataSize; ++i) {
+        if (!RingBuffer_PutChar(&channel->rx, (char)data[i])) {
+            channel->stats.bytesOverrun += dataSize - i;
+            break;
+        }
+    }
+    channel->rxNext = (uint16_t)(channel->rxNext + dataSize);
+    channel->stats.bytesReceived += dataSize;
+}
+
+void AMCOM_InitMux(AMCOM_Mux* mux, AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks) {
+    assert(mux && write && getTicks);
+    memset(mux, 0, sizeof(*mux));
+    mux->write = write;
+    mux->writeContext = writeContext;
+    mux->getTicks = getTicks;
+    mux->currentChannel = AMCOM_MUX_CHANNELS - 1;
+    mux->lastCreditTime = getTicks();
+}
+
+bool AMCOM_SetMuxChannel(AMCOM_Mux* mux, uint8_t channel, void* rxBuffer, size_t rxSize, void* txBuffer, size_t txSize) {
+    assert(mux);
+    if (channel >= AMCOM_MUX_CHANNELS || !rxBuffer || !txBuffer
+            || rxSize == 0 || rxSize > AMCOM_MUX_MAX_RING_SIZE || txSize == 0 || txSize > AMCOM_MUX_MAX_RING_SIZE) {
+        return false;
+    }
+
+    AMCOM_MuxChannel* ch = &mux->channels[channel];
+    memset(ch, 0, sizeof(*ch));
+    RingBuffer_Init(&ch->rx, (char*)rxBuffer, rxSize);
+    RingBuffer_Init(&ch->tx, (char*)txBuffer, txSize);
+    ch->configured = true;
+    mux->creditPending = true;
+    return true;
+}
+
+size_t AMCOM_MuxWrite(AMCOM_Mux* mux, uint8_t channel, const void* data, size_t dataSize) {
+    assert(mux && channel < AMCOM_MUX_CHANNELS && (data || dataSize == 0));
+    AMCOM_MuxChannel* ch = &mux->channels[channel];
+    if (!ch->configured) {
+        return 0;
+    }
+    const char* bytes = (const char*)data;
+    size_t written = 0;
+    while (written < dataSize && RingBuffer_PutChar(&ch->tx, bytes[written])) {
+        written++;
+    }
+    return written;
+}
+
+size_t AMCOM_MuxRead(AMCOM_Mux* mux, uint8_t channel, void* data, size_t maxSize) {
+    assert(mux && channel < AMCOM_MUX_CHANNELS && (data || maxSize == 0));
+    AMCOM_MuxChannel* ch = &mux->channels[channel];
+    if (!ch->configured) {
+        return 0;
+    }
+    char* bytes = (char*)data;
+    size_t read = 0;
+    while (read < maxSize && RingBuffer_GetChar(&ch->rx, &bytes[read])) {
+        read++;
+    }
+    return read;
+}
+
+void AMCOM_MuxHandlePacket(const AMCOM_Packet* packet, void* context) {
+    AMCOM_Mux* mux = (AMCOM_Mux*)context;
+    assert(packet && mux);
+    uint8_t type = packet->header.type;
+    size_t length = packet->header.length;
+
+    if (type == AMCOM_MUX_CREDIT_PACKET_TYPE) {
+        if (length % AMCOM_MUX_CREDIT_ENTRY_SIZE != 0) {
+            return;
+        }
+        for (size_t i = 0; i < length; i += AMCOM_MUX_CREDIT_ENTRY_SIZE) {
+            const uint8_t* entry = packet->payload + i;
+            if (entry[0] < AMCOM_MUX_CHANNELS && mux->channels[entry[0]].configured) {
+                AMCOM_MuxApplyCredit(&mux->channels[entry[0]], AMCOM_MuxGetU16(entry + 1), AMCOM_MuxGetU16(entry + 3));
+            }
+        }
+    } else if (type >= AMCOM_MUX_DATA_PACKET_TYPE && type < AMCOM_MUX_DATA_PACKET_TYPE + AMCOM_MUX_CHANNELS) {
+        AMCOM_MuxChannel* channel = &mux->channels[type - AMCOM_MUX_DATA_PACKET_TYPE];
+        if (channel->configured && length >= AMCOM_MUX_OFFSET_SIZE) {
+            AMCOM_MuxReceiveData(mux, channel, packet->payload, length);
+        }
+    }
+}
+
+size_t AMCOM_MuxPoll(AMCOM_Mux* mux) {
+    assert(mux);
+    size_t total = 0;
+    for (;;) {
+        if (mux->packetOffset == mux->packetSize) {
+            if (AMCOM_MuxCreditDue(mux)) {
+                AMCOM_MuxBuildCredit(mux);
+            } else if (!AMCOM_MuxBuildData(mux)) {
+                break;
+            }
+        }
+        size_t written = mux->write(mux->packet + mux->packetOffset, mux->packetSize - mux->packetOffset,
+                                    mux->writeContext);
+        mux->packetOffset += written;
+        total += written;
+        if (mux->packetOffset < mux->packetSize) {
+            break;
+        }
+    }
+    return total;
+}
+
+void AMCOM_GetMuxChannelStats(const AMCOM_Mux* mux, uint8_t channel, AMCOM_MuxChannelStats* stats) {
+    assert(mux && stats && channel < AMCOM_MUX_CHANNELS);
+    *stats = mux->channels[channel].stats;
+}
@@ -0,0 +1,232 @@
+#ifndef AMCOM_MUX_H_
+#define AMCOM_MUX_H_
+
+/**
+ * This header file defines the API of the AMCOM virtual channel multiplexer.
+ *
+ * The multiplexer carries up to @ref AMCOM_MUX_CHANNELS independent byte streams (e.g. a console, telemetry
+ * and a command protocol) over one AMCOM link. Every channel has its own receive and transmit ring, so the
+ * streams never mix byte-wise:
+ *
+ * - channel N is carried by packets of type @ref AMCOM_MUX_DATA_PACKET_TYPE + N,
+ * - the transmitter interleaves the channels fairly: one packet per channel with pending data in every round,
+ *   so an interactive channel waits for at most one packet of every other channel,
+ * - the flow control is credit-based: a channel transmits only as many bytes as the peer has announced free
+ *   in its receive ring, so a bulk channel whose reader is slow stalls itself instead of overrunning the peer
+ *   or blocking the other channels.
+ *
+ * Payload of a data packet:
+ *
+ * +-----------------+---------------------------------------------------------------------------+
+ * | OFFSET          | DATA                                                                      |
+ * | 2B              | 0..198B                                                                   |
+ * +-----------------+---------------------------------------------------------------------------+
+ *
+ * Payload of the @ref AMCOM_MUX_CREDIT_PACKET_TYPE packet (one entry per channel):
+ *
+ * +--------+-----------------+-----------------+
+ * | CHANNEL| NEXT            | FREE            |  x number of channels
+ * | 1B     | 2B              | 2B              |
+ * +--------+-----------------+-----------------+
+ *
+ * OFFSET - stream position of the first data byte (modulo 2^16, little-endian).
+ * NEXT - stream position of the next byte the receiver expects. FREE - free space of its receive ring.
+ *
+ * Because the credit is expressed in stream positions, a lost data or credit packet never leaks credit: the
+ * receiver skips the lost bytes (counted in bytesLost) and the next credit update, sent at least every
+ * @ref AMCOM_MUX_CREDIT_INTERVAL_MS, restores the window. If the lost bytes used up all the credit, the sender
+ * announces its stream position with a data packet without data. The same applies to a restarted peer.
+ * Lost bytes are not retransmitted; a channel that needs them carries its own recovery (e.g. amcom_reliable.h).
+ *
+ * Typical usage:
+ *
+ *     AMCOM_InitMux(&mux, writeWhenIdle, NULL, msGetTicks);
+ *     AMCOM_SetMuxChannel(&mux, CONSOLE_CHANNEL, consoleRx, sizeof(consoleRx), consoleTx, sizeof(consoleTx));
+ *     AMCOM_SetMuxChannel(&mux, TELEMETRY_CHANNEL, telemetryRx, sizeof(telemetryRx), telemetryTx, sizeof(telemetryTx));
+ *     for (uint8_t channel = 0; channel < AMCOM_MUX_CHANNELS; ++channel) {
+ *         AMCOM_RegisterHandler(&dispatcher, AMCOM_MUX_DATA_PACKET_TYPE + channel, AMCOM_MuxHandlePacket, &mux);
+ *     }
+ *     AMCOM_RegisterHandler(&dispatcher, AMCOM_MUX_CREDIT_PACKET_TYPE, AMCOM_MuxHandlePacket, &mux);
+ *     ...
+ *     AMCOM_MuxWrite(&mux, CONSOLE_CHANNEL, "> ", 2);
+ *     n = AMCOM_MuxRead(&mux, CONSOLE_CHANNEL, line, sizeof(line));
+ *     AMCOM_MuxPoll(&mux); // from the main loop
+ *
+ * As with the scheduler (see amcom_scheduler.h), the write function should accept bytes only while the
+ * transmit buffer below it is (almost) empty, so the interleaving is not undone by a long queue. The channel
+ * credits protect the rings of the channels only; to protect the USART receive buffer of the peer as well,
+ * write through @ref AMCOM_FlowWrite (see amcom_flow.h).
+ *
+ * The multiplexer is not reentrant: all functions of a multiplexer instance must be called from one context.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+#include "ring_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_MUX_CHANNELS
+/// Number of virtual channels
+#define AMCOM_MUX_CHANNELS					4
+#endif
+
+static_assert(AMCOM_MUX_CHANNELS >= 1 && AMCOM_MUX_CHANNELS <= AMCOM_FLOW_CREDIT_PACKET_TYPE - AMCOM_MUX_DATA_PACKET_TYPE,
+		"AMCOM_MUX_CHANNELS must be 1..6");
+
+#ifndef AMCOM_MUX_CREDIT_INTERVAL_MS
+/// Longest interval between two credit updates [ms]
+#define AMCOM_MUX_CREDIT_INTERVAL_MS		100
+#endif
+
+enum {
+	/// Maximum number of data bytes in a data packet
+	AMCOM_MUX_MAX_DATA_SIZE = (AMCOM_MAX_PAYLOAD_SIZE - 2),
+	/// Maximum size of a channel ring (half of the stream position space)
+	AMCOM_MUX_MAX_RING_SIZE = 0x7FFF
+};
+
+/** Statistics of a virtual channel */
+typedef struct {
+	/// Number of data bytes sent
+	uint32_t bytesSent;
+	/// Number of data bytes received
+	uint32_t bytesReceived;
+	/// Number of bytes lost on the link (skipped in the received stream)
+	uint32_t bytesLost;
+	/// Number of received bytes dropped because the receive ring was full (peer exceeded its credit)
+	uint32_t bytesOverrun;
+	/// Number of times the transmitter had data but no credit
+	uint32_t creditStalls;
+} AMCOM_MuxChannelStats;
+
+/** Virtual channel */
+typedef struct {
+	/// Flag stating if the channel has its rings
+	bool configured;
+	/// Received bytes not read by the application yet
+	RingBuffer rx;
+	/// Bytes written by the application and not sent yet
+	RingBuffer tx;
+	/// Stream position of the next byte expected from the peer
+	uint16_t rxNext;
+	/// Credit limit (rxNext + free space) announced last
+	uint16_t rxAnnounced;
+	/// Stream position of the next byte to send
+	uint16_t txNext;
+	/// Stream position up to which the peer has granted credit
+	uint16_t txLimit;
+	/// Flag stating if a data packet without data shall tell the peer the stream position
+	bool probePending;
+	/// Statistics of the channel
+	AMCOM_MuxChannelStats stats;
+} AMCOM_MuxChannel;
+
+/** Structure describing the channel multiplexer */
+typedef struct {
+	/// Virtual channels
+	AMCOM_MuxChannel channels[AMCOM_MUX_CHANNELS];
+	/// Channel that sent the last data packet (round robin)
+	uint8_t currentChannel;
+	/// Flag stating if a credit update shall be sent as soon as possible
+	bool creditPending;
+	/// Time of the last credit update
+	uint64_t lastCreditTime;
+	/// Packet being handed over to the write function
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the packet
+	size_t packetSize;
+	/// Number of bytes of the packet already accepted by the write function
+	size_t packetOffset;
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// User-defined context of the write function
+	void* writeContext;
+	/// Function returning the current time in milliseconds
+	AMCOM_TickFunction getTicks;
+} AMCOM_Mux;
+
+/**
+ * @brief Initializes the channel multiplexer.
+ *
+ * All channels are left without rings; use @ref AMCOM_SetMuxChannel for every channel that is used.
+ * @param mux pointer to the multiplexer structure
+ * @param write function writing bytes to the link
+ * @param writeContext user defined context of the write function
+ * @param getTicks function returning the current time in milliseconds
+ */
+void AMCOM_InitMux(AMCOM_Mux* mux, AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks);
+
+/**
+ * @brief Assigns the receive and transmit rings to a channel.
+ *
+ * The peer learns about the receive ring with the next credit update.
+ * @param mux pointer to the multiplexer structure
+ * @param channel channel number (0..AMCOM_MUX_CHANNELS-1)
+ * @param rxBuffer memory of the receive ring
+ * @param rxSize size of the receive ring (1..AMCOM_MUX_MAX_RING_SIZE)
+ * @param txBuffer memory of the transmit ring
+ * @param txSize size of the transmit ring (1..AMCOM_MUX_MAX_RING_SIZE)
+ * @return true if the channel is configured, false if the arguments are invalid
+ */
+bool AMCOM_SetMuxChannel(AMCOM_Mux* mux, uint8_t channel, void* rxBuffer, size_t rxSize, void* txBuffer, size_t txSize);
+
+/**
+ * @brief Appends bytes to the transmit ring of a channel.
+ *
+ * @param mux pointer to the multiplexer structure
+ * @param channel channel number
+ * @param data bytes to send
+ * @param dataSize number of bytes to send
+ * @return number of bytes accepted (less than dataSize if the transmit ring is full)
+ */
+size_t AMCOM_MuxWrite(AMCOM_Mux* mux, uint8_t channel, const void* data, size_t dataSize);
+
+/**
+ * @brief Pulls received bytes out of the receive ring of a channel.
+ *
+ * The freed space is announced to the peer by one of the next calls of @ref AMCOM_MuxPoll.
+ * @param mux pointer to the multiplexer structure
+ * @param channel channel number
+ * @param data place to store the bytes
+ * @param maxSize maximum number of bytes to read
+ * @return number of bytes read
+ */
+size_t AMCOM_MuxRead(AMCOM_Mux* mux, uint8_t channel, void* data, size_t maxSize);
+
+/**
+ * @brief Processes a received data or credit packet.
+ *
+ * This function has the @ref AMCOM_PacketHandler signature, so it can be registered with the dispatcher for
+ * the data packet types of the channels and @ref AMCOM_MUX_CREDIT_PACKET_TYPE. Other packets are ignored.
+ * @param packet received packet
+ * @param mux pointer to the multiplexer structure
+ */
+void AMCOM_MuxHandlePacket(const AMCOM_Packet* packet, void* mux);
+
+/**
+ * @brief Hands credit updates and data packets over to the write function.
+ *
+ * Credit updates go first, then the channels with data and credit take turns, one packet at a time.
+ * The packet that is being written is always completed before the next one is chosen.
+ * @param mux pointer to the multiplexer structure
+ * @return number of bytes accepted by the write function
+ */
+size_t AMCOM_MuxPoll(AMCOM_Mux* mux);
+
+/**
+ * @brief Takes a snapshot of the statistics of a channel.
+ *
+ * @param mux pointer to the multiplexer structure
+ * @param channel channel number
+ * @param stats place to store the statistics
+ */
+void AMCOM_GetMuxChannelStats(const AMCOM_Mux* mux, uint8_t channel, AMCOM_MuxChannelStats* stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_MUX_H_ */
@@ -0,0 +1,97 @@
+#ifndef AMCOM_PARSER_H_
+#define AMCOM_PARSER_H_
+
+/**
+ * This header file is internal to the AMCOM library. It exposes the SOP framing parser behind
+ * @ref AMCOM_Deserialize to receivers that keep the packet being received outside of their own structure
+ * (see amcom_pool.h), and the CRC primitives to receivers that parse the framing on their own
+ * (see amcom_stream.h).
+ *
+ * The parser works on a packet buffer it does not own. Two hooks let the receiver manage that buffer:
+ * - acquire - called on a SOP when the parser has no buffer; may return NULL to drop the frame,
+ * - dispatch - called with a complete packet; returns the buffer the parser continues with. When the packet
+ *   completed while rescanning a rejected frame, the bytes that are still to be rescanned are passed as the
+ *   history. A hook that returns a different buffer must copy the history to the same offsets of the new
+ *   buffer first; a hook that returns NULL drops the history.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Start of packet character
+extern const uint8_t  AMCOM_SOP;
+/// Initial value of the CRC calculation
+extern const uint16_t AMCOM_INITIAL_CRC;
+
+/**
+ * @brief Continues the CRC calculation over a block of bytes.
+ *
+ * @param crc CRC of the preceding bytes (@ref AMCOM_INITIAL_CRC at the start of a frame)
+ * @param data bytes to add
+ * @param dataSize number of bytes to add
+ * @return CRC including the added bytes
+ */
+uint16_t AMCOM_UpdateCRCBlock(uint16_t crc, const uint8_t* data, size_t dataSize);
+
+/** Hook providing a buffer for a new frame */
+typedef AMCOM_Packet* (*AMCOM_AcquireHook)(void* owner);
+
+/** Hook delivering a complete packet and returning the buffer to continue with */
+typedef AMCOM_Packet* (*AMCOM_DispatchHook)(void* owner, AMCOM_Packet* packet, const uint8_t* history, size_t historySize);
+
+/** Parser working on the state of a receiver */
+typedef struct {
+	/// State of the frame being received
+	AMCOM_FrameState* frame;
+	/// Link statistics to update
+	AMCOM_ReceiverStats* stats;
+	/// Buffer of the frame being received (NULL if the receiver holds none)
+	AMCOM_Packet* packet;
+	/// Hook providing a buffer for a new frame (may be NULL if packet is never NULL)
+	AMCOM_AcquireHook acquire;
+	/// Hook delivering a complete packet
+	AMCOM_DispatchHook dispatch;
+	/// Receiver passed to the hooks
+	void* owner;
+	/// Stop right after the first dispatched packet (pull mode)
+	bool singlePacket;
+	/// Set when a packet was dispatched by the last call of @ref AMCOM_ParseChunk
+	bool packetReady;
+} AMCOM_Parser;
+
+/**
+ * @brief Initializes the frame state of a new receiver.
+ *
+ * @param frame pointer to the frame state
+ */
+void AMCOM_InitFrame(AMCOM_FrameState* frame);
+
+/**
+ * @brief Resets the frame state so the next byte is treated as a SOP candidate.
+ *
+ * @param frame pointer to the frame state
+ */
+void AMCOM_ResetFrame(AMCOM_FrameState* frame);
+
+/**
+ * @brief Feeds a chunk of data to the parser (see @ref AMCOM_Deserialize and @ref AMCOM_Parse).
+ *
+ * In the single packet mode the parser stops right after the first dispatched packet. If the packet was
+ * found while rescanning a rejected frame, the rest of that frame is rescanned by the next call before any
+ * new data is consumed.
+ * @param parser pointer to the parser
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ * @return number of bytes consumed
+ */
+size_t AMCOM_ParseChunk(AMCOM_Parser* parser, const uint8_t* data, size_t dataSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_PARSER_H_ */
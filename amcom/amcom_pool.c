@@ -0,0 +1,120 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_pool.h"
+#include "amcom_parser.h"
+
+void AMCOM_InitPacketPool(AMCOM_PacketPool* pool, AMCOM_Packet* blocks, size_t blockCount) {
+    assert(pool && (blocks || blockCount == 0));
+    pool->freeList = NULL;
+    pool->blocks   = blocks;
+    for (size_t i = blockCount; i > 0; --i) {
+        memcpy(&blocks[i - 1], &pool->freeList, sizeof(void*));
+        pool->freeList = &blocks[i - 1];
+    }
+    memset(&pool->stats, 0, sizeof(pool->stats));
+    pool->stats.blocksTotal   = (uint32_t)blockCount;
+    pool->stats.blocksFree    = (uint32_t)blockCount;
+    pool->stats.minBlocksFree = (uint32_t)blockCount;
+}
+
+AMCOM_Packet* AMCOM_AllocPacket(AMCOM_PacketPool* pool) {
+    assert(pool != NULL);
+    AMCOM_Packet* packet = (AMCOM_Packet*)pool->freeList;
+    if (!packet) {
+        pool->stats.allocFailures++;
+        return NULL;
+    }
+    // the link is read with memcpy as the packed buffers have no pointer alignment
+    memcpy(&pool->freeList, packet, sizeof(void*));
+    pool->stats.allocations++;
+    pool->stats.blocksFree--;
+    if (pool->stats.blocksFree < pool->stats.minBlocksFree) {
+        pool->stats.minBlocksFree = pool->stats.blocksFree;
+    }
+    return packet;
+}
+
+void AMCOM_FreePacket(AMCOM_PacketPool* pool, AMCOM_Packet* packet) {
+    assert(pool != NULL);
+    if (!packet) {
+        return;
+    }
+    memcpy(packet, &pool->freeList, sizeof(void*));
+    pool->freeList = packet;
+    pool->stats.blocksFree++;
+}
+
+void AMCOM_GetPoolStats(const AMCOM_PacketPool* pool, AMCOM_PoolStats* stats) {
+    assert(pool && stats);
+    *stats = pool->stats;
+}
+
+/** Acquire hook: borrows a buffer for a new frame. */
+static AMCOM_Packet* AMCOM_PooledAcquire(void* owner) {
+    AMCOM_PooledReceiver* receiver = (AMCOM_PooledReceiver*)owner;
+    AMCOM_Packet* packet = AMCOM_AllocPacket(receiver->pool);
+    if (!packet) {
+        receiver->framesDropped++;
+    }
+    return packet;
+}
+
+/**
+ * Dispatch hook: hands the packet to the application and returns the buffer to continue with.
+ *
+ * While rescanning, the history still lives in the buffer of the dispatched packet, so it is moved to a
+ * fresh buffer before the application gets a chance to keep the packet.
+ */
+static AMCOM_Packet* AMCOM_PooledDispatch(void* owner, AMCOM_Packet* packet, const uint8_t* history, size_t historySize) {
+    AMCOM_PooledReceiver* receiver = (AMCOM_PooledReceiver*)owner;
+    AMCOM_Packet* next = NULL;
+    if (historySize > 0 && (next = AMCOM_AllocPacket(receiver->pool)) != NULL) {
+        size_t offset = (size_t)(history - (const uint8_t*)packet);
+        memcpy((uint8_t*)next + offset, history, historySize);
+    }
+
+    bool kept = receiver->packetHandler && receiver->packetHandler(packet, receiver->userContext);
+    if (kept) {
+        return next;
+    }
+    if (historySize > 0 && !next) {
+        // no spare buffer: the history is still intact in the released packet
+        return packet;
+    }
+    AMCOM_FreePacket(receiver->pool, packet);
+    return next;
+}
+
+void AMCOM_InitPooledReceiver(AMCOM_PooledReceiver* receiver, AMCOM_PacketPool* pool,
+        AMCOM_PooledPacketHandler packetHandlerCallback, void* userContext) {
+    assert(receiver && pool);
+    receiver->packet        = NULL;
+    receiver->pool          = pool;
+    AMCOM_InitFrame(&receiver->frame);
+    receiver->packetHandler = packetHandlerCallback;
+    receiver->userContext   = userContext;
+    receiver->framesDropped = 0;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+void AMCOM_PooledDeserialize(AMCOM_PooledReceiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    AMCOM_Parser parser = {
+        &receiver->frame, &receiver->stats, receiver->packet, AMCOM_PooledAcquire, AMCOM_PooledDispatch, receiver,
+        false, false
+    };
+    AMCOM_ParseChunk(&parser, (const uint8_t*)data, dataSize);
+
+    receiver->packet = parser.packet;
+    if (receiver->frame.receivedPacketState == AMCOM_PACKET_STATE_EMPTY && receiver->packet) {
+        AMCOM_FreePacket(receiver->pool, receiver->packet);
+        receiver->packet = NULL;
+    }
+}
+
+void AMCOM_ResetPooledReceiver(AMCOM_PooledReceiver* receiver) {
+    assert(receiver != NULL);
+    AMCOM_FreePacket(receiver->pool, receiver->packet);
+    receiver->packet = NULL;
+    AMCOM_ResetFrame(&receiver->frame);
+}
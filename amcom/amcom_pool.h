@@ -0,0 +1,152 @@
+#ifndef AMCOM_POOL_H_
+#define AMCOM_POOL_H_
+
+/**
+ * This header file defines the AMCOM packet pool and the pooled packet receiver.
+ *
+ * The pool is a fixed-block allocator of @ref AMCOM_Packet buffers. On a 32-bit MCU a pooled receiver takes
+ * about 60 bytes instead of the about 250 bytes of @ref AMCOM_Receiver: it borrows a buffer from the pool only
+ * when a SOP arrives and gives it back once the packet has been dispatched, so many receivers (links, virtual
+ * channels) can share a few buffers.
+ *
+ * The packet handler may keep the packet (zero-copy queuing) by returning true; the application then owns
+ * the buffer and returns it with @ref AMCOM_FreePacket when done.
+ *
+ * Typical usage:
+ *
+ *     static AMCOM_Packet poolBlocks[4];
+ *     AMCOM_InitPacketPool(&pool, poolBlocks, 4);
+ *     AMCOM_InitPooledReceiver(&link1, &pool, onPacket, &link1Context);
+ *     AMCOM_InitPooledReceiver(&link2, &pool, onPacket, &link2Context);
+ *     ...
+ *     AMCOM_PooledDeserialize(&link1, buf, n);
+ *
+ * The pool is not interrupt-safe: allocate and free its buffers from one context only.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Statistics of the packet pool */
+typedef struct {
+	/// Number of buffers in the pool
+	uint32_t blocksTotal;
+	/// Number of buffers currently free
+	uint32_t blocksFree;
+	/// Lowest number of free buffers seen (low watermark)
+	uint32_t minBlocksFree;
+	/// Number of successful allocations
+	uint32_t allocations;
+	/// Number of allocations that failed because the pool was exhausted
+	uint32_t allocFailures;
+} AMCOM_PoolStats;
+
+/** Structure describing the packet pool */
+typedef struct {
+	/// Free buffers (singly linked through the first bytes of each free buffer)
+	void* freeList;
+	/// Pool memory
+	AMCOM_Packet* blocks;
+	/// Pool statistics
+	AMCOM_PoolStats stats;
+} AMCOM_PacketPool;
+
+/**
+ * Type describing a callback function that will be called when a pooled receiver gets a packet.
+ *
+ * @param packet packet that is received
+ * @param userContext user defined context associated with the receiver
+ * @return true if the application keeps the packet (and frees it later with @ref AMCOM_FreePacket),
+ *         false if the receiver shall return it to the pool
+ */
+typedef bool (*AMCOM_PooledPacketHandler)(AMCOM_Packet* packet, void* userContext);
+
+/** Structure describing the pooled packet receiver */
+typedef struct {
+	/// Buffer of the packet being received (NULL while hunting for SOP)
+	AMCOM_Packet* packet;
+	/// Pool providing the buffers
+	AMCOM_PacketPool* pool;
+	/// State of the frame being received
+	AMCOM_FrameState frame;
+	/// User-defined packet handler (callback)
+	AMCOM_PooledPacketHandler packetHandler;
+	/// User-defined context
+	void* userContext;
+	/// Number of frames dropped because the pool was exhausted
+	uint32_t framesDropped;
+	/// Link statistics
+	AMCOM_ReceiverStats stats;
+} AMCOM_PooledReceiver;
+
+/**
+ * @brief Initializes the packet pool.
+ *
+ * @param pool pointer to the pool structure
+ * @param blocks pool memory
+ * @param blockCount number of buffers in the pool memory
+ */
+void AMCOM_InitPacketPool(AMCOM_PacketPool* pool, AMCOM_Packet* blocks, size_t blockCount);
+
+/**
+ * @brief Takes a buffer from the pool.
+ *
+ * @param pool pointer to the pool structure
+ * @return buffer or NULL if the pool is exhausted
+ */
+AMCOM_Packet* AMCOM_AllocPacket(AMCOM_PacketPool* pool);
+
+/**
+ * @brief Returns a buffer to the pool.
+ *
+ * @param pool pointer to the pool structure
+ * @param packet buffer taken from this pool (NULL is ignored)
+ */
+void AMCOM_FreePacket(AMCOM_PacketPool* pool, AMCOM_Packet* packet);
+
+/**
+ * @brief Takes a snapshot of the pool statistics.
+ *
+ * @param pool pointer to the pool structure
+ * @param stats place to store the statistics
+ */
+void AMCOM_GetPoolStats(const AMCOM_PacketPool* pool, AMCOM_PoolStats* stats);
+
+/**
+ * @brief Initializes the pooled packet receiver.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param pool pool providing the buffers
+ * @param packetHandlerCallback callback function that will be called each time a packet is received
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ */
+void AMCOM_InitPooledReceiver(AMCOM_PooledReceiver* receiver, AMCOM_PacketPool* pool,
+		AMCOM_PooledPacketHandler packetHandlerCallback, void* userContext);
+
+/**
+ * @brief Deserializes the chunk of data (see @ref AMCOM_Deserialize).
+ *
+ * A frame whose SOP arrives while the pool is exhausted is dropped and counted in framesDropped. If the
+ * receiver holds no partial frame at the end of the chunk, its buffer is back in the pool.
+ * @param receiver pointer to the receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_PooledDeserialize(AMCOM_PooledReceiver* receiver, const void* data, size_t dataSize);
+
+/**
+ * @brief Drops the partial frame (if any) and returns its buffer to the pool.
+ *
+ * @param receiver pointer to the receiver structure
+ */
+void AMCOM_ResetPooledReceiver(AMCOM_PooledReceiver* receiver);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_POOL_H_ */
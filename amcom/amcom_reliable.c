@@ -0,0 +1,258 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_reliable.h"
+
+/** Returns the slot index of the given sequence number. */
+static inline size_t AMCOM_ReliableSlot(uint8_t seq) {
+    return seq % AMCOM_RELIABLE_MAX_WINDOW;
+}
+
+/** Writes the rest of the current frame. Returns true if the whole frame has been accepted. */
+static bool AMCOM_ReliableFlush(AMCOM_ReliableLink* link) {
+    while (link->packetOffset < link->packetSize) {
+        size_t written = link->write(link->packet + link->packetOffset, link->packetSize - link->packetOffset,
+                                     link->writeContext);
+        if (written == 0) {
+            return false;
+        }
+        link->packetOffset += written;
+    }
+    return true;
+}
+
+/** Serializes and writes a data packet from the transmit slot of the given sequence number. */
+static void AMCOM_ReliableTransmit(AMCOM_ReliableLink* link, uint8_t seq) {
+    AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(seq)];
+    if (!AMCOM_ReliableFlush(link)) {
+        // the link is busy with the previous frame; AMCOM_ReliableProc sends the packet later
+        slot->queued = true;
+        return;
+    }
+
+    uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+    payload[0] = seq;
+    payload[1] = slot->type;
+    memcpy(&payload[2], slot->data, slot->size);
+    link->packetSize = AMCOM_Serialize(AMCOM_RELIABLE_DATA_PACKET_TYPE, payload, 2u + slot->size, link->packet);
+    link->packetOffset = 0;
+    slot->queued = false;
+    slot->sentTime = link->getTicks();
+    AMCOM_ReliableFlush(link);
+}
+
+/** Serializes and writes an acknowledgement reflecting the current receive window. */
+static void AMCOM_ReliableSendAck(AMCOM_ReliableLink* link) {
+    if (!AMCOM_ReliableFlush(link)) {
+        link->ackPending = true;
+        return;
+    }
+
+    uint16_t sack = 0;
+    for (uint8_t n = 0; n + 1 < link->window; ++n) {
+        uint8_t seq = (uint8_t)(link->rxNext + 1 + n);
+        if (link->rx[AMCOM_ReliableSlot(seq)].received) {
+            sack |= (uint16_t)(1u << n);
+        }
+    }
+
+    uint8_t payload[3] = { link->rxNext, (uint8_t)(sack & 0xFF), (uint8_t)(sack >> 8) };
+    link->packetSize = AMCOM_Serialize(AMCOM_RELIABLE_ACK_PACKET_TYPE, payload, sizeof(payload), link->packet);
+    link->packetOffset = 0;
+    link->ackPending = false;
+    AMCOM_ReliableFlush(link);
+}
+
+/** Updates the round-trip time estimate and the retransmission timeout (RFC 6298). */
+static void AMCOM_ReliableUpdateRto(AMCOM_ReliableLink* link, uint32_t rtt) {
+    if (link->srtt8 == 0) {
+        link->srtt8   = rtt * 8;
+        link->rttvar4 = rtt * 2;
+    } else {
+        uint32_t srtt = link->srtt8 / 8;
+        uint32_t delta = (rtt > srtt) ? (rtt - srtt) : (srtt - rtt);
+        link->rttvar4 = link->rttvar4 - link->rttvar4 / 4 + delta;
+        link->srtt8   = link->srtt8 - link->srtt8 / 8 + rtt;
+    }
+
+    uint32_t rto = link->srtt8 / 8 + link->rttvar4;
+    if (rto < AMCOM_RELIABLE_MIN_RTO) {
+        rto = AMCOM_RELIABLE_MIN_RTO;
+    } else if (rto > AMCOM_RELIABLE_MAX_RTO) {
+        rto = AMCOM_RELIABLE_MAX_RTO;
+    }
+    link->rto = rto;
+}
+
+bool AMCOM_InitReliableLink(AMCOM_ReliableLink* link, uint8_t window, AMCOM_WriteFunction write, void* writeContext,
+                            AMCOM_TickFunction getTicks, AMCOM_MessageHandler messageHandlerCallback, void* userContext) {
+    assert(link);
+    assert(write && getTicks);
+
+    if (!link || !write || !getTicks || window == 0 || window > AMCOM_RELIABLE_MAX_WINDOW) {
+        return false;
+    }
+
+    memset(link, 0, sizeof(*link));
+    link->window         = window;
+    link->rto            = AMCOM_RELIABLE_INITIAL_RTO;
+    link->write          = write;
+    link->writeContext   = writeContext;
+    link->getTicks       = getTicks;
+    link->messageHandler = messageHandlerCallback;
+    link->userContext    = userContext;
+    return true;
+}
+
+bool AMCOM_ReliableCanSend(const AMCOM_ReliableLink* link) {
+    assert(link != NULL);
+    return (uint8_t)(link->txNext - link->txBase) < link->window;
+}
+
+bool AMCOM_ReliableSend(AMCOM_ReliableLink* link, uint8_t packetType, const void* data, size_t dataSize) {
+    assert(link != NULL);
+    if (dataSize > AMCOM_RELIABLE_MAX_DATA_SIZE || (!data && dataSize) || !AMCOM_ReliableCanSend(link)) {
+        return false;
+    }
+
+    uint8_t seq = link->txNext++;
+    AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(seq)];
+    slot->inUse         = true;
+    slot->sacked        = false;
+    slot->retransmitted = false;
+    slot->queued        = false;
+    slot->type          = packetType;
+    slot->size          = (uint8_t)dataSize;
+    if (dataSize) {
+        memcpy(slot->data, data, dataSize);
+    }
+    link->stats.messagesSent++;
+
+    AMCOM_ReliableTransmit(link, seq);
+    return true;
+}
+
+/** Handles a received data packet: stores it, delivers what is in order and acknowledges. */
+static void AMCOM_ReliableHandleData(AMCOM_ReliableLink* link, const AMCOM_Packet* packet) {
+    uint8_t seq = packet->payload[0];
+    uint8_t offset = (uint8_t)(seq - link->rxNext);
+
+    if (offset < link->window) {
+        AMCOM_ReliableRxSlot* slot = &link->rx[AMCOM_ReliableSlot(seq)];
+        if (slot->received) {
+            link->stats.duplicates++;
+        } else {
+            slot->received = true;
+            slot->type     = packet->payload[1];
+            slot->size     = (uint8_t)(packet->header.length - 2);
+            memcpy(slot->data, &packet->payload[2], slot->size);
+        }
+
+        // deliver everything that is now in order
+        for (slot = &link->rx[AMCOM_ReliableSlot(link->rxNext)]; slot->received;
+             slot = &link->rx[AMCOM_ReliableSlot(link->rxNext)]) {
+            slot->received = false;
+            link->rxNext++;
+            link->stats.messagesDelivered++;
+            if (link->messageHandler) {
+                link->messageHandler(slot->type, slot->data, slot->size, link->userContext);
+            }
+        }
+    } else {
+        // already delivered (our acknowledgement was lost) - acknowledge again
+        link->stats.duplicates++;
+    }
+
+    AMCOM_ReliableSendAck(link);
+}
+
+/** Handles a received acknowledgement: releases acknowledged packets and retransmits the holes. */
+static void AMCOM_ReliableHandleAck(AMCOM_ReliableLink* link, const AMCOM_Packet* packet) {
+    uint8_t ack = packet->payload[0];
+    uint16_t sack = (uint16_t)(packet->payload[1] | ((uint16_t)packet->payload[2] << 8));
+    uint8_t inFlight = (uint8_t)(link->txNext - link->txBase);
+    uint8_t acked = (uint8_t)(ack - link->txBase);
+
+    if (acked > inFlight) {
+        // stale or bogus acknowledgement
+        return;
+    }
+
+    uint64_t now = link->getTicks();
+    for (; link->txBase != ack; link->txBase++) {
+        AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(link->txBase)];
+        if (!slot->retransmitted && !slot->sacked && (uint8_t)(link->txBase + 1) == ack) {
+            // Karn's algorithm: take samples from packets sent only once
+            AMCOM_ReliableUpdateRto(link, (uint32_t)(now - slot->sentTime));
+        }
+        slot->inUse = false;
+        slot->queued = false;
+    }
+
+    // mark selectively acknowledged packets; every unacknowledged packet below a SACKed one is a hole
+    uint8_t remaining = (uint8_t)(link->txNext - ack);
+    int highestSacked = -1;
+    for (uint8_t n = 0; n < 16 && n + 1 < remaining; ++n) {
+        if (sack & (1u << n)) {
+            AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot((uint8_t)(ack + 1 + n))];
+            if (!slot->sacked && !slot->retransmitted) {
+                AMCOM_ReliableUpdateRto(link, (uint32_t)(now - slot->sentTime));
+            }
+            slot->sacked = true;
+            highestSacked = n + 1;
+        }
+    }
+    for (int n = 0; n < highestSacked; ++n) {
+        uint8_t seq = (uint8_t)(ack + n);
+        AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(seq)];
+        if (slot->inUse && !slot->sacked && !slot->retransmitted) {
+            slot->retransmitted = true;
+            link->stats.retransmissions++;
+            AMCOM_ReliableTransmit(link, seq);
+        }
+    }
+}
+
+void AMCOM_ReliableHandlePacket(const AMCOM_Packet* packet, void* link) {
+    assert(packet && link);
+    AMCOM_ReliableLink* l = (AMCOM_ReliableLink*)link;
+
+    if (packet->header.type == AMCOM_RELIABLE_DATA_PACKET_TYPE && packet->header.length >= 2) {
+        AMCOM_ReliableHandleData(l, packet);
+    } else if (packet->header.type == AMCOM_RELIABLE_ACK_PACKET_TYPE && packet->header.length == 3) {
+        AMCOM_ReliableHandleAck(l, packet);
+    }
+}
+
+void AMCOM_ReliableProc(AMCOM_ReliableLink* link) {
+    assert(link != NULL);
+    if (!AMCOM_ReliableFlush(link)) {
+        return;
+    }
+    if (link->ackPending) {
+        AMCOM_ReliableSendAck(link);
+    }
+    for (uint8_t seq = link->txBase; seq != link->txNext && link->packetOffset == link->packetSize; ++seq) {
+        AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(seq)];
+        if (slot->inUse && slot->queued && !slot->sacked) {
+            AMCOM_ReliableTransmit(link, seq);
+        }
+    }
+
+    uint64_t now = link->getTicks();
+    bool timedOut = false;
+
+    for (uint8_t seq = link->txBase; seq != link->txNext; ++seq) {
+        AMCOM_ReliableTxSlot* slot = &link->tx[AMCOM_ReliableSlot(seq)];
+        if (slot->inUse && !slot->sacked && !slot->queued && now - slot->sentTime >= link->rto) {
+            slot->retransmitted = true;
+            link->stats.retransmissions++;
+            AMCOM_ReliableTransmit(link, seq);
+            timedOut = true;
+        }
+    }
+
+    if (timedOut) {
+        // exponential back-off until the next valid sample
+        link->rto = (link->rto * 2 > AMCOM_RELIABLE_MAX_RTO) ? AMCOM_RELIABLE_MAX_RTO : link->rto * 2;
+    }
+}
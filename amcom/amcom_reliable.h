@@ -0,0 +1,195 @@
+#ifndef AMCOM_RELIABLE_H_
+#define AMCOM_RELIABLE_H_
+
+/**
+ * This header file defines the API of the optional AMCOM reliable transport.
+ *
+ * The transport adds sequence numbers, acknowledgements and retransmissions on top of the AMCOM packets,
+ * keeping up to `window` packets in flight (sliding window with selective repeat).
+ *
+ * Payload of the @ref AMCOM_RELIABLE_DATA_PACKET_TYPE packet:
+ *
+ * +--------+--------+-----------------------------------------------------------------------------+
+ * | SEQ    | TYPE   | DATA                                                                        |
+ * | 1B     | 1B     | 0..198B                                                                     |
+ * +--------+--------+-----------------------------------------------------------------------------+
+ *
+ * Payload of the @ref AMCOM_RELIABLE_ACK_PACKET_TYPE packet:
+ *
+ * +--------+--------+--------+
+ * | ACK    | SACK            |
+ * | 1B     | 2B              |
+ * +--------+--------+--------+
+ *
+ * SEQ - sequence number of the data packet (modulo 256).
+ * TYPE - type of the message carried by the data packet (application defined).
+ * ACK - cumulative acknowledgement: sequence number of the next data packet expected in order.
+ * SACK - selective acknowledgement bitmap (little-endian): bit n set means that the packet ACK+1+n was received.
+ *
+ * Every data packet is acknowledged immediately. The sender keeps a smoothed round-trip time estimate
+ * (RFC 6298) from which the retransmission timeout is derived; a lost packet is retransmitted once the
+ * timeout expires or as soon as a later packet is selectively acknowledged. Time is taken from a
+ * millisecond tick source such as msGetTicks().
+ *
+ * A frame the write function accepts only in part is completed by later calls, so no truncated frame is
+ * put on the link. Packets and acknowledgements that find the link busy are sent by @ref AMCOM_ReliableProc
+ * as soon as it accepts bytes again.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_RELIABLE_MAX_WINDOW
+/// Maximum number of packets in flight (determines the RAM used by @ref AMCOM_ReliableLink)
+#define AMCOM_RELIABLE_MAX_WINDOW			8
+#endif
+
+// slots are indexed by the 8-bit sequence number modulo the window, so 256 must be a multiple of it
+static_assert(AMCOM_RELIABLE_MAX_WINDOW >= 1 && AMCOM_RELIABLE_MAX_WINDOW <= 16
+		&& (AMCOM_RELIABLE_MAX_WINDOW & (AMCOM_RELIABLE_MAX_WINDOW - 1)) == 0,
+		"AMCOM_RELIABLE_MAX_WINDOW must be a power of two in 1..16");
+
+enum {
+	/// Maximum number of message bytes carried by a single data packet
+	AMCOM_RELIABLE_MAX_DATA_SIZE = (AMCOM_MAX_PAYLOAD_SIZE - 2),
+	/// Lower bound of the retransmission timeout [ms]
+	AMCOM_RELIABLE_MIN_RTO = 20,
+	/// Upper bound of the retransmission timeout [ms]
+	AMCOM_RELIABLE_MAX_RTO = 3000,
+	/// Retransmission timeout used before the first round-trip time sample [ms]
+	AMCOM_RELIABLE_INITIAL_RTO = 500
+};
+
+/** Structure describing a packet waiting for an acknowledgement */
+typedef struct {
+	bool inUse;               ///< Flag stating if the slot holds an unacknowledged packet
+	bool sacked;              ///< Flag stating if the packet was selectively acknowledged
+	bool retransmitted;       ///< Flag stating if the packet was retransmitted (no RTT sample is taken then)
+	bool queued;              ///< Flag stating if the packet waits for the link to accept its (re)transmission
+	uint8_t type;             ///< Message type
+	uint8_t size;             ///< Number of message bytes
+	uint64_t sentTime;        ///< Time of the last transmission
+	uint8_t data[AMCOM_RELIABLE_MAX_DATA_SIZE]; ///< Message data
+} AMCOM_ReliableTxSlot;
+
+/** Structure describing a packet received out of order */
+typedef struct {
+	bool received;            ///< Flag stating if the slot holds a received packet
+	uint8_t type;             ///< Message type
+	uint8_t size;             ///< Number of message bytes
+	uint8_t data[AMCOM_RELIABLE_MAX_DATA_SIZE]; ///< Message data
+} AMCOM_ReliableRxSlot;
+
+/** Statistics of the reliable link */
+typedef struct {
+	uint32_t messagesSent;      ///< Number of messages accepted by @ref AMCOM_ReliableSend
+	uint32_t messagesDelivered; ///< Number of messages delivered to the application
+	uint32_t retransmissions;   ///< Number of retransmitted data packets
+	uint32_t duplicates;        ///< Number of duplicated data packets received
+} AMCOM_ReliableStats;
+
+/** Structure describing one end of the reliable link */
+typedef struct {
+	/// Packets sent and not acknowledged yet (indexed by sequence number modulo window)
+	AMCOM_ReliableTxSlot tx[AMCOM_RELIABLE_MAX_WINDOW];
+	/// Packets received out of order (indexed by sequence number modulo window)
+	AMCOM_ReliableRxSlot rx[AMCOM_RELIABLE_MAX_WINDOW];
+	/// Number of packets that can be in flight
+	uint8_t window;
+	/// Oldest unacknowledged sequence number
+	uint8_t txBase;
+	/// Sequence number of the next packet to send
+	uint8_t txNext;
+	/// Sequence number of the next packet expected in order
+	uint8_t rxNext;
+	/// Smoothed round-trip time multiplied by 8 [ms] (0 until the first sample)
+	uint32_t srtt8;
+	/// Round-trip time variation multiplied by 4 [ms]
+	uint32_t rttvar4;
+	/// Current retransmission timeout [ms]
+	uint32_t rto;
+	/// Frame being handed over to the write function
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the frame
+	size_t packetSize;
+	/// Number of bytes of the frame already accepted by the write function
+	size_t packetOffset;
+	/// Flag stating if an acknowledgement waits for the link to accept it
+	bool ackPending;
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// Context of the write function
+	void* writeContext;
+	/// Function returning the current time
+	AMCOM_TickFunction getTicks;
+	/// User-defined handler of the delivered messages (callback)
+	AMCOM_MessageHandler messageHandler;
+	/// User-defined context
+	void* userContext;
+	/// Link statistics
+	AMCOM_ReliableStats stats;
+} AMCOM_ReliableLink;
+
+/**
+ * @brief Initializes one end of the reliable link.
+ *
+ * @param link pointer to the link structure
+ * @param window number of packets that can be in flight (1..AMCOM_RELIABLE_MAX_WINDOW)
+ * @param write function writing bytes to the link
+ * @param writeContext context of the write function
+ * @param getTicks function returning the current time in milliseconds
+ * @param messageHandlerCallback callback function that will be called for each message delivered in order
+ * @param userContext user defined, general purpose context, that will be fed back to the callback function
+ * @return true if all arguments are valid and the link is initialized successfully, false otherwise
+ */
+bool AMCOM_InitReliableLink(AMCOM_ReliableLink* link, uint8_t window, AMCOM_WriteFunction write, void* writeContext,
+                            AMCOM_TickFunction getTicks, AMCOM_MessageHandler messageHandlerCallback, void* userContext);
+
+/**
+ * @brief Sends a message over the reliable link.
+ *
+ * The message is copied into the transmit window, so the caller's buffer can be reused immediately.
+ * @param link pointer to the link structure
+ * @param packetType type of the message
+ * @param data pointer to the message data or NULL if the message has no data
+ * @param dataSize number of bytes in the message (0..AMCOM_RELIABLE_MAX_DATA_SIZE)
+ * @return true if the message was queued, false if the window is full or the arguments are invalid
+ */
+bool AMCOM_ReliableSend(AMCOM_ReliableLink* link, uint8_t packetType, const void* data, size_t dataSize);
+
+/**
+ * @brief Checks if another message can be sent right now.
+ *
+ * @param link pointer to the link structure
+ * @return true if the transmit window is not full
+ */
+bool AMCOM_ReliableCanSend(const AMCOM_ReliableLink* link);
+
+/**
+ * @brief Feeds a received packet to the reliable link.
+ *
+ * Packets of types other than the reliable data and acknowledgement types are ignored. This function
+ * has the @ref AMCOM_PacketHandler signature, so it can be used directly as a receiver or dispatcher handler.
+ * @param packet received packet
+ * @param link pointer to the link structure
+ */
+void AMCOM_ReliableHandlePacket(const AMCOM_Packet* packet, void* link);
+
+/**
+ * @brief Retransmits packets whose retransmission timeout has expired.
+ *
+ * Also completes a frame the link accepted only in part and sends the packets and acknowledgements that
+ * found the link busy. This function should be called within the main program loop.
+ * @param link pointer to the link structure
+ */
+void AMCOM_ReliableProc(AMCOM_ReliableLink* link);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_RELIABLE_H_ */
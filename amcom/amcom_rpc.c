@@ -0,0 +1,231 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_rpc.h"
+
+/** Returns the call slot of the given request ID. */
+static inline AMCOM_RpcCallSlot* AMCOM_RpcSlot(AMCOM_RpcEndpoint* rpc, uint8_t id) {
+    return &rpc->calls[id % AMCOM_RPC_MAX_CALLS];
+}
+
+/** Releases the call slot and then reports the result, so the completion callback may start a new call. */
+static void AMCOM_RpcComplete(AMCOM_RpcCallSlot* call, uint8_t status, const uint8_t* data, size_t dataSize) {
+    AMCOM_RpcCompletion completion = call->completion;
+    void* userContext = call->userContext;
+
+    call->inUse = false;
+    EVENT_MANAGER_CancelEvent(&call->timeout);
+    if (completion) {
+        completion(status, data, dataSize, userContext);
+    }
+}
+
+/** Timeout event handler of a call slot. */
+static void AMCOM_RpcOnTimeout(Event* event, uint64_t scheduledTime, void* context) {
+    (void)event;
+    (void)scheduledTime;
+    AMCOM_RpcCallSlot* call = (AMCOM_RpcCallSlot*)context;
+    if (call->inUse) {
+        call->rpc->stats.timeouts++;
+        AMCOM_RpcComplete(call, AMCOM_RPC_TIMEOUT, NULL, 0);
+    }
+}
+
+/**
+ * Writes the unsent part of the pending frame, followed by the response waiting behind it.
+ * @return true if both have been written
+ */
+static bool AMCOM_RpcFlush(AMCOM_RpcEndpoint* rpc) {
+    for (;;) {
+        while (rpc->packetOffset < rpc->packetSize) {
+            size_t written = rpc->write(rpc->packet + rpc->packetOffset, rpc->packetSize - rpc->packetOffset,
+                                        rpc->writeContext);
+            if (written == 0) {
+                return false;
+            }
+            rpc->packetOffset += written;
+        }
+        if (rpc->responseSize == 0) {
+            return true;
+        }
+        memcpy(rpc->packet, rpc->response, rpc->responseSize);
+        rpc->packetSize   = rpc->responseSize;
+        rpc->packetOffset = 0;
+        rpc->responseSize = 0;
+    }
+}
+
+/** Flush event handler: resumes the pending frames on every pass of EVENT_MANAGER_Proc until they are written. */
+static void AMCOM_RpcOnFlush(Event* event, uint64_t scheduledTime, void* context) {
+    (void)scheduledTime;
+    AMCOM_RpcEndpoint* rpc = (AMCOM_RpcEndpoint*)context;
+    if (!AMCOM_RpcFlush(rpc)) {
+        EVENT_MANAGER_ScheduleEvent(event, rpc->getTicks());
+    }
+}
+
+/** Returns true if a response can be sent now or can wait for the pending frame. */
+static bool AMCOM_RpcCanRespond(AMCOM_RpcEndpoint* rpc) {
+    return AMCOM_RpcFlush(rpc) || rpc->responseSize == 0;
+}
+
+/**
+ * Serializes and writes a request or response. The part the write function does not take is written later
+ * from the flush event, so a frame never ends up truncated on the wire. A response may also wait behind the
+ * pending frame, in the single response slot, and is written from the flush event once the frame is done.
+ * @return true if the frame was written or queued, false if the link is busy
+ */
+static bool AMCOM_RpcSend(AMCOM_RpcEndpoint* rpc, uint8_t packetType, uint8_t id, uint8_t code,
+                          const void* data, size_t dataSize) {
+    bool busy = !AMCOM_RpcFlush(rpc);
+    if (busy && (packetType != AMCOM_RPC_RESPONSE_PACKET_TYPE || rpc->responseSize != 0)) {
+        return false;
+    }
+
+    uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+    payload[0] = id;
+    payload[1] = code;
+    if (dataSize) {
+        memcpy(&payload[2], data, dataSize);
+    }
+    if (busy) {
+        // the flush event is already scheduled for the pending frame
+        rpc->responseSize = AMCOM_Serialize(packetType, payload, 2u + dataSize, rpc->response);
+        return true;
+    }
+    rpc->packetSize = AMCOM_Serialize(packetType, payload, 2u + dataSize, rpc->packet);
+    rpc->packetOffset = 0;
+    if (!AMCOM_RpcFlush(rpc)) {
+        EVENT_MANAGER_ScheduleEvent(&rpc->flush, rpc->getTicks());
+    }
+    return true;
+}
+
+/** Unregisters all events of the endpoint (events that are not registered are left untouched). */
+static void AMCOM_RpcUnregisterEvents(AMCOM_RpcEndpoint* rpc) {
+    for (size_t i = 0; i < AMCOM_RPC_MAX_CALLS; ++i) {
+        rpc->calls[i].inUse = false;
+        EVENT_MANAGER_UnregisterEvent(&rpc->calls[i].timeout);
+    }
+    EVENT_MANAGER_UnregisterEvent(&rpc->flush);
+}
+
+bool AMCOM_InitRpc(AMCOM_RpcEndpoint* rpc, AMCOM_WriteFunction write, void* writeContext,
+                   AMCOM_TickFunction getTicks, AMCOM_RpcRequestHandler requestHandler, void* userContext) {
+    assert(rpc);
+    assert(write && getTicks);
+
+    if (!rpc || !write || !getTicks) {
+        return false;
+    }
+
+    // the events may still be linked into the event manager list from a previous initialization
+    AMCOM_RpcUnregisterEvents(rpc);
+    memset(rpc, 0, sizeof(*rpc));
+    rpc->write          = write;
+    rpc->writeContext   = writeContext;
+    rpc->getTicks       = getTicks;
+    rpc->requestHandler = requestHandler;
+    rpc->userContext    = userContext;
+    bool registered = EVENT_MANAGER_RegisterEvent(&rpc->flush, AMCOM_RpcOnFlush, rpc);
+    for (size_t i = 0; i < AMCOM_RPC_MAX_CALLS; ++i) {
+        rpc->calls[i].rpc = rpc;
+        if (!EVENT_MANAGER_RegisterEvent(&rpc->calls[i].timeout, AMCOM_RpcOnTimeout, &rpc->calls[i])) {
+            registered = false;
+        }
+    }
+    if (!registered) {
+        AMCOM_RpcUnregisterEvents(rpc);
+        return false;
+    }
+    return true;
+}
+
+void AMCOM_DeinitRpc(AMCOM_RpcEndpoint* rpc) {
+    assert(rpc);
+    AMCOM_RpcUnregisterEvents(rpc);
+}
+
+bool AMCOM_RpcCall(AMCOM_RpcEndpoint* rpc, uint8_t method, const void* data, size_t dataSize, uint32_t timeout,
+                   AMCOM_RpcCompletion completion, void* userContext) {
+    assert(rpc);
+    if (dataSize > AMCOM_RPC_MAX_DATA_SIZE || (!data && dataSize)) {
+        return false;
+    }
+
+    // consecutive IDs map to consecutive slots, so the first free slot is found within one pass
+    AMCOM_RpcCallSlot* call = NULL;
+    for (size_t i = 0; i < AMCOM_RPC_MAX_CALLS; ++i) {
+        AMCOM_RpcCallSlot* candidate = AMCOM_RpcSlot(rpc, (uint8_t)(rpc->nextId + i));
+        if (!candidate->inUse) {
+            call = candidate;
+            call->id = (uint8_t)(rpc->nextId + i);
+            break;
+        }
+    }
+    if (!call) {
+        return false;
+    }
+
+    if (!AMCOM_RpcSend(rpc, AMCOM_RPC_REQUEST_PACKET_TYPE, call->id, method, data, dataSize)) {
+        return false;
+    }
+    rpc->nextId       = (uint8_t)(call->id + 1);
+    call->inUse       = true;
+    call->completion  = completion;
+    call->userContext = userContext;
+    EVENT_MANAGER_ScheduleEvent(&call->timeout, rpc->getTicks() + timeout);
+    rpc->stats.callsStarted++;
+    return true;
+}
+
+size_t AMCOM_RpcPendingCalls(const AMCOM_RpcEndpoint* rpc) {
+    assert(rpc);
+    size_t pending = 0;
+    for (size_t i = 0; i < AMCOM_RPC_MAX_CALLS; ++i) {
+        pending += rpc->calls[i].inUse ? 1 : 0;
+    }
+    return pending;
+}
+
+void AMCOM_RpcHandlePacket(const AMCOM_Packet* packet, void* context) {
+    assert(packet && context);
+    AMCOM_RpcEndpoint* rpc = (AMCOM_RpcEndpoint*)context;
+    if (packet->header.length < 2) {
+        return;
+    }
+    uint8_t id = packet->payload[0];
+    uint8_t code = packet->payload[1];
+    const uint8_t* data = &packet->payload[2];
+    size_t dataSize = packet->header.length - 2u;
+
+    if (packet->header.type == AMCOM_RPC_RESPONSE_PACKET_TYPE) {
+        AMCOM_RpcCallSlot* call = AMCOM_RpcSlot(rpc, id);
+        if (!call->inUse || call->id != id) {
+            rpc->stats.unmatchedResponses++;
+            return;
+        }
+        rpc->stats.callsCompleted++;
+        AMCOM_RpcComplete(call, code, data, dataSize);
+    } else if (packet->header.type == AMCOM_RPC_REQUEST_PACKET_TYPE) {
+        if (!AMCOM_RpcCanRespond(rpc)) {
+            // leave the request unserved rather than lose its response, so a retry does not run it twice
+            rpc->stats.droppedRequests++;
+            return;
+        }
+        uint8_t response[AMCOM_RPC_MAX_DATA_SIZE];
+        size_t responseSize = 0;
+        uint8_t status = AMCOM_RPC_UNKNOWN_METHOD;
+        if (rpc->requestHandler) {
+            status = rpc->requestHandler(code, data, dataSize, response, &responseSize, rpc->userContext);
+            if (responseSize > AMCOM_RPC_MAX_DATA_SIZE) {
+                responseSize = AMCOM_RPC_MAX_DATA_SIZE;
+            }
+        }
+        if (AMCOM_RpcSend(rpc, AMCOM_RPC_RESPONSE_PACKET_TYPE, id, status, response, responseSize)) {
+            rpc->stats.requestsServed++;
+        } else {
+            // the request handler has filled the link itself
+            rpc->stats.droppedResponses++;
+        }
+    }
+}
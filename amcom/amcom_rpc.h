@@ -0,0 +1,214 @@
+#ifndef AMCOM_RPC_H_
+#define AMCOM_RPC_H_
+
+/**
+ * This header file defines the API of the AMCOM request/response (RPC) layer.
+ *
+ * Every request carries an ID that is echoed in its response, so many requests can be in flight at once and
+ * the responses may arrive in any order. Outstanding calls are kept in a fixed-size table; each call has a
+ * completion callback and a timeout event scheduled through the event manager.
+ *
+ * Payload of the @ref AMCOM_RPC_REQUEST_PACKET_TYPE packet:
+ *
+ * +--------+--------+-----------------------------------------------------------------------------+
+ * | ID     | METHOD | DATA                                                                        |
+ * | 1B     | 1B     | 0..198B                                                                     |
+ * +--------+--------+-----------------------------------------------------------------------------+
+ *
+ * Payload of the @ref AMCOM_RPC_RESPONSE_PACKET_TYPE packet:
+ *
+ * +--------+--------+-----------------------------------------------------------------------------+
+ * | ID     | STATUS | DATA                                                                        |
+ * | 1B     | 1B     | 0..198B                                                                     |
+ * +--------+--------+-----------------------------------------------------------------------------+
+ *
+ * ID - request identifier chosen by the caller (modulo 256).
+ * METHOD - application defined method number.
+ * STATUS - @ref AMCOM_RPC_OK, @ref AMCOM_RPC_UNKNOWN_METHOD or an application defined error code.
+ *
+ * Typical usage:
+ *
+ *     AMCOM_InitRpc(&rpc, usartWrite, NULL, msGetTicks, serveRequest, NULL);
+ *     AMCOM_RegisterHandler(&dispatcher, AMCOM_RPC_REQUEST_PACKET_TYPE, AMCOM_RpcHandlePacket, &rpc);
+ *     AMCOM_RegisterHandler(&dispatcher, AMCOM_RPC_RESPONSE_PACKET_TYPE, AMCOM_RpcHandlePacket, &rpc);
+ *     ...
+ *     AMCOM_RpcCall(&rpc, READ_SENSOR_METHOD, &sensorId, 1, 100, onSensorRead, NULL);
+ *
+ * Timeouts fire from EVENT_MANAGER_Proc, which must be fed with the same time base as getTicks. A frame the
+ * write function takes only in part is finished from EVENT_MANAGER_Proc as well. Until then no other request
+ * is sent, and the response to a request served meanwhile waits in a single slot behind the frame. A request
+ * that arrives while that slot is taken as well is not served at all (its caller times out and may retry).
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_RPC_MAX_CALLS
+/// Maximum number of outstanding calls of an endpoint (a power of two, so that it divides the ID space)
+#define AMCOM_RPC_MAX_CALLS					8
+#endif
+
+static_assert(AMCOM_RPC_MAX_CALLS >= 1 && AMCOM_RPC_MAX_CALLS <= 128 && (AMCOM_RPC_MAX_CALLS & (AMCOM_RPC_MAX_CALLS - 1)) == 0,
+		"AMCOM_RPC_MAX_CALLS must be a power of two in 1..128");
+
+enum {
+	/// Maximum number of request or response data bytes
+	AMCOM_RPC_MAX_DATA_SIZE = (AMCOM_MAX_PAYLOAD_SIZE - 2)
+};
+
+/** Status of a call */
+enum {
+	/// The call succeeded
+	AMCOM_RPC_OK = 0x00,
+	/// The remote endpoint does not implement the method
+	AMCOM_RPC_UNKNOWN_METHOD = 0x01,
+	/// No response arrived before the timeout (reported locally, never sent)
+	AMCOM_RPC_TIMEOUT = 0xFF
+};
+
+/**
+ * Type describing a callback function that will be called when a call completes or times out.
+ *
+ * @param status status of the call (@ref AMCOM_RPC_OK, @ref AMCOM_RPC_TIMEOUT, ...)
+ * @param data response data (NULL on timeout)
+ * @param dataSize number of bytes in the response data
+ * @param userContext user defined context passed to @ref AMCOM_RpcCall
+ */
+typedef void (*AMCOM_RpcCompletion)(uint8_t status, const uint8_t* data, size_t dataSize, void* userContext);
+
+/**
+ * Type describing a callback function serving the requests of the remote endpoint.
+ *
+ * @param method method number
+ * @param request request data
+ * @param requestSize number of bytes in the request data
+ * @param response place to store the response data (@ref AMCOM_RPC_MAX_DATA_SIZE bytes)
+ * @param responseSize place to store the number of response data bytes (0 on entry)
+ * @param userContext user defined context associated with the endpoint
+ * @return status sent back to the caller
+ */
+typedef uint8_t (*AMCOM_RpcRequestHandler)(uint8_t method, const uint8_t* request, size_t requestSize,
+		uint8_t* response, size_t* responseSize, void* userContext);
+
+struct AMCOM_RpcEndpoint;
+
+/** Outstanding call */
+typedef struct {
+	bool inUse;                       ///< Flag stating if the slot holds an outstanding call
+	uint8_t id;                       ///< Request ID
+	Event timeout;                    ///< Timeout event
+	AMCOM_RpcCompletion completion;   ///< Completion callback
+	void* userContext;                ///< Context of the completion callback
+	struct AMCOM_RpcEndpoint* rpc;    ///< Endpoint owning the slot
+} AMCOM_RpcCallSlot;
+
+/** Statistics of the RPC endpoint */
+typedef struct {
+	uint32_t callsStarted;        ///< Number of requests sent
+	uint32_t callsCompleted;      ///< Number of responses matched to outstanding calls
+	uint32_t timeouts;            ///< Number of calls that timed out
+	uint32_t unmatchedResponses;  ///< Number of responses without an outstanding call (e.g. late ones)
+	uint32_t requestsServed;      ///< Number of requests of the remote endpoint that were answered
+	uint32_t droppedRequests;     ///< Number of requests left unserved because the link was busy
+	uint32_t droppedResponses;    ///< Number of responses lost because the request handler kept the link busy
+} AMCOM_RpcStats;
+
+/** Structure describing the RPC endpoint */
+typedef struct AMCOM_RpcEndpoint {
+	/// Table of outstanding calls (indexed by request ID modulo AMCOM_RPC_MAX_CALLS)
+	AMCOM_RpcCallSlot calls[AMCOM_RPC_MAX_CALLS];
+	/// ID of the next request
+	uint8_t nextId;
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// Context of the write function
+	void* writeContext;
+	/// Frame being handed over to the write function
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the frame
+	size_t packetSize;
+	/// Number of bytes of the frame already accepted by the write function
+	size_t packetOffset;
+	/// Response frame waiting for the frame being handed over
+	uint8_t response[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the waiting response (0 if there is none)
+	size_t responseSize;
+	/// Event resuming the frames the write function did not take at once
+	Event flush;
+	/// Function returning the current time (same time base as EVENT_MANAGER_Proc)
+	AMCOM_TickFunction getTicks;
+	/// User-defined handler of the requests (may be NULL for a client-only endpoint)
+	AMCOM_RpcRequestHandler requestHandler;
+	/// Context of the request handler
+	void* userContext;
+	/// Endpoint statistics
+	AMCOM_RpcStats stats;
+} AMCOM_RpcEndpoint;
+
+/**
+ * @brief Initializes the RPC endpoint and registers its events with the event manager.
+ *
+ * An endpoint that is already initialized may be initialized again; its events are unregistered first and
+ * its outstanding calls are dropped without completion.
+ * @param rpc pointer to the endpoint structure
+ * @param write function writing bytes to the link
+ * @param writeContext context of the write function
+ * @param getTicks function returning the current time in milliseconds
+ * @param requestHandler callback serving the requests of the remote endpoint (may be NULL)
+ * @param userContext user defined context passed to the request handler
+ * @return true if all arguments are valid and the events are registered, false otherwise
+ */
+bool AMCOM_InitRpc(AMCOM_RpcEndpoint* rpc, AMCOM_WriteFunction write, void* writeContext,
+		AMCOM_TickFunction getTicks, AMCOM_RpcRequestHandler requestHandler, void* userContext);
+
+/**
+ * @brief Unregisters the events of the endpoint. Outstanding calls are dropped without completion.
+ *
+ * @param rpc pointer to the endpoint structure
+ */
+void AMCOM_DeinitRpc(AMCOM_RpcEndpoint* rpc);
+
+/**
+ * @brief Sends a request without waiting for the response.
+ *
+ * The completion callback is called exactly once: when the response arrives or when the timeout expires.
+ * @param rpc pointer to the endpoint structure
+ * @param method method number
+ * @param data request data (may be NULL if dataSize is 0)
+ * @param dataSize number of bytes in the request data (0..AMCOM_RPC_MAX_DATA_SIZE)
+ * @param timeout time to wait for the response [ms]
+ * @param completion callback called when the call completes (may be NULL)
+ * @param userContext user defined context passed to the completion callback
+ * @return true if the request was sent, false if the call table is full, the previous frame is still waiting
+ *         for the link or the arguments are invalid
+ */
+bool AMCOM_RpcCall(AMCOM_RpcEndpoint* rpc, uint8_t method, const void* data, size_t dataSize, uint32_t timeout,
+		AMCOM_RpcCompletion completion, void* userContext);
+
+/**
+ * @brief Returns the number of outstanding calls.
+ *
+ * @param rpc pointer to the endpoint structure
+ */
+size_t AMCOM_RpcPendingCalls(const AMCOM_RpcEndpoint* rpc);
+
+/**
+ * @brief Processes a received request or response packet.
+ *
+ * This function has the @ref AMCOM_PacketHandler signature, so it can be registered with the dispatcher for
+ * @ref AMCOM_RPC_REQUEST_PACKET_TYPE and @ref AMCOM_RPC_RESPONSE_PACKET_TYPE. Other packets are ignored.
+ * @param packet received packet
+ * @param rpc pointer to the endpoint structure
+ */
+void AMCOM_RpcHandlePacket(const AMCOM_Packet* packet, void* rpc);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_RPC_H_ */
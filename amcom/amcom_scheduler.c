@@ -0,0 +1,205 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_scheduler.h"
+
+/// Size of the enqueue tick stored in front of each queued packet
+#define AMCOM_SCHEDULER_TICK_SIZE       4
+
+/** Copies bytes into the queue memory starting at the given offset (wrapping around). */
+static void AMCOM_QueueWrite(AMCOM_SchedulerQueue* queue, size_t offset, const uint8_t* src, size_t size) {
+    offset %= queue->capacity;
+    size_t first = queue->capacity - offset;
+    if (first > size) {
+        first = size;
+    }
+    memcpy(queue->buffer + offset, src, first);
+    memcpy(queue->buffer, src + first, size - first);
+}
+
+/** Copies bytes out of the queue memory starting at the given offset (wrapping around). */
+static void AMCOM_QueueRead(const AMCOM_SchedulerQueue* queue, size_t offset, uint8_t* dst, size_t size) {
+    offset %= queue->capacity;
+    size_t first = queue->capacity - offset;
+    if (first > size) {
+        first = size;
+    }
+    memcpy(dst, queue->buffer + offset, first);
+    memcpy(dst + first, queue->buffer, size - first);
+}
+
+/** Returns the size of the packet at the head of a non-empty queue. */
+static size_t AMCOM_QueueHeadPacketSize(const AMCOM_SchedulerQueue* queue) {
+    uint8_t length;
+    AMCOM_QueueRead(queue, queue->head + AMCOM_SCHEDULER_TICK_SIZE + 2, &length, 1);
+    return sizeof(AMCOM_PacketHeader) + length;
+}
+
+/** Moves the packet at the head of the queue to the scheduler packet buffer. */
+static void AMCOM_TakePacket(AMCOM_Scheduler* scheduler, AMCOM_SchedulerQueue* queue) {
+    uint8_t tick[AMCOM_SCHEDULER_TICK_SIZE];
+    size_t packetSize = AMCOM_QueueHeadPacketSize(queue);
+    AMCOM_QueueRead(queue, queue->head, tick, sizeof(tick));
+    AMCOM_QueueRead(queue, queue->head + sizeof(tick), scheduler->packet, packetSize);
+    queue->head = (queue->head + sizeof(tick) + packetSize) % queue->capacity;
+    queue->size -= sizeof(tick) + packetSize;
+
+    scheduler->packetSize     = packetSize;
+    scheduler->packetOffset   = 0;
+    scheduler->packetClass    = (uint8_t)(queue - scheduler->queues);
+    scheduler->packetEnqueued = (uint32_t)tick[0] | ((uint32_t)tick[1] << 8) | ((uint32_t)tick[2] << 16)
+                              | ((uint32_t)tick[3] << 24);
+    queue->stats.packetsQueued--;
+}
+
+/** Updates the statistics of the class of the packet whose last byte was accepted by the write function. */
+static void AMCOM_PacketWritten(AMCOM_Scheduler* scheduler) {
+    AMCOM_SchedulerQueue* queue = &scheduler->queues[scheduler->packetClass];
+    uint32_t latency = (uint32_t)scheduler->getTicks() - scheduler->packetEnqueued;
+    queue->stats.packetsSent++;
+    queue->stats.bytesSent += (uint32_t)scheduler->packetSize;
+    queue->stats.totalLatency += latency;
+    if (latency > queue->stats.maxLatency) {
+        queue->stats.maxLatency = latency;
+    }
+}
+
+/** Chooses the next packet according to the policy. Returns false if all queues are empty. */
+static bool AMCOM_SelectPacket(AMCOM_Scheduler* scheduler) {
+    bool pending = false;
+    for (size_t i = 0; i < AMCOM_SCHEDULER_CLASSES; ++i) {
+        if (scheduler->queues[i].size > 0) {
+            if (scheduler->policy == AMCOM_SCHEDULER_STRICT_PRIORITY) {
+                AMCOM_TakePacket(scheduler, &scheduler->queues[i]);
+                return true;
+            }
+            pending = true;
+        }
+    }
+    if (!pending) {
+        return false;
+    }
+
+    // deficit round robin: a class gets its quantum when the round robin arrives at it; as the quantum is
+    // never smaller than a packet, some class is always served within one round
+    for (;;) {
+        AMCOM_SchedulerQueue* queue = &scheduler->queues[scheduler->currentClass];
+        if (queue->size > 0) {
+            size_t packetSize = AMCOM_QueueHeadPacketSize(queue);
+            if (queue->deficit >= packetSize) {
+                queue->deficit -= (uint32_t)packetSize;
+                AMCOM_TakePacket(scheduler, queue);
+                return true;
+            }
+        } else {
+            queue->deficit = 0;
+        }
+        scheduler->currentClass = (uint8_t)((scheduler->currentClass + 1) % AMCOM_SCHEDULER_CLASSES);
+        queue = &scheduler->queues[scheduler->currentClass];
+        if (queue->size > 0) {
+            queue->deficit += (uint32_t)queue->weight * AMCOM_MAX_PACKET_SIZE;
+        }
+    }
+}
+
+void AMCOM_InitScheduler(AMCOM_Scheduler* scheduler, AMCOM_SchedulerPolicy policy,
+        AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks) {
+    assert(scheduler && write && getTicks);
+    memset(scheduler->queues, 0, sizeof(scheduler->queues));
+    scheduler->policy       = policy;
+    scheduler->currentClass = 0;
+    scheduler->packetSize     = 0;
+    scheduler->packetOffset   = 0;
+    scheduler->packetClass    = 0;
+    scheduler->packetEnqueued = 0;
+    scheduler->write        = write;
+    scheduler->writeContext = writeContext;
+    scheduler->getTicks     = getTicks;
+}
+
+bool AMCOM_SetSchedulerQueue(AMCOM_Scheduler* scheduler, uint8_t trafficClass, void* buffer, size_t bufferSize,
+        uint8_t weight) {
+    assert(scheduler != NULL);
+    if (trafficClass >= AMCOM_SCHEDULER_CLASSES || !buffer || bufferSize == 0 || weight == 0) {
+        return false;
+    }
+    AMCOM_SchedulerQueue* queue = &scheduler->queues[trafficClass];
+    memset(queue, 0, sizeof(*queue));
+    queue->buffer   = (uint8_t*)buffer;
+    queue->capacity = bufferSize;
+    queue->weight   = weight;
+    return true;
+}
+
+bool AMCOM_SchedulerSend(AMCOM_Scheduler* scheduler, uint8_t trafficClass, uint8_t packetType,
+        const void* payload, size_t payloadSize) {
+    assert(scheduler != NULL);
+    if (trafficClass >= AMCOM_SCHEDULER_CLASSES || payloadSize > AMCOM_MAX_PAYLOAD_SIZE
+        || (!payload && payloadSize)) {
+        return false;
+    }
+    AMCOM_SchedulerQueue* queue = &scheduler->queues[trafficClass];
+    size_t entrySize = AMCOM_SCHEDULER_TICK_SIZE + sizeof(AMCOM_PacketHeader) + payloadSize;
+    if (queue->capacity - queue->size < entrySize) {
+        queue->stats.packetsDropped++;
+        return false;
+    }
+
+    uint8_t entry[AMCOM_SCHEDULER_TICK_SIZE + AMCOM_MAX_PACKET_SIZE];
+    uint32_t tick = (uint32_t)scheduler->getTicks();
+    entry[0] = (uint8_t)(tick & 0xFF);
+    entry[1] = (uint8_t)(tick >> 8);
+    entry[2] = (uint8_t)(tick >> 16);
+    entry[3] = (uint8_t)(tick >> 24);
+    AMCOM_Serialize(packetType, payload, payloadSize, entry + AMCOM_SCHEDULER_TICK_SIZE);
+
+    AMCOM_QueueWrite(queue, queue->head + queue->size, entry, entrySize);
+    queue->size += entrySize;
+    queue->stats.packetsQueued++;
+    return true;
+}
+
+size_t AMCOM_SchedulerPoll(AMCOM_Scheduler* scheduler) {
+    assert(scheduler != NULL);
+    size_t total = 0;
+    for (;;) {
+        if (scheduler->packetOffset == scheduler->packetSize && !AMCOM_SelectPacket(scheduler)) {
+            break;
+        }
+        size_t written = scheduler->write(scheduler->packet + scheduler->packetOffset,
+                                          scheduler->packetSize - scheduler->packetOffset, scheduler->writeContext);
+        scheduler->packetOffset += written;
+        total += written;
+        if (scheduler->packetOffset < scheduler->packetSize) {
+            break;
+        }
+        AMCOM_PacketWritten(scheduler);
+    }
+    return total;
+}
+
+bool AMCOM_SchedulerIsIdle(const AMCOM_Scheduler* scheduler) {
+    assert(scheduler != NULL);
+    if (scheduler->packetOffset < scheduler->packetSize) {
+        return false;
+    }
+    for (size_t i = 0; i < AMCOM_SCHEDULER_CLASSES; ++i) {
+        if (scheduler->queues[i].size > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AMCOM_GetSchedulerStats(const AMCOM_Scheduler* scheduler, uint8_t trafficClass, AMCOM_SchedulerStats* stats) {
+    assert(scheduler && stats && trafficClass < AMCOM_SCHEDULER_CLASSES);
+    *stats = scheduler->queues[trafficClass].stats;
+}
+
+void AMCOM_ResetSchedulerStats(AMCOM_Scheduler* scheduler) {
+    assert(scheduler != NULL);
+    for (size_t i = 0; i < AMCOM_SCHEDULER_CLASSES; ++i) {
+        uint32_t packetsQueued = scheduler->queues[i].stats.packetsQueued;
+        memset(&scheduler->queues[i].stats, 0, sizeof(scheduler->queues[i].stats));
+        scheduler->queues[i].stats.packetsQueued = packetsQueued;
+    }
+}
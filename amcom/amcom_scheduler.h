@@ -0,0 +1,199 @@
+#ifndef AMCOM_SCHEDULER_H_
+#define AMCOM_SCHEDULER_H_
+
+/**
+ * This header file defines the API of the AMCOM transmit scheduler.
+ *
+ * Outgoing packets are serialized into one of @ref AMCOM_SCHEDULER_CLASSES queues (class 0 is the most
+ * important one) instead of being written straight to the link. @ref AMCOM_SchedulerPoll hands the packets
+ * over to the write function one whole packet at a time, choosing the next queue according to the policy:
+ *
+ * - strict priority - the lowest-numbered non-empty class is always served first,
+ * - weighted fair - deficit round robin: in every round a class may send up to `weight` x
+ *   @ref AMCOM_MAX_PACKET_SIZE bytes, so each class gets a bandwidth share proportional to its weight and
+ *   no class is starved.
+ *
+ * The scheduler can only reorder packets it still holds. The write function should therefore accept bytes
+ * only while the transmit buffer below it is (almost) empty, otherwise a control packet still waits behind
+ * the telemetry that was already handed over:
+ *
+ *     static size_t writeWhenIdle(const void* data, size_t dataSize, void* userContext) {
+ *         return (USART_GetTxLength() < 16) ? USART_WriteData(data, dataSize) : 0;
+ *     }
+ *
+ *     AMCOM_InitScheduler(&scheduler, AMCOM_SCHEDULER_STRICT_PRIORITY, writeWhenIdle, NULL, msGetTicks);
+ *     AMCOM_SetSchedulerQueue(&scheduler, 0, controlQueue, sizeof(controlQueue), 1);
+ *     AMCOM_SetSchedulerQueue(&scheduler, 1, telemetryQueue, sizeof(telemetryQueue), 1);
+ *     ...
+ *     AMCOM_SchedulerSend(&scheduler, 1, TELEMETRY_TYPE, &telemetry, sizeof(telemetry));
+ *     ...
+ *     AMCOM_SchedulerPoll(&scheduler); // from the main loop
+ *
+ * Every class keeps latency statistics: the time from @ref AMCOM_SchedulerSend until the write function has
+ * accepted the last byte of the packet, in the units of the tick function.
+ *
+ * The scheduler is not reentrant: all functions of a scheduler instance must be called from one context.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_SCHEDULER_CLASSES
+/// Number of traffic classes (queues) of the scheduler
+#define AMCOM_SCHEDULER_CLASSES				4
+#endif
+
+/** Policy choosing the queue of the next packet */
+typedef enum {
+	/// Always serve the lowest-numbered non-empty class
+	AMCOM_SCHEDULER_STRICT_PRIORITY = 0,
+	/// Share the bandwidth in proportion to the class weights (deficit round robin)
+	AMCOM_SCHEDULER_WEIGHTED_FAIR = 1
+} AMCOM_SchedulerPolicy;
+
+/** Statistics of a single traffic class */
+typedef struct {
+	/// Number of packets whose last byte was accepted by the write function
+	uint32_t packetsSent;
+	/// Number of packets rejected because the queue was full
+	uint32_t packetsDropped;
+	/// Number of bytes of the sent packets
+	uint32_t bytesSent;
+	/// Number of packets currently queued (not counting the packet being written)
+	uint32_t packetsQueued;
+	/// Largest queueing latency
+	uint32_t maxLatency;
+	/// Sum of the queueing latencies of all sent packets (average = totalLatency / packetsSent)
+	uint64_t totalLatency;
+} AMCOM_SchedulerStats;
+
+/** Queue of a single traffic class */
+typedef struct {
+	/// Queue memory: each entry is the 4-byte enqueue tick followed by the serialized packet
+	uint8_t* buffer;
+	/// Size of the queue memory
+	size_t capacity;
+	/// Offset of the oldest entry
+	size_t head;
+	/// Number of bytes in use
+	size_t size;
+	/// Weight of the class (weighted fair policy)
+	uint8_t weight;
+	/// Number of bytes the class may still send in the current round (weighted fair policy)
+	uint32_t deficit;
+	/// Statistics of the class
+	AMCOM_SchedulerStats stats;
+} AMCOM_SchedulerQueue;
+
+/** Structure describing the AMCOM transmit scheduler */
+typedef struct {
+	/// Queues of the traffic classes
+	AMCOM_SchedulerQueue queues[AMCOM_SCHEDULER_CLASSES];
+	/// Policy choosing the next queue
+	AMCOM_SchedulerPolicy policy;
+	/// Class visited by the round robin (weighted fair policy)
+	uint8_t currentClass;
+	/// Packet being handed over to the write function
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the packet
+	size_t packetSize;
+	/// Number of bytes of the packet already accepted by the write function
+	size_t packetOffset;
+	/// Traffic class of the packet
+	uint8_t packetClass;
+	/// Enqueue tick of the packet
+	uint32_t packetEnqueued;
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// User-defined context of the write function
+	void* writeContext;
+	/// Function returning the current time
+	AMCOM_TickFunction getTicks;
+} AMCOM_Scheduler;
+
+/**
+ * @brief Initializes the AMCOM transmit scheduler.
+ *
+ * All queues are left without memory; use @ref AMCOM_SetSchedulerQueue for every class that is used.
+ * @param scheduler pointer to the scheduler structure
+ * @param policy policy choosing the next queue
+ * @param write function writing bytes to the link
+ * @param writeContext user defined context passed to the write function
+ * @param getTicks function returning the current time (used for the latency statistics)
+ */
+void AMCOM_InitScheduler(AMCOM_Scheduler* scheduler, AMCOM_SchedulerPolicy policy,
+		AMCOM_WriteFunction write, void* writeContext, AMCOM_TickFunction getTicks);
+
+/**
+ * @brief Assigns memory and a weight to the queue of a traffic class.
+ *
+ * Any packets queued in the class are dropped.
+ * @param scheduler pointer to the scheduler structure
+ * @param trafficClass traffic class (0 .. AMCOM_SCHEDULER_CLASSES-1)
+ * @param buffer queue memory
+ * @param bufferSize size of the queue memory (each packet takes 4 + 5 + payload size bytes)
+ * @param weight weight of the class used by the weighted fair policy (1..255)
+ *
+ * @return true if the queue was set up, false in case of invalid arguments
+ */
+bool AMCOM_SetSchedulerQueue(AMCOM_Scheduler* scheduler, uint8_t trafficClass, void* buffer, size_t bufferSize,
+		uint8_t weight);
+
+/**
+ * @brief Serializes a packet into the queue of a traffic class.
+ *
+ * @param scheduler pointer to the scheduler structure
+ * @param trafficClass traffic class (0 .. AMCOM_SCHEDULER_CLASSES-1)
+ * @param packetType type of packet
+ * @param payload pointer to the payload data or NULL if the packet has no payload
+ * @param payloadSize number of bytes in the payload or 0 if the packet has no payload
+ *
+ * @return true if the packet was queued, false if the queue is full or the arguments are invalid
+ */
+bool AMCOM_SchedulerSend(AMCOM_Scheduler* scheduler, uint8_t trafficClass, uint8_t packetType,
+		const void* payload, size_t payloadSize);
+
+/**
+ * @brief Hands queued packets over to the write function.
+ *
+ * The packet that is being written is always completed before the next one is chosen. The function returns
+ * when the write function stops accepting bytes or all queues are empty.
+ * @param scheduler pointer to the scheduler structure
+ *
+ * @return number of bytes accepted by the write function
+ */
+size_t AMCOM_SchedulerPoll(AMCOM_Scheduler* scheduler);
+
+/**
+ * @brief Checks if the scheduler has nothing left to write.
+ *
+ * @param scheduler pointer to the scheduler structure
+ * @return true if all queues are empty and no packet is being written, false otherwise
+ */
+bool AMCOM_SchedulerIsIdle(const AMCOM_Scheduler* scheduler);
+
+/**
+ * @brief Takes a snapshot of the statistics of a traffic class.
+ *
+ * @param scheduler pointer to the scheduler structure
+ * @param trafficClass traffic class (0 .. AMCOM_SCHEDULER_CLASSES-1)
+ * @param stats place to store the statistics
+ */
+void AMCOM_GetSchedulerStats(const AMCOM_Scheduler* scheduler, uint8_t trafficClass, AMCOM_SchedulerStats* stats);
+
+/**
+ * @brief Clears the statistics of all traffic classes (except the number of queued packets).
+ *
+ * @param scheduler pointer to the scheduler structure
+ */
+void AMCOM_ResetSchedulerStats(AMCOM_Scheduler* scheduler);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_SCHEDULER_H_ */
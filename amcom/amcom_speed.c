@@ -0,0 +1,310 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_speed.h"
+
+enum {
+    /// Size of the negotiation payload
+    AMCOM_SPEED_PAYLOAD_SIZE = 7,
+    /// Interval of polling the transmitter before switching [ms]
+    AMCOM_SPEED_POLL_INTERVAL_MS = 1
+};
+
+/** Writes the unsent part of the pending frame. Returns true if the whole frame has been written. */
+static bool AMCOM_SpeedFlush(AMCOM_SpeedNegotiator* speed) {
+    while (speed->packetOffset < speed->packetSize) {
+        size_t written = speed->port.write(speed->packet + speed->packetOffset, speed->packetSize - speed->packetOffset,
+                                           speed->port.context);
+        if (written == 0) {
+            return false;
+        }
+        speed->packetOffset += written;
+    }
+    return true;
+}
+
+/** Flush event handler: resumes the pending frame on every pass of EVENT_MANAGER_Proc until it is written. */
+static void AMCOM_SpeedOnFlush(Event* event, uint64_t scheduledTime, void* context) {
+    (void)scheduledTime;
+    AMCOM_SpeedNegotiator* speed = (AMCOM_SpeedNegotiator*)context;
+    if (!AMCOM_SpeedFlush(speed)) {
+        EVENT_MANAGER_ScheduleEvent(event, speed->getTicks());
+    }
+}
+
+/**
+ * Serializes and writes a negotiation packet. The part the write function does not take is written later
+ * from the flush event, so a frame never ends up truncated on the wire.
+ * @return true if the packet was written or queued, false if the previous frame is still pending
+ */
+static bool AMCOM_SpeedSend(AMCOM_SpeedNegotiator* speed, AMCOM_SpeedOperation op, const AMCOM_SpeedConfig* config) {
+    if (!AMCOM_SpeedFlush(speed)) {
+        return false;
+    }
+
+    uint8_t payload[AMCOM_SPEED_PAYLOAD_SIZE];
+    payload[0] = (uint8_t)op;
+    payload[1] = speed->sequence;
+    for (int i = 0; i < 4; ++i) {
+        payload[2 + i] = (uint8_t)(config->baudRate >> (8 * i));
+    }
+    payload[6] = config->overSampling;
+    speed->packetSize = AMCOM_Serialize(AMCOM_SPEED_PACKET_TYPE, payload, sizeof(payload), speed->packet);
+    speed->packetOffset = 0;
+    if (!AMCOM_SpeedFlush(speed)) {
+        EVENT_MANAGER_ScheduleEvent(&speed->flush, speed->getTicks());
+    }
+    return true;
+}
+
+/** Checks if the whole pending frame has been written and has left the transmitter. */
+static bool AMCOM_SpeedTxDone(const AMCOM_SpeedNegotiator* speed) {
+    return speed->packetOffset == speed->packetSize && speed->port.isTxIdle(speed->port.context);
+}
+
+/** Checks if a configuration is valid and supported by the local UART. */
+static bool AMCOM_SpeedSupported(const AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedConfig* config) {
+    if (config->baudRate == 0 || (config->overSampling != 8 && config->overSampling != 16)) {
+        return false;
+    }
+    return !speed->port.checkSpeed || speed->port.checkSpeed(config->baudRate, config->overSampling, speed->port.context);
+}
+
+/** Reconfigures the UART. The rest of a frame still pending at the old configuration is dropped. */
+static void AMCOM_SpeedApply(AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedConfig* config) {
+    speed->packetOffset = speed->packetSize;
+    speed->port.setSpeed(config->baudRate, config->overSampling, speed->port.context);
+    speed->current = *config;
+}
+
+/** Returns to the idle state (arming the fallback timer if needed) and reports the result. */
+static void AMCOM_SpeedFinish(AMCOM_SpeedNegotiator* speed, AMCOM_SpeedResult result) {
+    uint64_t now = speed->getTicks();
+    speed->state = AMCOM_SPEED_STATE_IDLE;
+    speed->lastActivity = now;
+
+    bool negotiated = (speed->current.baudRate != speed->base.baudRate)
+                   || (speed->current.overSampling != speed->base.overSampling);
+    if (negotiated && speed->fallbackTimeout) {
+        EVENT_MANAGER_ScheduleEvent(&speed->timer, now + speed->fallbackTimeout);
+    } else {
+        EVENT_MANAGER_CancelEvent(&speed->timer);
+    }
+
+    if (speed->resultHandler) {
+        speed->resultHandler(result, &speed->current, speed->userContext);
+    }
+}
+
+/** Timer event handler: drives the negotiation steps and the fallback. */
+static void AMCOM_SpeedOnTimer(Event* event, uint64_t scheduledTime, void* context) {
+    (void)scheduledTime;
+    AMCOM_SpeedNegotiator* speed = (AMCOM_SpeedNegotiator*)context;
+    uint64_t now = speed->getTicks();
+
+    switch (speed->state) {
+
+    case AMCOM_SPEED_STATE_IDLE:
+        // fallback timer of a negotiated link
+        if (now - speed->lastActivity >= speed->fallbackTimeout) {
+            AMCOM_SpeedApply(speed, &speed->base);
+            AMCOM_SpeedFinish(speed, AMCOM_SPEED_FELL_BACK);
+        } else {
+            EVENT_MANAGER_ScheduleEvent(event, speed->lastActivity + speed->fallbackTimeout);
+        }
+        break;
+
+    case AMCOM_SPEED_STATE_WAIT_REPLY:
+        if (now >= speed->deadline) {
+            AMCOM_SpeedFinish(speed, AMCOM_SPEED_NO_REPLY);
+            break;
+        }
+        // the PROPOSE or its reply may have been lost; a PROPOSE that cannot be written now waits for the next round
+        AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_PROPOSE, &speed->pending);
+        EVENT_MANAGER_ScheduleEvent(event, (now + AMCOM_SPEED_PROPOSE_INTERVAL_MS < speed->deadline)
+                                           ? now + AMCOM_SPEED_PROPOSE_INTERVAL_MS : speed->deadline);
+        break;
+
+    case AMCOM_SPEED_STATE_SWITCHING:
+        // the switch point: the last byte at the old configuration (PROPOSE or ACCEPT) has left the wire
+        if (!AMCOM_SpeedTxDone(speed) && now < speed->deadline) {
+            EVENT_MANAGER_ScheduleEvent(event, now + AMCOM_SPEED_POLL_INTERVAL_MS);
+            break;
+        }
+        speed->previous = speed->current;
+        AMCOM_SpeedApply(speed, &speed->pending);
+        speed->deadline = now + AMCOM_SPEED_PROBE_TIMEOUT_MS;
+        if (speed->initiator) {
+            speed->state = AMCOM_SPEED_STATE_PROBING;
+            EVENT_MANAGER_ScheduleEvent(event, now + AMCOM_SPEED_SWITCH_GUARD_MS);
+        } else {
+            speed->state = AMCOM_SPEED_STATE_WAIT_PROBE;
+            EVENT_MANAGER_ScheduleEvent(event, speed->deadline);
+        }
+        break;
+
+    case AMCOM_SPEED_STATE_PROBING:
+        if (now >= speed->deadline) {
+            AMCOM_SpeedApply(speed, &speed->previous);
+            AMCOM_SpeedFinish(speed, AMCOM_SPEED_PROBE_FAILED);
+            break;
+        }
+        AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_PROBE, &speed->pending);
+        EVENT_MANAGER_ScheduleEvent(event, (now + AMCOM_SPEED_PROBE_INTERVAL_MS < speed->deadline)
+                                           ? now + AMCOM_SPEED_PROBE_INTERVAL_MS : speed->deadline);
+        break;
+
+    case AMCOM_SPEED_STATE_WAIT_PROBE:
+        AMCOM_SpeedApply(speed, &speed->previous);
+        AMCOM_SpeedFinish(speed, AMCOM_SPEED_PROBE_FAILED);
+        break;
+
+    default:
+        speed->state = AMCOM_SPEED_STATE_IDLE;
+        break;
+    }
+}
+
+bool AMCOM_InitSpeedNegotiator(AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedPort* port, AMCOM_TickFunction getTicks,
+                               const AMCOM_SpeedConfig* base, uint32_t fallbackTimeout,
+                               AMCOM_SpeedResultHandler resultHandler, void* userContext) {
+    assert(speed);
+    assert(port && port->write && port->isTxIdle && port->setSpeed && getTicks && base);
+
+    if (!speed || !port || !port->write || !port->isTxIdle || !port->setSpeed || !getTicks || !base) {
+        return false;
+    }
+
+    // the events may still be linked into the event manager list from a previous initialization
+    EVENT_MANAGER_UnregisterEvent(&speed->timer);
+    EVENT_MANAGER_UnregisterEvent(&speed->flush);
+    memset(speed, 0, sizeof(*speed));
+    speed->port            = *port;
+    speed->getTicks        = getTicks;
+    speed->base            = *base;
+    speed->current         = *base;
+    speed->previous        = *base;
+    speed->fallbackTimeout = fallbackTimeout;
+    speed->resultHandler   = resultHandler;
+    speed->userContext     = userContext;
+    speed->lastActivity    = getTicks();
+    if (!EVENT_MANAGER_RegisterEvent(&speed->timer, AMCOM_SpeedOnTimer, speed)
+        || !EVENT_MANAGER_RegisterEvent(&speed->flush, AMCOM_SpeedOnFlush, speed)) {
+        AMCOM_DeinitSpeedNegotiator(speed);
+        return false;
+    }
+    return true;
+}
+
+void AMCOM_DeinitSpeedNegotiator(AMCOM_SpeedNegotiator* speed) {
+    assert(speed);
+    speed->state = AMCOM_SPEED_STATE_IDLE;
+    EVENT_MANAGER_UnregisterEvent(&speed->timer);
+    EVENT_MANAGER_UnregisterEvent(&speed->flush);
+}
+
+bool AMCOM_ProposeSpeed(AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedConfig* config) {
+    assert(speed && config);
+    if (speed->state != AMCOM_SPEED_STATE_IDLE || !AMCOM_SpeedSupported(speed, config)) {
+        return false;
+    }
+
+    speed->sequence++;
+    if (!AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_PROPOSE, config)) {
+        return false;
+    }
+    uint64_t now = speed->getTicks();
+    speed->pending   = *config;
+    speed->initiator = true;
+    speed->state     = AMCOM_SPEED_STATE_WAIT_REPLY;
+    speed->deadline  = now + AMCOM_SPEED_REPLY_TIMEOUT_MS;
+    EVENT_MANAGER_ScheduleEvent(&speed->timer, now + AMCOM_SPEED_PROPOSE_INTERVAL_MS);
+    return true;
+}
+
+const AMCOM_SpeedConfig* AMCOM_GetLinkSpeed(const AMCOM_SpeedNegotiator* speed) {
+    assert(speed);
+    return &speed->current;
+}
+
+void AMCOM_SpeedNotifyActivity(AMCOM_SpeedNegotiator* speed) {
+    assert(speed);
+    speed->lastActivity = speed->getTicks();
+}
+
+void AMCOM_SpeedHandlePacket(const AMCOM_Packet* packet, void* context) {
+    AMCOM_SpeedNegotiator* speed = (AMCOM_SpeedNegotiator*)context;
+    assert(packet && speed);
+
+    if (packet->header.type != AMCOM_SPEED_PACKET_TYPE || packet->header.length != AMCOM_SPEED_PAYLOAD_SIZE) {
+        return;
+    }
+    AMCOM_SpeedNotifyActivity(speed);
+
+    const uint8_t* p = packet->payload;
+    uint8_t op = p[0];
+    uint8_t sequence = p[1];
+    AMCOM_SpeedConfig config = {
+        (uint32_t)p[2] | ((uint32_t)p[3] << 8) | ((uint32_t)p[4] << 16) | ((uint32_t)p[5] << 24), p[6]
+    };
+    uint64_t now = speed->getTicks();
+
+    switch (op) {
+
+    case AMCOM_SPEED_OP_PROPOSE:
+        if (speed->state != AMCOM_SPEED_STATE_IDLE) {
+            break;
+        }
+        speed->sequence = sequence;
+        if (!AMCOM_SpeedSupported(speed, &config)) {
+            // a REJECT that cannot be written is sent in reply to the repeated PROPOSE
+            AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_REJECT, &config);
+            break;
+        }
+        if (AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_ACCEPT, &config)) {
+            speed->pending   = config;
+            speed->initiator = false;
+            speed->state     = AMCOM_SPEED_STATE_SWITCHING;
+            speed->deadline  = now + AMCOM_SPEED_REPLY_TIMEOUT_MS;
+            EVENT_MANAGER_ScheduleEvent(&speed->timer, now + AMCOM_SPEED_POLL_INTERVAL_MS);
+        }
+        break;
+
+    case AMCOM_SPEED_OP_ACCEPT:
+        if (speed->state == AMCOM_SPEED_STATE_WAIT_REPLY && sequence == speed->sequence) {
+            speed->state    = AMCOM_SPEED_STATE_SWITCHING;
+            speed->deadline = now + AMCOM_SPEED_REPLY_TIMEOUT_MS;
+            EVENT_MANAGER_ScheduleEvent(&speed->timer, now);
+        }
+        break;
+
+    case AMCOM_SPEED_OP_REJECT:
+        if (speed->state == AMCOM_SPEED_STATE_WAIT_REPLY && sequence == speed->sequence) {
+            AMCOM_SpeedFinish(speed, AMCOM_SPEED_REJECTED);
+        }
+        break;
+
+    case AMCOM_SPEED_OP_PROBE:
+        if (sequence != speed->sequence || speed->initiator) {
+            break;
+        }
+        // a PROBE_ACK that cannot be written is sent in reply to the repeated PROBE
+        if (speed->state == AMCOM_SPEED_STATE_WAIT_PROBE) {
+            if (AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_PROBE_ACK, &config)) {
+                AMCOM_SpeedFinish(speed, AMCOM_SPEED_SWITCHED);
+            }
+        } else if (speed->state == AMCOM_SPEED_STATE_IDLE) {
+            // a repeated probe: the previous PROBE_ACK was lost
+            AMCOM_SpeedSend(speed, AMCOM_SPEED_OP_PROBE_ACK, &config);
+        }
+        break;
+
+    case AMCOM_SPEED_OP_PROBE_ACK:
+        if (speed->state == AMCOM_SPEED_STATE_PROBING && sequence == speed->sequence) {
+            AMCOM_SpeedFinish(speed, AMCOM_SPEED_SWITCHED);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
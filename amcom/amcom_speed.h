@@ -0,0 +1,258 @@
+#ifndef AMCOM_SPEED_H_
+#define AMCOM_SPEED_H_
+
+/**
+ * This header file defines the API of the AMCOM link speed negotiation.
+ *
+ * The host proposes a new UART configuration, both ends switch to it at a synchronised point and the host
+ * verifies the new configuration with a probe before using it:
+ *
+ *     host                                         device
+ *     PROPOSE(seq, baud rate, oversampling)  --->  (repeated until a reply arrives)
+ *                                            <---  ACCEPT(seq) or REJECT(seq)
+ *     switches when ACCEPT is received             switches once ACCEPT has left the transmitter
+ *     PROBE(seq), repeated                   --->
+ *                                            <---  PROBE_ACK(seq)
+ *
+ * Fallback:
+ * - The host repeats PROPOSE every @ref AMCOM_SPEED_PROPOSE_INTERVAL_MS until a reply arrives, for at most
+ *   @ref AMCOM_SPEED_REPLY_TIMEOUT_MS. If the ACCEPT is lost, the device has already switched and returns to
+ *   the previous configuration after the probe timeout below. The host is still proposing by then, so a later
+ *   PROPOSE finds the device at the previous configuration again.
+ * - If the device gets no PROBE within @ref AMCOM_SPEED_PROBE_TIMEOUT_MS of switching, it returns to the
+ *   previous configuration.
+ * - If the host gets no PROBE_ACK within @ref AMCOM_SPEED_PROBE_TIMEOUT_MS of switching, it returns to the
+ *   previous configuration.
+ * - A device answers every repeated PROBE. However, if all of its PROBE_ACKs are lost, the host falls back
+ *   while the device stays. For this case an endpoint running at a negotiated speed also returns to its base
+ *   configuration when no packet arrives for fallbackTimeout ms. The link must then carry traffic at least
+ *   that often, e.g. heartbeats.
+ *
+ * Payload of the @ref AMCOM_SPEED_PACKET_TYPE packet:
+ *
+ * +--------+--------+-----------------------------------+--------------+
+ * | OP     | SEQ    | BAUD RATE                         | OVERSAMPLING |
+ * | 1B     | 1B     | 4B                                | 1B           |
+ * +--------+--------+-----------------------------------+--------------+
+ *
+ * OP - @ref AMCOM_SpeedOperation. SEQ - number of the negotiation, echoed in the replies. BAUD RATE
+ * (little-endian) and OVERSAMPLING (8 or 16) - the proposed configuration, echoed in the replies.
+ *
+ * Typical usage (device):
+ *
+ *     static const AMCOM_SpeedPort port = { usartWrite, usartTxIdle, usartSetSpeed, usartCheckSpeed, NULL };
+ *     const AMCOM_SpeedConfig base = { USART_DEFAULT_BAUD_RATE, 16 };
+ *     AMCOM_InitSpeedNegotiator(&speed, &port, msGetTicks, &base, 1000, onSpeedResult, NULL);
+ *     AMCOM_RegisterHandler(&dispatcher, AMCOM_SPEED_PACKET_TYPE, AMCOM_SpeedHandlePacket, &speed);
+ *
+ * The host calls @ref AMCOM_ProposeSpeed in addition. Timers run from EVENT_MANAGER_Proc, which must be fed
+ * with the same time base as getTicks.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+#include "event_manager.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef AMCOM_SPEED_REPLY_TIMEOUT_MS
+/// Time the host waits for ACCEPT or REJECT, repeating PROPOSE [ms]
+#define AMCOM_SPEED_REPLY_TIMEOUT_MS		300
+#endif
+
+#ifndef AMCOM_SPEED_PROPOSE_INTERVAL_MS
+/// Interval of the repeated proposals while the host waits for ACCEPT or REJECT [ms]
+#define AMCOM_SPEED_PROPOSE_INTERVAL_MS		20
+#endif
+
+#ifndef AMCOM_SPEED_PROBE_TIMEOUT_MS
+/// Time both ends wait for the probe exchange after switching [ms]
+#define AMCOM_SPEED_PROBE_TIMEOUT_MS		200
+#endif
+
+#ifndef AMCOM_SPEED_PROBE_INTERVAL_MS
+/// Interval of the repeated probes [ms]
+#define AMCOM_SPEED_PROBE_INTERVAL_MS		20
+#endif
+
+#ifndef AMCOM_SPEED_SWITCH_GUARD_MS
+/// Time the host waits after switching before the first probe, so the device has switched as well [ms]
+#define AMCOM_SPEED_SWITCH_GUARD_MS			5
+#endif
+
+static_assert(AMCOM_SPEED_SWITCH_GUARD_MS < AMCOM_SPEED_PROBE_INTERVAL_MS && AMCOM_SPEED_PROBE_INTERVAL_MS < AMCOM_SPEED_PROBE_TIMEOUT_MS,
+		"AMCOM_SPEED_SWITCH_GUARD_MS < AMCOM_SPEED_PROBE_INTERVAL_MS < AMCOM_SPEED_PROBE_TIMEOUT_MS is required");
+static_assert(AMCOM_SPEED_PROPOSE_INTERVAL_MS > 0
+		&& AMCOM_SPEED_PROBE_TIMEOUT_MS + AMCOM_SPEED_PROPOSE_INTERVAL_MS < AMCOM_SPEED_REPLY_TIMEOUT_MS,
+		"AMCOM_SPEED_PROBE_TIMEOUT_MS + AMCOM_SPEED_PROPOSE_INTERVAL_MS < AMCOM_SPEED_REPLY_TIMEOUT_MS is required");
+
+/** Operations of the negotiation packet */
+typedef enum {
+	AMCOM_SPEED_OP_PROPOSE = 1,     ///< Host proposes a configuration
+	AMCOM_SPEED_OP_ACCEPT = 2,      ///< Device accepts it and switches
+	AMCOM_SPEED_OP_REJECT = 3,      ///< Device does not support it
+	AMCOM_SPEED_OP_PROBE = 4,       ///< Host checks the new configuration
+	AMCOM_SPEED_OP_PROBE_ACK = 5    ///< Device confirms the new configuration
+} AMCOM_SpeedOperation;
+
+/** Results reported to the application */
+typedef enum {
+	/// The link runs at the negotiated configuration
+	AMCOM_SPEED_SWITCHED = 0,
+	/// The device does not support the proposed configuration (host only)
+	AMCOM_SPEED_REJECTED,
+	/// The device did not answer the proposal (host only)
+	AMCOM_SPEED_NO_REPLY,
+	/// The probe exchange failed, the endpoint returned to the previous configuration
+	AMCOM_SPEED_PROBE_FAILED,
+	/// No packet arrived for fallbackTimeout, the endpoint returned to the base configuration
+	AMCOM_SPEED_FELL_BACK
+} AMCOM_SpeedResult;
+
+/** UART configuration */
+typedef struct {
+	uint32_t baudRate;      ///< Baud rate
+	uint8_t overSampling;   ///< Oversampling (8 or 16)
+} AMCOM_SpeedConfig;
+
+/** Functions giving the negotiation access to the UART */
+typedef struct {
+	/// Function writing bytes to the link
+	AMCOM_WriteFunction write;
+	/// Function returning true when all written bytes have left the transmitter (e.g. USART_IsTxIdle)
+	bool (*isTxIdle)(void* context);
+	/// Function switching the UART to a configuration, false if it is not supported (e.g. USART_SetBaudRate)
+	bool (*setSpeed)(uint32_t baudRate, uint8_t overSampling, void* context);
+	/// Function checking if a configuration is supported (may be NULL if any configuration is)
+	bool (*checkSpeed)(uint32_t baudRate, uint8_t overSampling, void* context);
+	/// Context of the functions above
+	void* context;
+} AMCOM_SpeedPort;
+
+/**
+ * Type describing a callback function that will be called when a negotiation ends or the link falls back.
+ *
+ * @param result result of the negotiation
+ * @param config configuration the link runs at now
+ * @param userContext user defined context associated with the negotiator
+ */
+typedef void (*AMCOM_SpeedResultHandler)(AMCOM_SpeedResult result, const AMCOM_SpeedConfig* config, void* userContext);
+
+/** States of the negotiator */
+typedef enum {
+	AMCOM_SPEED_STATE_IDLE = 0,           ///< No negotiation in progress
+	AMCOM_SPEED_STATE_WAIT_REPLY,         ///< Host waits for ACCEPT or REJECT
+	AMCOM_SPEED_STATE_SWITCHING,          ///< Waiting for the transmitter to drain before switching
+	AMCOM_SPEED_STATE_PROBING,            ///< Host sends probes at the new configuration
+	AMCOM_SPEED_STATE_WAIT_PROBE          ///< Device waits for a probe at the new configuration
+} AMCOM_SpeedState;
+
+/** Structure describing the speed negotiator */
+typedef struct {
+	/// Access to the UART
+	AMCOM_SpeedPort port;
+	/// Function returning the current time (same time base as EVENT_MANAGER_Proc)
+	AMCOM_TickFunction getTicks;
+	/// Configuration the link falls back to
+	AMCOM_SpeedConfig base;
+	/// Configuration the link runs at
+	AMCOM_SpeedConfig current;
+	/// Configuration before the switch (restored if the probe fails)
+	AMCOM_SpeedConfig previous;
+	/// Configuration being negotiated
+	AMCOM_SpeedConfig pending;
+	/// State of the negotiation
+	AMCOM_SpeedState state;
+	/// Flag stating if this endpoint started the negotiation (host)
+	bool initiator;
+	/// Number of the current (or last) negotiation
+	uint8_t sequence;
+	/// Deadline of the current negotiation step
+	uint64_t deadline;
+	/// Time of the last received packet
+	uint64_t lastActivity;
+	/// Time without packets after which a negotiated link returns to the base configuration [ms] (0 - never)
+	uint32_t fallbackTimeout;
+	/// Timer of the negotiation steps and of the fallback
+	Event timer;
+	/// Negotiation packet being handed over to the write function
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	/// Number of bytes of the packet
+	size_t packetSize;
+	/// Number of bytes of the packet already accepted by the write function
+	size_t packetOffset;
+	/// Event resuming the packet the write function did not take at once
+	Event flush;
+	/// User-defined result handler (callback)
+	AMCOM_SpeedResultHandler resultHandler;
+	/// User-defined context
+	void* userContext;
+} AMCOM_SpeedNegotiator;
+
+/**
+ * @brief Initializes the speed negotiator and registers its events with the event manager.
+ *
+ * The UART must already run at the base configuration. A negotiator that is already initialized may be
+ * initialized again; its events are unregistered first.
+ * @param speed pointer to the negotiator structure
+ * @param port access to the UART (copied)
+ * @param getTicks function returning the current time in milliseconds
+ * @param base configuration the link starts at and falls back to
+ * @param fallbackTimeout time without packets after which a negotiated link falls back [ms] (0 - never)
+ * @param resultHandler callback reporting the results (may be NULL)
+ * @param userContext user defined context passed to the result handler
+ * @return true if all arguments are valid and the events are registered, false otherwise
+ */
+bool AMCOM_InitSpeedNegotiator(AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedPort* port, AMCOM_TickFunction getTicks,
+		const AMCOM_SpeedConfig* base, uint32_t fallbackTimeout, AMCOM_SpeedResultHandler resultHandler, void* userContext);
+
+/**
+ * @brief Unregisters the events of the negotiator. The UART stays at its current configuration.
+ *
+ * @param speed pointer to the negotiator structure
+ */
+void AMCOM_DeinitSpeedNegotiator(AMCOM_SpeedNegotiator* speed);
+
+/**
+ * @brief Proposes a configuration to the remote endpoint (host side).
+ *
+ * The result is reported through the result handler.
+ * @param speed pointer to the negotiator structure
+ * @param config proposed configuration
+ * @return true if the proposal was sent, false if a negotiation is in progress, the configuration is not
+ *         supported locally or the previous negotiation packet is still waiting for the link
+ */
+bool AMCOM_ProposeSpeed(AMCOM_SpeedNegotiator* speed, const AMCOM_SpeedConfig* config);
+
+/**
+ * @brief Returns the configuration the link runs at.
+ *
+ * @param speed pointer to the negotiator structure
+ */
+const AMCOM_SpeedConfig* AMCOM_GetLinkSpeed(const AMCOM_SpeedNegotiator* speed);
+
+/**
+ * @brief Records that a valid packet was received (keeps a negotiated link from falling back).
+ *
+ * Call it for every received packet; packets passed to @ref AMCOM_SpeedHandlePacket are recorded anyway.
+ * @param speed pointer to the negotiator structure
+ */
+void AMCOM_SpeedNotifyActivity(AMCOM_SpeedNegotiator* speed);
+
+/**
+ * @brief Processes a received negotiation packet.
+ *
+ * This function has the @ref AMCOM_PacketHandler signature, so it can be registered with the dispatcher for
+ * @ref AMCOM_SPEED_PACKET_TYPE. Other packets are ignored.
+ * @param packet received packet
+ * @param speed pointer to the negotiator structure
+ */
+void AMCOM_SpeedHandlePacket(const AMCOM_Packet* packet, void* speed);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_SPEED_H_ */
@@ -0,0 +1,179 @@
+#include <string.h>
+#include <assert.h>
+#include "amcom_stream.h"
+#include "amcom_parser.h"
+
+/** Starts a new frame at a SOP. */
+static void AMCOM_StreamStartFrame(AMCOM_StreamReceiver* receiver) {
+    receiver->header.sop = AMCOM_SOP;
+    receiver->frame.crc = AMCOM_INITIAL_CRC;
+    receiver->frame.receivedPacketState = AMCOM_PACKET_STATE_GOT_SOP;
+    receiver->frame.payloadCounter = 0;
+}
+
+/** Checks the CRC, reports the verdict and prepares the receiver for the next frame. Returns the verdict. */
+static bool AMCOM_StreamEndFrame(AMCOM_StreamReceiver* receiver) {
+    uint8_t length = receiver->header.length;
+    bool valid = (receiver->frame.crc == receiver->header.crc);
+    if (valid) {
+        receiver->stats.packetsOk++;
+        receiver->stats.payloadBytes += length;
+        if (length > receiver->stats.maxPayloadSize) {
+            receiver->stats.maxPayloadSize = length;
+        }
+    } else {
+        receiver->stats.crcErrors++;
+    }
+    AMCOM_ResetFrame(&receiver->frame);
+    if (receiver->handlers.onEnd) {
+        receiver->handlers.onEnd(valid, receiver->userContext);
+    }
+    return valid;
+}
+
+/** Returns the number of frame bytes received so far (SOP included). */
+static size_t AMCOM_StreamFrameBytes(const AMCOM_StreamReceiver* receiver) {
+    switch (receiver->frame.receivedPacketState) {
+    case AMCOM_PACKET_STATE_GOT_SOP:          return 1;
+    case AMCOM_PACKET_STATE_GOT_TYPE:         return 2;
+    case AMCOM_PACKET_STATE_GOT_LENGTH:       return 3;
+    case AMCOM_PACKET_STATE_GOT_CRC_LO:       return 4;
+    case AMCOM_PACKET_STATE_GETTING_PAYLOAD:  return sizeof(AMCOM_PacketHeader) + receiver->frame.payloadCounter;
+    default:                                  return 0;
+    }
+}
+
+/**
+ * Parses a chunk of data.
+ *
+ * After a frame error the bytes following the false SOP are rescanned as far as they are still available:
+ * bytes of the current chunk are simply parsed again, and so are the buffered header bytes of a frame that
+ * started in an earlier chunk. Payload bytes of earlier chunks are gone and are counted as discarded.
+ */
+static void AMCOM_StreamParse(AMCOM_StreamReceiver* receiver, const uint8_t* bytes, size_t dataSize) {
+    AMCOM_FrameState* frame = &receiver->frame;
+    // number of bytes of the current frame that came before this chunk
+    size_t carried = AMCOM_StreamFrameBytes(receiver);
+    // position of the SOP of the current frame in this chunk (valid if carried is 0)
+    size_t frameStart = 0;
+    size_t i = 0;
+
+    while (i < dataSize) {
+        uint8_t b = bytes[i];
+        bool frameError = false;
+
+        switch (frame->receivedPacketState) {
+
+        case AMCOM_PACKET_STATE_EMPTY: {
+            const uint8_t* sop = (const uint8_t*)memchr(&bytes[i], AMCOM_SOP, dataSize - i);
+            size_t skipped = sop ? (size_t)(sop - &bytes[i]) : (dataSize - i);
+            receiver->stats.bytesDiscarded += (uint32_t)skipped;
+            i += skipped;
+            if (sop) {
+                AMCOM_StreamStartFrame(receiver);
+                carried = 0;
+                frameStart = i++;
+            }
+            break;
+        }
+
+        case AMCOM_PACKET_STATE_GOT_SOP:
+            receiver->header.type = b;
+            frame->crc = AMCOM_UpdateCRCBlock(frame->crc, &b, 1);
+            frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_TYPE;
+            i++;
+            break;
+
+        case AMCOM_PACKET_STATE_GOT_TYPE:
+            i++;
+            if (b > AMCOM_MAX_PAYLOAD_SIZE) {
+                receiver->stats.lengthErrors++;
+                frameError = true;
+                break;
+            }
+            receiver->header.length = b;
+            frame->crc = AMCOM_UpdateCRCBlock(frame->crc, &b, 1);
+            frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_LENGTH;
+            break;
+
+        case AMCOM_PACKET_STATE_GOT_LENGTH:
+            receiver->header.crc = b;
+            frame->receivedPacketState = AMCOM_PACKET_STATE_GOT_CRC_LO;
+            i++;
+            break;
+
+        case AMCOM_PACKET_STATE_GOT_CRC_LO:
+            receiver->header.crc = (uint16_t)(receiver->header.crc | ((uint16_t)b << 8));
+            i++;
+            if (receiver->handlers.onBegin) {
+                receiver->handlers.onBegin(receiver->header.type, receiver->header.length, receiver->userContext);
+            }
+            if (receiver->header.length == 0) {
+                frameError = !AMCOM_StreamEndFrame(receiver);
+            } else {
+                frame->receivedPacketState = AMCOM_PACKET_STATE_GETTING_PAYLOAD;
+            }
+            break;
+
+        case AMCOM_PACKET_STATE_GETTING_PAYLOAD: {
+            // hand over the whole run of payload bytes that is available in this chunk
+            size_t run = receiver->header.length - frame->payloadCounter;
+            if (run > dataSize - i) {
+                run = dataSize - i;
+            }
+            frame->crc = AMCOM_UpdateCRCBlock(frame->crc, &bytes[i], run);
+            if (receiver->handlers.onData) {
+                receiver->handlers.onData(&bytes[i], run, frame->payloadCounter, receiver->userContext);
+            }
+            frame->payloadCounter += run;
+            i += run;
+            if (frame->payloadCounter >= receiver->header.length) {
+                frameError = !AMCOM_StreamEndFrame(receiver);
+            }
+            break;
+        }
+
+        default:
+            AMCOM_ResetFrame(frame);
+            break;
+        }
+
+        if (!frameError) {
+            continue;
+        }
+
+        // the false SOP is dropped, the bytes after it are rescanned
+        AMCOM_ResetFrame(frame);
+        receiver->stats.bytesDiscarded++;
+        if (carried == 0) {
+            i = frameStart + 1;
+        } else if (carried <= sizeof(AMCOM_PacketHeader)) {
+            uint8_t header[sizeof(AMCOM_PacketHeader) - 1] = {
+                receiver->header.type, receiver->header.length,
+                (uint8_t)(receiver->header.crc & 0xFF), (uint8_t)(receiver->header.crc >> 8)
+            };
+            AMCOM_StreamParse(receiver, header, carried - 1);
+            carried = AMCOM_StreamFrameBytes(receiver);
+            i = 0;
+        } else {
+            receiver->stats.bytesDiscarded += (uint32_t)(carried - 1);
+            carried = 0;
+            i = 0;
+        }
+    }
+}
+
+void AMCOM_InitStreamReceiver(AMCOM_StreamReceiver* receiver, const AMCOM_StreamHandlers* handlers, void* userContext) {
+    assert(receiver && handlers);
+    memset(&receiver->header, 0, sizeof(receiver->header));
+    AMCOM_InitFrame(&receiver->frame);
+    receiver->handlers    = *handlers;
+    receiver->userContext = userContext;
+    memset(&receiver->stats, 0, sizeof(receiver->stats));
+}
+
+void AMCOM_StreamDeserialize(AMCOM_StreamReceiver* receiver, const void* data, size_t dataSize) {
+    assert(receiver && data);
+    receiver->stats.bytesReceived += (uint32_t)dataSize;
+    AMCOM_StreamParse(receiver, (const uint8_t*)data, dataSize);
+}
@@ -0,0 +1,95 @@
+#ifndef AMCOM_STREAM_H_
+#define AMCOM_STREAM_H_
+
+/**
+ * This header file defines the API of the AMCOM streaming receiver.
+ *
+ * The streaming receiver parses the regular SOP framing but does not buffer the payload. Instead, every run
+ * of payload bytes found in the chunk passed to @ref AMCOM_StreamDeserialize is handed to the application
+ * straight from that chunk, and the frame is closed with a single end callback carrying the CRC verdict:
+ *
+ *     onBegin(type, length)  -> onData(...) x N  -> onEnd(true)   (commit)
+ *                                                -> onEnd(false)  (abort, discard the data)
+ *
+ * The receiver keeps only the 5-byte header, so a bulk link (firmware image, logs) can write the payload
+ * directly to flash or another ring buffer.
+ *
+ * After an invalid LENGTH or a CRC error the receiver drops the SOP of the frame and rescans the bytes after
+ * it, as far as they are still available: the bytes of the frame that are in the current chunk are parsed
+ * again, and so are the buffered header bytes of a frame that started in an earlier chunk. Payload bytes
+ * that came in earlier chunks are not buffered, so a packet that starts among them is lost. Feeding the
+ * receiver with larger chunks makes this less likely.
+ */
+
+#include <stdbool.h>
+#include "amcom.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Callbacks of the streaming receiver */
+typedef struct {
+	/**
+	 * Called when a frame with a valid LENGTH starts (the CRC is not verified yet).
+	 *
+	 * @param packetType type of the packet
+	 * @param payloadSize number of payload bytes that will follow
+	 * @param userContext user defined context associated with the receiver
+	 */
+	void (*onBegin)(uint8_t packetType, uint8_t payloadSize, void* userContext);
+	/**
+	 * Called for every run of payload bytes.
+	 *
+	 * @param data payload bytes (valid only during the call)
+	 * @param dataSize number of payload bytes
+	 * @param offset position of the first byte within the payload
+	 * @param userContext user defined context associated with the receiver
+	 */
+	void (*onData)(const uint8_t* data, size_t dataSize, size_t offset, void* userContext);
+	/**
+	 * Called when the frame is complete.
+	 *
+	 * @param valid true if the CRC matches (commit the data), false otherwise (discard the data)
+	 * @param userContext user defined context associated with the receiver
+	 */
+	void (*onEnd)(bool valid, void* userContext);
+} AMCOM_StreamHandlers;
+
+/** Structure describing the AMCOM streaming receiver */
+typedef struct {
+	/// Header of the frame being received
+	AMCOM_PacketHeader header;
+	/// State of the frame being received
+	AMCOM_FrameState frame;
+	/// User-defined callbacks
+	AMCOM_StreamHandlers handlers;
+	/// User-defined context
+	void* userContext;
+	/// Link statistics
+	AMCOM_ReceiverStats stats;
+} AMCOM_StreamReceiver;
+
+/**
+ * @brief Initializes the AMCOM streaming receiver.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param handlers callbacks of the receiver (copied; any of them may be NULL)
+ * @param userContext user defined, general purpose context, that will be fed back to the callbacks
+ */
+void AMCOM_InitStreamReceiver(AMCOM_StreamReceiver* receiver, const AMCOM_StreamHandlers* handlers, void* userContext);
+
+/**
+ * @brief Deserializes the chunk of data, streaming the payload of the frames to the callbacks.
+ *
+ * @param receiver pointer to the receiver structure
+ * @param data incoming data
+ * @param dataSize number of bytes in the incoming data
+ */
+void AMCOM_StreamDeserialize(AMCOM_StreamReceiver* receiver, const void* data, size_t dataSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* AMCOM_STREAM_H_ */
@@ -0,0 +1,284 @@
+/**
+ * Host benchmark of the COBS framing (amcom_cobs.h) against the SOP/LENGTH framing (amcom.h).
+ *
+ * The same packets (from amcom_traffic.c, with SOP-laden and zero-laden payloads) are serialized with both
+ * framings. Each stream is damaged on the wire with the same bit flip and byte drop rates and fed in chunks
+ * of random size to its receiver, whose delivered packets are matched against the ground truth. Two passes
+ * are run, a clean one and a noisy one (-f, -l). For every framing and pass the tool reports the wire
+ * overhead per packet, the decoding time per wire byte, the intact packets lost and the false packets.
+ *
+ * Checks:
+ * - clean stream: both framings deliver every packet and no false packet,
+ * - noisy stream: each framing loses at most as many intact packets as there are damaged frames (a damaged
+ *   COBS delimiter merges a frame with the next one, a damaged LENGTH may reach into the next SOP frame).
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_cobs_bench.c amcom_traffic.c ../amcom_cobs.c ../amcom.c -lm -o amcom_cobs_bench
+ *
+ * Usage:
+ *     amcom_cobs_bench [-n packets] [-a sopRate] [-z zeroRate] [-f bitFlipRate] [-l dropRate] [-s seed]
+ *
+ *     -n  number of packets per pass (default 200000)
+ *     -a  probability of a payload byte being SOP (default 0.02)
+ *     -z  probability of a payload byte being 0x00 (default 0.02)
+ *     -f  probability of a bit flip on the wire in the noisy pass (default 0.0001)
+ *     -l  probability of a dropped byte on the wire in the noisy pass (default 0.00001)
+ *     -s  seed (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_cobs.h"
+#include "amcom_traffic.h"
+
+/// Seed offset of the damage generator
+#define DAMAGE_SEED_OFFSET			0xDA11A6E
+/// Seed offset of the chunking generator (keeps the chunking independent of the stream)
+#define CHUNK_SEED_OFFSET			0x5EED
+/// Number of intact packets a damaged frame may cost at most
+#define MAX_LOSS_PER_DAMAGED_FRAME	1
+
+/** Framings compared */
+typedef enum {
+	FRAMING_SOP = 0,
+	FRAMING_COBS,
+	FRAMING_COUNT
+} Framing;
+
+static const char* const framingNames[FRAMING_COUNT] = { "SOP/LENGTH", "COBS" };
+
+/** Stream of one framing */
+typedef struct {
+	uint8_t* wire;
+	size_t size;
+	TrafficRecord* records;
+	size_t damaged;               ///< number of frames damaged on the wire
+} Stream;
+
+/** Result of one framing in one pass */
+typedef struct {
+	size_t intact;
+	size_t damaged;
+	uint64_t wireBytes;
+	uint64_t payloadBytes;
+	double nsPerByte;
+	uint64_t lost;
+	uint64_t falsePackets;
+} FramingResult;
+
+static uint64_t countedPackets;
+
+static void CountPacket(const AMCOM_Packet* packet, void* userContext) {
+	(void)packet;
+	(void)userContext;
+	countedPackets++;
+}
+
+static void CheckPacket(const AMCOM_Packet* packet, void* userContext) {
+	Traffic_Check((TrafficChecker*)userContext, packet);
+}
+
+static uint64_t NowNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Appends a frame to the stream, flipping bits and dropping bytes as configured.
+ * @return true if the frame arrives undamaged
+ */
+static bool AppendFrame(Stream* stream, const uint8_t* frame, size_t size, TrafficGenerator* damage,
+		double bitFlipRate, double dropRate) {
+	bool intact = true;
+	for (size_t i = 0; i < size; ++i) {
+		uint8_t byte = frame[i];
+		if (dropRate > 0 && Traffic_Uniform(damage) < dropRate) {
+			intact = false;
+			continue;
+		}
+		for (int bit = 0; bitFlipRate > 0 && bit < 8; ++bit) {
+			if (Traffic_Uniform(damage) < bitFlipRate) {
+				byte ^= (uint8_t)(1u << bit);
+				intact = false;
+			}
+		}
+		stream->wire[stream->size++] = byte;
+	}
+	if (!intact) {
+		stream->damaged++;
+	}
+	return intact;
+}
+
+/** Generates the packets and serializes them with both framings. */
+static void Generate(const TrafficConfig* config, size_t packets, double zeroRate, double bitFlipRate,
+		double dropRate, Stream streams[FRAMING_COUNT]) {
+	TrafficGenerator generator, damage;
+	TrafficConfig damageConfig = *config;
+	damageConfig.seed += DAMAGE_SEED_OFFSET;
+	Traffic_Init(&generator, config);
+	Traffic_Init(&damage, &damageConfig);
+
+	for (int f = 0; f < FRAMING_COUNT; ++f) {
+		streams[f].wire = malloc(packets * AMCOM_COBS_MAX_FRAME_SIZE);
+		streams[f].records = malloc(packets * sizeof(TrafficRecord));
+		streams[f].size = 0;
+		streams[f].damaged = 0;
+		if (!streams[f].wire || !streams[f].records) {
+			perror("malloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (size_t i = 0; i < packets; ++i) {
+		// the generator serializes an undamaged SOP frame; its TYPE and PAYLOAD are taken from it
+		uint8_t frame[AMCOM_MAX_PACKET_SIZE];
+		TrafficRecord record;
+		Traffic_NextPacket(&generator, frame, &record);
+		uint8_t type = frame[1];
+		uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+		memcpy(payload, &frame[sizeof(AMCOM_PacketHeader)], record.length);
+		for (size_t k = 0; k < record.length; ++k) {
+			if (zeroRate > 0 && Traffic_Uniform(&generator) < zeroRate) {
+				payload[k] = 0x00;
+			}
+		}
+		record.hash = Traffic_Hash(type, payload, record.length);
+
+		uint8_t encoded[AMCOM_COBS_MAX_FRAME_SIZE];
+		size_t size = AMCOM_Serialize(type, payload, record.length, encoded);
+		streams[FRAMING_SOP].records[i] = record;
+		streams[FRAMING_SOP].records[i].intact =
+			AppendFrame(&streams[FRAMING_SOP], encoded, size, &damage, bitFlipRate, dropRate);
+		size = AMCOM_CobsSerialize(type, payload, record.length, encoded);
+		streams[FRAMING_COBS].records[i] = record;
+		streams[FRAMING_COBS].records[i].intact =
+			AppendFrame(&streams[FRAMING_COBS], encoded, size, &damage, bitFlipRate, dropRate);
+	}
+}
+
+/** Feeds the stream to the receiver of the framing in chunks of random size. */
+static void Feed(Framing framing, const Stream* stream, const TrafficConfig* config, AMCOM_PacketHandler handler,
+		void* userContext) {
+	TrafficGenerator chunker;
+	TrafficConfig chunkConfig = *config;
+	chunkConfig.seed += CHUNK_SEED_OFFSET;
+	Traffic_Init(&chunker, &chunkConfig);
+	AMCOM_Receiver receiver;
+	AMCOM_CobsReceiver cobsReceiver;
+	AMCOM_InitReceiver(&receiver, handler, userContext);
+	AMCOM_InitCobsReceiver(&cobsReceiver, handler, userContext);
+
+	for (size_t offset = 0; offset < stream->size; ) {
+		size_t chunk = Traffic_NextChunkSize(&chunker);
+		if (chunk > stream->size - offset) {
+			chunk = stream->size - offset;
+		}
+		if (framing == FRAMING_SOP) {
+			AMCOM_Deserialize(&receiver, stream->wire + offset, chunk);
+		} else {
+			AMCOM_CobsDeserialize(&cobsReceiver, stream->wire + offset, chunk);
+		}
+		offset += chunk;
+	}
+}
+
+static void RunPass(const char* name, const TrafficConfig* config, size_t packets, double zeroRate,
+		double bitFlipRate, double dropRate, FramingResult results[FRAMING_COUNT]) {
+	Stream streams[FRAMING_COUNT];
+	Generate(config, packets, zeroRate, bitFlipRate, dropRate, streams);
+
+	printf("%s:\n", name);
+	for (int f = 0; f < FRAMING_COUNT; ++f) {
+		FramingResult* result = &results[f];
+		memset(result, 0, sizeof(*result));
+		for (size_t i = 0; i < packets; ++i) {
+			result->intact += streams[f].records[i].intact;
+			result->payloadBytes += streams[f].records[i].length;
+		}
+		result->damaged = streams[f].damaged;
+		result->wireBytes = streams[f].size;
+
+		countedPackets = 0;
+		uint64_t start = NowNs();
+		Feed((Framing)f, &streams[f], config, CountPacket, NULL);
+		result->nsPerByte = (double)(NowNs() - start) / (double)streams[f].size;
+
+		TrafficChecker checker;
+		Traffic_InitChecker(&checker, streams[f].records, packets);
+		Feed((Framing)f, &streams[f], config, CheckPacket, &checker);
+		Traffic_FinishChecker(&checker);
+		result->lost = checker.lost;
+		result->falsePackets = checker.falsePackets;
+
+		printf("  %-10s  overhead %.2f B/packet, decode %.2f ns/byte, %zu damaged frames, "
+		       "lost %llu of %zu intact (%.4f%%), false packets %llu\n", framingNames[f],
+		       (double)(result->wireBytes - result->payloadBytes) / packets, result->nsPerByte, result->damaged,
+		       (unsigned long long)result->lost, result->intact,
+		       result->intact ? 100.0 * result->lost / result->intact : 0.0,
+		       (unsigned long long)result->falsePackets);
+		free(streams[f].wire);
+		free(streams[f].records);
+	}
+}
+
+int main(int argc, char** argv) {
+	TrafficConfig config = {
+		.seed = 1, .sizeDistribution = TRAFFIC_SIZE_UNIFORM, .minSize = 0, .maxSize = AMCOM_MAX_PAYLOAD_SIZE,
+		.sopRate = 0.02, .minChunk = 1, .maxChunk = 64
+	};
+	size_t packets = 200000;
+	double zeroRate = 0.02, bitFlipRate = 0.0001, dropRate = 0.00001;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:a:z:f:l:s:")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'a': config.sopRate = atof(optarg); break;
+		case 'z': zeroRate = atof(optarg); break;
+		case 'f': bitFlipRate = atof(optarg); break;
+		case 'l': dropRate = atof(optarg); break;
+		case 's': config.seed = strtoull(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets] [-a sopRate] [-z zeroRate] [-f bitFlipRate] [-l dropRate] "
+			        "[-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (packets == 0 || config.sopRate < 0 || config.sopRate > 1 || zeroRate < 0 || zeroRate > 1
+	    || bitFlipRate < 0 || bitFlipRate > 1 || dropRate < 0 || dropRate > 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 2;
+	}
+	int failures = 0;
+	FramingResult results[FRAMING_COUNT];
+
+	// 1. clean stream: nothing may be lost or invented
+	RunPass("clean", &config, packets, zeroRate, 0, 0, results);
+	for (int f = 0; f < FRAMING_COUNT; ++f) {
+		if (results[f].lost || results[f].falsePackets) {
+			printf("FAIL: %s lost or invented packets on a clean stream\n", framingNames[f]);
+			failures++;
+		}
+	}
+
+	// 2. noisy stream: the damage must stay local
+	config.seed++;
+	RunPass("noisy", &config, packets, zeroRate, bitFlipRate, dropRate, results);
+	for (int f = 0; f < FRAMING_COUNT; ++f) {
+		if (results[f].lost > MAX_LOSS_PER_DAMAGED_FRAME * results[f].damaged) {
+			printf("FAIL: %s lost more intact packets than there are damaged frames\n", framingNames[f]);
+			failures++;
+		}
+	}
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * Host benchmark of the AMCOM payload compression (see amcom_compress.h) on recorded traffic.
+ *
+ * The packets of a capture (see amcom_capture.h) are extracted with AMCOM_Deserialize. Without a capture a
+ * synthetic telemetry corpus is generated instead; it can be saved as a capture (-o) and used as the recorded
+ * input of later runs. The corpus mixes four kinds of payloads in equal shares:
+ * - type 0x01: sensor frames of slowly changing 16-bit samples,
+ * - type 0x02: ASCII log lines built from a small vocabulary,
+ * - type 0x03: sparse bitmaps (mostly zero bytes),
+ * - type 0x04: random bytes (incompressible).
+ *
+ * Every packet is serialized with AMCOM_SerializeCompressed and with AMCOM_Serialize. The tool reports the
+ * frame size ratio (compressed / plain, in total and per packet type) and the time per payload byte of
+ * AMCOM_Compress and AMCOM_Decompress, in nanoseconds and, on x86, in TSC cycles (reference cycles, which
+ * differ from core cycles when the clock scales). The compressed frames are then deserialized and
+ * decompressed again, and the tool fails if a packet does not come back unchanged.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_compress_bench.c ../amcom_compress.c ../amcom_capture.c ../amcom.c -o amcom_compress_bench
+ *
+ * Usage:
+ *     amcom_compress_bench [-n packets] [-r repeats] [-t] [-s seed] [-o corpus.amcp] [capture.amcp]
+ *
+ *     -n  number of packets of the synthetic corpus (default 10000)
+ *     -r  number of timed passes over the corpus (default 20)
+ *     -t  use the transmitted records of the capture instead of the received ones
+ *     -s  seed of the synthetic corpus (default 1)
+ *     -o  file to save the synthetic corpus to (as a capture of received records)
+ *
+ * Exit status is 0 if every packet survives the round trip.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_capture.h"
+#include "amcom_compress.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC					1
+#endif
+
+/** Packet of the corpus */
+typedef struct {
+	uint8_t type;
+	uint8_t length;
+	uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+} CorpusPacket;
+
+/** Packets of the corpus */
+typedef struct {
+	CorpusPacket* packets;
+	size_t count;
+	size_t capacity;
+} Corpus;
+
+static void AddPacket(Corpus* corpus, uint8_t type, const uint8_t* payload, size_t length) {
+	if (corpus->count == corpus->capacity) {
+		corpus->capacity = corpus->capacity ? corpus->capacity * 2 : 1024;
+		corpus->packets = realloc(corpus->packets, corpus->capacity * sizeof(CorpusPacket));
+		if (!corpus->packets) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+	CorpusPacket* packet = &corpus->packets[corpus->count++];
+	packet->type = type;
+	packet->length = (uint8_t)length;
+	memcpy(packet->payload, payload, length);
+}
+
+static void CollectPacket(const AMCOM_Packet* packet, void* userContext) {
+	AddPacket((Corpus*)userContext, packet->header.type, packet->payload, packet->header.length);
+}
+
+static bool LoadCapture(Corpus* corpus, const char* path, AMCOM_CaptureDirection direction) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = malloc(size > 0 ? (size_t)size : 1);
+	if (!data || size < 0 || fread(data, 1, (size_t)size, file) != (size_t)size) {
+		perror(path);
+		fclose(file);
+		free(data);
+		return false;
+	}
+	fclose(file);
+
+	AMCOM_CaptureReader reader;
+	if (!AMCOM_InitCaptureReader(&reader, data, (size_t)size)) {
+		fprintf(stderr, "%s: not an AMCOM capture\n", path);
+		free(data);
+		return false;
+	}
+	AMCOM_Receiver receiver;
+	AMCOM_InitReceiver(&receiver, CollectPacket, corpus);
+	AMCOM_CaptureRecord record;
+	while (AMCOM_ReadCaptureRecord(&reader, &record)) {
+		if (record.direction == direction) {
+			AMCOM_Deserialize(&receiver, record.data, record.dataSize);
+		}
+	}
+	free(data);
+	return true;
+}
+
+static uint32_t Random(uint64_t* state) {
+	// xorshift64*
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return (uint32_t)((*state * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+static void GenerateCorpus(Corpus* corpus, size_t packets, uint64_t seed) {
+	static const char* words[] = {
+		"temp=", "rpm=", "vbat=", "status=OK ", "status=WARN ", "motor ", "left ", "right ", "err=0 ", "C ", "mV ",
+		"tick ", "sensor ", "line ", "dist=", "speed="
+	};
+	uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+	int16_t samples[48] = { 0 };
+	uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+
+	for (size_t n = 0; n < packets; ++n) {
+		size_t length = 0;
+		uint8_t type = (uint8_t)(1 + n % 4);
+		switch (type) {
+		case 1:
+			// sensor frame: counter and samples drifting by a few LSBs
+			payload[length++] = (uint8_t)n;
+			payload[length++] = (uint8_t)(n >> 8);
+			for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+				samples[i] = (int16_t)(samples[i] + (int)(Random(&state) % 5) - 2);
+				payload[length++] = (uint8_t)samples[i];
+				payload[length++] = (uint8_t)((uint16_t)samples[i] >> 8);
+			}
+			break;
+		case 2:
+			// log line
+			while (length < 120) {
+				const char* word = words[Random(&state) % (sizeof(words) / sizeof(words[0]))];
+				size_t size = strlen(word);
+				memcpy(&payload[length], word, size);
+				length += size;
+				length += (size_t)snprintf((char*)&payload[length], 8, "%u ", (unsigned)(Random(&state) % 1000));
+			}
+			break;
+		case 3:
+			// sparse bitmap
+			length = 160;
+			memset(payload, 0, length);
+			for (int i = 0; i < 8; ++i) {
+				payload[Random(&state) % length] = (uint8_t)(1u << (Random(&state) % 8));
+			}
+			break;
+		default:
+			length = 64 + Random(&state) % (AMCOM_MAX_PAYLOAD_SIZE - 63);
+			for (size_t i = 0; i < length; ++i) {
+				payload[i] = (uint8_t)Random(&state);
+			}
+			break;
+		}
+		AddPacket(corpus, type, payload, length);
+	}
+}
+
+/** Output of the corpus capture */
+typedef struct {
+	FILE* file;
+	size_t index;                 ///< index of the packet being recorded
+} CorpusWriter;
+
+static void WriteToFile(const void* data, size_t dataSize, void* userContext) {
+	fwrite(data, 1, dataSize, ((CorpusWriter*)userContext)->file);
+}
+
+static uint32_t CorpusClock(void* userContext) {
+	// one packet per millisecond
+	return (uint32_t)(((CorpusWriter*)userContext)->index * 1000u);
+}
+
+static bool SaveCorpus(const Corpus* corpus, const char* path) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		perror(path);
+		return false;
+	}
+	CorpusWriter writer = { file, 0 };
+	AMCOM_CaptureRecorder recorder;
+	AMCOM_InitCaptureRecorder(&recorder, WriteToFile, CorpusClock, &writer);
+	for (writer.index = 0; writer.index < corpus->count; ++writer.index) {
+		const CorpusPacket* packet = &corpus->packets[writer.index];
+		uint8_t frame[AMCOM_MAX_PACKET_SIZE];
+		size_t size = AMCOM_Serialize(packet->type, packet->payload, packet->length, frame);
+		AMCOM_CaptureRecordChunk(&recorder, AMCOM_CAPTURE_RX, frame, size);
+	}
+	if (fclose(file) != 0) {
+		perror(path);
+		return false;
+	}
+	return true;
+}
+
+static uint64_t NowNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t Cycles(void) {
+#ifdef HAVE_TSC
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/** Compressed form of a corpus packet */
+typedef struct {
+	uint8_t data[AMCOM_MAX_PAYLOAD_SIZE];
+	size_t size;                  ///< 0 if the payload does not compress
+} Compressed;
+
+/** Round trip check: the decompressor must deliver the corpus packets in order */
+typedef struct {
+	const Corpus* corpus;
+	size_t next;
+	size_t mismatches;
+} RoundTrip;
+
+static void CheckPacket(const AMCOM_Packet* packet, void* userContext) {
+	RoundTrip* check = (RoundTrip*)userContext;
+	if (check->next >= check->corpus->count) {
+		check->mismatches++;
+		return;
+	}
+	const CorpusPacket* expected = &check->corpus->packets[check->next++];
+	if (packet->header.type != expected->type || packet->header.length != expected->length
+	    || memcmp(packet->payload, expected->payload, expected->length) != 0) {
+		check->mismatches++;
+	}
+}
+
+static void Usage(const char* name) {
+	fprintf(stderr, "usage: %s [-n packets] [-r repeats] [-t] [-s seed] [-o corpus.amcp] [capture.amcp]\n", name);
+}
+
+int main(int argc, char** argv) {
+	size_t packets = 10000;
+	long repeats = 20;
+	uint64_t seed = 1;
+	AMCOM_CaptureDirection direction = AMCOM_CAPTURE_RX;
+	const char* outputPath = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:ts:o:")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'r': repeats = strtol(optarg, NULL, 0); break;
+		case 't': direction = AMCOM_CAPTURE_TX; break;
+		case 's': seed = strtoull(optarg, NULL, 0); break;
+		case 'o': outputPath = optarg; break;
+		default:
+			Usage(argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc - 1 || repeats < 1 || packets == 0) {
+		Usage(argv[0]);
+		return 2;
+	}
+
+	Corpus corpus = { 0 };
+	if (optind == argc - 1) {
+		if (!LoadCapture(&corpus, argv[optind], direction)) {
+			return 2;
+		}
+		printf("corpus: %s, %zu packets\n", argv[optind], corpus.count);
+	} else {
+		GenerateCorpus(&corpus, packets, seed);
+		printf("corpus: synthetic telemetry, %zu packets\n", corpus.count);
+		if (outputPath && !SaveCorpus(&corpus, outputPath)) {
+			return 2;
+		}
+	}
+	if (corpus.count == 0) {
+		fprintf(stderr, "no packets\n");
+		return 2;
+	}
+
+	// 1. frame sizes
+	uint64_t plainBytes = 0, compressedBytes = 0, payloadBytes = 0;
+	uint64_t typePlain[256] = { 0 }, typeCompressed[256] = { 0 }, typeCount[256] = { 0 };
+	uint8_t* stream = malloc(corpus.count * AMCOM_MAX_PACKET_SIZE);
+	Compressed* compressed = malloc(corpus.count * sizeof(Compressed));
+	if (!stream || !compressed) {
+		perror("malloc");
+		return 2;
+	}
+	size_t streamSize = 0;
+	for (size_t i = 0; i < corpus.count; ++i) {
+		const CorpusPacket* packet = &corpus.packets[i];
+		uint8_t frame[AMCOM_MAX_PACKET_SIZE];
+		size_t plain = AMCOM_Serialize(packet->type, packet->payload, packet->length, frame);
+		size_t size = AMCOM_SerializeCompressed(packet->type, packet->payload, packet->length, &stream[streamSize]);
+		streamSize += size;
+		plainBytes += plain;
+		compressedBytes += size;
+		payloadBytes += packet->length;
+		typePlain[packet->type] += plain;
+		typeCompressed[packet->type] += size;
+		typeCount[packet->type]++;
+		compressed[i].size = AMCOM_Compress(packet->payload, packet->length, compressed[i].data,
+		                                    sizeof(compressed[i].data));
+	}
+	printf("frames: %llu bytes plain, %llu bytes compressed, ratio %.3f\n", (unsigned long long)plainBytes,
+	       (unsigned long long)compressedBytes, (double)compressedBytes / plainBytes);
+	int types = 0;
+	for (int t = 0; t < 256; ++t) {
+		types += typeCount[t] > 0;
+	}
+	for (int t = 0; t < 256 && types <= 16; ++t) {
+		if (typeCount[t]) {
+			printf("  type 0x%02X: %llu packets, ratio %.3f\n", t, (unsigned long long)typeCount[t],
+			       (double)typeCompressed[t] / typePlain[t]);
+		}
+	}
+
+	// 2. speed
+	volatile size_t sink = 0;
+	uint8_t output[AMCOM_MAX_PAYLOAD_SIZE];
+	uint64_t startNs = NowNs(), startCycles = Cycles();
+	for (long r = 0; r < repeats; ++r) {
+		for (size_t i = 0; i < corpus.count; ++i) {
+			sink += AMCOM_Compress(corpus.packets[i].payload, corpus.packets[i].length, output, sizeof(output));
+		}
+	}
+	double compressNs = (double)(NowNs() - startNs) / ((double)payloadBytes * repeats);
+	double compressCycles = (double)(Cycles() - startCycles) / ((double)payloadBytes * repeats);
+
+	uint64_t decompressedBytes = 0;
+	startNs = NowNs();
+	startCycles = Cycles();
+	for (long r = 0; r < repeats; ++r) {
+		for (size_t i = 0; i < corpus.count; ++i) {
+			size_t size = 0;
+			if (compressed[i].size) {
+				AMCOM_Decompress(compressed[i].data, compressed[i].size, output, sizeof(output), &size);
+				decompressedBytes += size;
+			}
+		}
+	}
+	double decompressNs = decompressedBytes ? (double)(NowNs() - startNs) / decompressedBytes : 0;
+	double decompressCycles = decompressedBytes ? (double)(Cycles() - startCycles) / decompressedBytes : 0;
+	printf("compress:   %.2f ns/byte", compressNs);
+#ifdef HAVE_TSC
+	printf(", %.1f TSC cycles/byte", compressCycles);
+#endif
+	printf("\ndecompress: %.2f ns/byte", decompressNs);
+#ifdef HAVE_TSC
+	printf(", %.1f TSC cycles/byte", decompressCycles);
+#endif
+	printf(" (of decompressed data)\n");
+	(void)compressCycles;
+	(void)decompressCycles;
+
+	// 3. round trip through the receiver and the decompressor
+	RoundTrip check = { &corpus, 0, 0 };
+	AMCOM_Decompressor decompressor;
+	AMCOM_InitDecompressor(&decompressor, CheckPacket, &check);
+	AMCOM_Receiver receiver;
+	AMCOM_InitReceiver(&receiver, AMCOM_DecompressPacket, &decompressor);
+	AMCOM_Deserialize(&receiver, stream, streamSize);
+	bool ok = check.next == corpus.count && check.mismatches == 0 && decompressor.errors == 0;
+	printf("round trip: %zu of %zu packets, %zu mismatches, %u decompression errors\n", check.next, corpus.count,
+	       check.mismatches, (unsigned)decompressor.errors);
+
+	free(stream);
+	free(compressed);
+	free(corpus.packets);
+	printf(ok ? "PASSED\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * Host conformance test of the CRC-32 frame variant (see amcom_crc32.h).
+ *
+ * The CRC-32 of AMCOM_CalculateCRC32 (slicing-by-8 on the host) is compared against a bit-by-bit model of
+ * the STM32F4 CRC unit fed with the very words the target writes to CRC->DR. The model itself is checked
+ * against the value the CRC unit gives for the single word 0x12345678. Random packets of every payload
+ * size are then framed with AMCOM_Crc32Serialize, mixed with noise and false SOPs, and the receiver must
+ * deliver every one of them intact.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_crc32_check.c ../amcom_crc32.c -o amcom_crc32_check
+ *
+ * Usage:
+ *     amcom_crc32_check [-n rounds] [-s seed]
+ *
+ *     -n  number of random packets per payload size (default 1000)
+ *     -s  seed of the random generator (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom_crc32.h"
+
+/** Model of the CRC unit: CRC->CR = RESET, then CRC->DR = word for every word. */
+typedef struct {
+	uint32_t dr;
+} CrcUnitModel;
+
+static void ModelReset(CrcUnitModel* unit) {
+	unit->dr = 0xFFFFFFFFu;
+}
+
+static void ModelWrite(CrcUnitModel* unit, uint32_t word) {
+	uint32_t crc = unit->dr ^ word;
+	for (int bit = 0; bit < 32; ++bit) {
+		crc = (crc & 0x80000000u) ? ((crc << 1) ^ 0x04C11DB7u) : (crc << 1);
+	}
+	unit->dr = crc;
+}
+
+/** Calculates the packet CRC the way the target does (words as read by the little-endian Cortex-M4). */
+static uint32_t ModelPacketCRC(uint8_t packetType, const uint8_t* payload, size_t payloadSize) {
+	CrcUnitModel unit;
+	ModelReset(&unit);
+	ModelWrite(&unit, (uint32_t)packetType | ((uint32_t)payloadSize << 8));
+	for (size_t i = 0; i < payloadSize; i += 4) {
+		uint32_t word = 0;
+		for (size_t k = 0; k < 4 && i + k < payloadSize; ++k) {
+			word |= (uint32_t)payload[i + k] << (8 * k);
+		}
+		ModelWrite(&unit, word);
+	}
+	return unit.dr;
+}
+
+typedef struct {
+	const uint8_t* expected;
+	size_t expectedCount;
+	size_t delivered;
+	bool mismatch;
+} ReceiveContext;
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	ReceiveContext* context = (ReceiveContext*)userContext;
+	if (context->delivered >= context->expectedCount) {
+		context->mismatch = true;
+		return;
+	}
+	// expected packets: type = index, payload = index repeated
+	uint8_t index = context->expected[context->delivered++];
+	if (packet->header.type != index || packet->header.length != (uint8_t)(index % (AMCOM_MAX_PAYLOAD_SIZE + 1))) {
+		context->mismatch = true;
+		return;
+	}
+	for (size_t i = 0; i < packet->header.length; ++i) {
+		if (packet->payload[i] != (uint8_t)(index + i)) {
+			context->mismatch = true;
+			return;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	unsigned long rounds = 1000;
+	unsigned seed = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch (opt) {
+		case 'n': rounds = strtoul(optarg, NULL, 0); break;
+		case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n rounds] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	srand(seed);
+	AMCOM_InitCRC32();
+	int failures = 0;
+
+	// 1. the model against the known value of the CRC unit
+	CrcUnitModel unit;
+	ModelReset(&unit);
+	ModelWrite(&unit, 0x12345678u);
+	if (unit.dr != 0xDF8A8A2Bu) {
+		printf("FAIL: CRC unit model gives %08X for 0x12345678 (expected DF8A8A2B)\n", (unsigned)unit.dr);
+		failures++;
+	}
+
+	// 2. slicing-by-8 against the model for every payload size and random content
+	uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+	unsigned long compared = 0;
+	for (size_t size = 0; size <= AMCOM_MAX_PAYLOAD_SIZE; ++size) {
+		for (unsigned long r = 0; r < rounds; ++r) {
+			uint8_t type = (uint8_t)rand();
+			for (size_t i = 0; i < size; ++i) {
+				payload[i] = (uint8_t)rand();
+			}
+			uint32_t expected = ModelPacketCRC(type, payload, size);
+			uint32_t actual = AMCOM_CalculateCRC32(type, size ? payload : NULL, size);
+			compared++;
+			if (actual != expected) {
+				if (failures++ < 10) {
+					printf("FAIL: type %02X size %zu: %08X != %08X (model)\n", type, size, (unsigned)actual, (unsigned)expected);
+				}
+			}
+		}
+	}
+	printf("%lu packet CRCs compared against the CRC unit model\n", compared);
+
+	// 3. framing round trip through noise
+	enum { PACKETS = 256 };
+	static uint8_t stream[PACKETS * (AMCOM_CRC32_MAX_FRAME_SIZE + 8)];
+	static uint8_t expected[PACKETS];
+	size_t streamSize = 0;
+	for (size_t n = 0; n < PACKETS; ++n) {
+		uint8_t length = (uint8_t)(n % (AMCOM_MAX_PAYLOAD_SIZE + 1));
+		for (size_t i = 0; i < length; ++i) {
+			payload[i] = (uint8_t)(n + i);
+		}
+		expected[n] = (uint8_t)n;
+		streamSize += AMCOM_Crc32Serialize((uint8_t)n, payload, length, &stream[streamSize]);
+		// noise between the frames, often with a false SOP
+		size_t noise = (size_t)rand() % 8;
+		for (size_t i = 0; i < noise; ++i) {
+			stream[streamSize++] = (rand() % 3 == 0) ? 0xA2 : (uint8_t)rand();
+		}
+	}
+	AMCOM_Crc32Receiver receiver;
+	ReceiveContext context = { expected, PACKETS, 0, false };
+	AMCOM_InitCrc32Receiver(&receiver, OnPacket, &context);
+	for (size_t pos = 0; pos < streamSize; ) {
+		size_t chunk = 1 + (size_t)rand() % 64;
+		if (chunk > streamSize - pos) {
+			chunk = streamSize - pos;
+		}
+		AMCOM_Crc32Deserialize(&receiver, &stream[pos], chunk);
+		pos += chunk;
+	}
+	// a trailing false SOP may hold back the last packet until more bytes arrive
+	static const uint8_t flush[AMCOM_CRC32_MAX_FRAME_SIZE] = { 0 };
+	AMCOM_Crc32Deserialize(&receiver, flush, sizeof(flush));
+	if (context.mismatch || context.delivered != PACKETS) {
+		printf("FAIL: receiver delivered %zu of %d packets%s\n", context.delivered, PACKETS,
+				context.mismatch ? " (with mismatches)" : "");
+		failures++;
+	}
+	printf("%zu of %d framed packets received (crc errors %u, length errors %u, discarded %u)\n",
+			context.delivered, PACKETS, receiver.stats.crcErrors, receiver.stats.lengthErrors, receiver.stats.bytesDiscarded);
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
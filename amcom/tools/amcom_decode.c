@@ -0,0 +1,226 @@
+/**
+ * Host tool decoding AMCOM capture files (raw serial streams) in parallel.
+ *
+ * The capture is memory-mapped and split into one chunk per thread. Every chunk boundary is moved forward to
+ * the nearest position holding a complete frame with a valid CRC, so each thread starts in sync and decodes
+ * its chunk with its own AMCOM_Receiver. Per-type counts and receiver statistics are summed, and the packet
+ * listings (-v) are printed in stream order.
+ *
+ * The result equals a single-threaded decode, except for a frame that is corrupted right at a chunk boundary
+ * or a false boundary candidate whose CRC happens to match.
+ *
+ * Build (Linux):
+ *     gcc -O2 -pthread -I.. amcom_decode.c ../amcom.c -o amcom_decode
+ *
+ * Usage:
+ *     amcom_decode [-j threads] [-v] capture.bin
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "amcom.h"
+
+/// Start of packet character
+#define SOP							0xA1
+/// Minimal chunk size worth a separate thread
+#define MIN_CHUNK_SIZE				(1024 * 1024)
+
+/// Growable text buffer holding the packet listing of a chunk
+typedef struct {
+	char* data;
+	size_t size;
+	size_t capacity;
+} TextBuffer;
+
+/// Work and results of a single decoding thread
+typedef struct {
+	pthread_t thread;
+	const uint8_t* capture;
+	size_t captureSize;
+	size_t begin;                 // nominal chunk start
+	size_t end;                   // nominal chunk end
+	bool verbose;
+	AMCOM_Receiver receiver;
+	uint64_t typeCounts[256];
+	TextBuffer listing;
+} Worker;
+
+/** Checks if a complete frame with a valid CRC starts at the given position. */
+static bool IsValidFrame(const uint8_t* p, size_t available) {
+	if (available < sizeof(AMCOM_PacketHeader) || p[0] != SOP || p[2] > AMCOM_MAX_PAYLOAD_SIZE
+		|| available < sizeof(AMCOM_PacketHeader) + p[2]) {
+		return false;
+	}
+	uint16_t crc = (uint16_t)(p[3] | (p[4] << 8));
+	return crc == AMCOM_CalculateCRC(p[1], p + sizeof(AMCOM_PacketHeader), p[2]);
+}
+
+/** Returns the first position at or after offset where a valid frame starts (or the capture size). */
+static size_t FindSyncPoint(const uint8_t* capture, size_t size, size_t offset) {
+	if (offset == 0) {
+		return 0;
+	}
+	while (offset < size) {
+		const uint8_t* sop = memchr(capture + offset, SOP, size - offset);
+		if (!sop) {
+			return size;
+		}
+		offset = (size_t)(sop - capture);
+		if (IsValidFrame(sop, size - offset)) {
+			return offset;
+		}
+		offset++;
+	}
+	return size;
+}
+
+static void AppendText(TextBuffer* buffer, const char* text, size_t length) {
+	if (buffer->size + length > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity * 2 : 64 * 1024;
+		while (capacity < buffer->size + length) {
+			capacity *= 2;
+		}
+		char* data = realloc(buffer->data, capacity);
+		if (!data) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+		buffer->data = data;
+		buffer->capacity = capacity;
+	}
+	memcpy(buffer->data + buffer->size, text, length);
+	buffer->size += length;
+}
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	Worker* worker = (Worker*)userContext;
+	worker->typeCounts[packet->header.type]++;
+
+	if (worker->verbose) {
+		char line[16 + 3 * AMCOM_MAX_PAYLOAD_SIZE];
+		int length = snprintf(line, sizeof(line), "%02X %3u:", packet->header.type, packet->header.length);
+		for (size_t i = 0; i < packet->header.length; ++i) {
+			length += snprintf(line + length, sizeof(line) - (size_t)length, " %02X", packet->payload[i]);
+		}
+		line[length++] = '\n';
+		AppendText(&worker->listing, line, (size_t)length);
+	}
+}
+
+static void* DecodeChunk(void* arg) {
+	Worker* worker = (Worker*)arg;
+	size_t begin = FindSyncPoint(worker->capture, worker->captureSize, worker->begin);
+	size_t end = FindSyncPoint(worker->capture, worker->captureSize, worker->end);
+
+	AMCOM_InitReceiver(&worker->receiver, OnPacket, worker);
+	if (begin < end) {
+		AMCOM_Deserialize(&worker->receiver, worker->capture + begin, end - begin);
+	}
+	return NULL;
+}
+
+int main(int argc, char** argv) {
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	bool verbose = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:v")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = strtol(optarg, NULL, 0);
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-j threads] [-v] capture.bin\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || threads < 1) {
+		fprintf(stderr, "usage: %s [-j threads] [-v] capture.bin\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int fd = open(argv[optind], O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	size_t size = (size_t)st.st_size;
+	const uint8_t* capture = NULL;
+	if (size > 0) {
+		capture = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (capture == MAP_FAILED) {
+			perror("mmap");
+			return EXIT_FAILURE;
+		}
+		madvise((void*)capture, size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	if ((size_t)threads > size / MIN_CHUNK_SIZE) {
+		threads = (long)(size / MIN_CHUNK_SIZE) + 1;
+	}
+
+	Worker* workers = calloc((size_t)threads, sizeof(Worker));
+	if (!workers) {
+		perror("calloc");
+		return EXIT_FAILURE;
+	}
+	for (long i = 0; i < threads; ++i) {
+		workers[i].capture     = capture;
+		workers[i].captureSize = size;
+		workers[i].begin       = size / (size_t)threads * (size_t)i;
+		workers[i].end         = (i + 1 == threads) ? size : size / (size_t)threads * (size_t)(i + 1);
+		workers[i].verbose     = verbose;
+		if (pthread_create(&workers[i].thread, NULL, DecodeChunk, &workers[i]) != 0) {
+			perror("pthread_create");
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint64_t typeCounts[256] = {0};
+	uint64_t packets = 0, crcErrors = 0, lengthErrors = 0, discarded = 0, payloadBytes = 0;
+	for (long i = 0; i < threads; ++i) {
+		pthread_join(workers[i].thread, NULL);
+		if (verbose && workers[i].listing.size) {
+			fwrite(workers[i].listing.data, 1, workers[i].listing.size, stdout);
+		}
+		free(workers[i].listing.data);
+
+		for (int t = 0; t < 256; ++t) {
+			typeCounts[t] += workers[i].typeCounts[t];
+		}
+		const AMCOM_ReceiverStats* stats = &workers[i].receiver.stats;
+		packets      += stats->packetsOk;
+		crcErrors    += stats->crcErrors;
+		lengthErrors += stats->lengthErrors;
+		discarded    += stats->bytesDiscarded;
+		payloadBytes += stats->payloadBytes;
+	}
+
+	printf("bytes: %zu, threads: %ld\n", size, threads);
+	printf("packets: %llu, payload bytes: %llu, discarded bytes: %llu, CRC errors: %llu, length errors: %llu\n",
+	       (unsigned long long)packets, (unsigned long long)payloadBytes, (unsigned long long)discarded,
+	       (unsigned long long)crcErrors, (unsigned long long)lengthErrors);
+	for (int t = 0; t < 256; ++t) {
+		if (typeCounts[t]) {
+			printf("type 0x%02X: %llu\n", t, (unsigned long long)typeCounts[t]);
+		}
+	}
+
+	free(workers);
+	if (capture) {
+		munmap((void*)capture, size);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+/**
+ * Host simulation of the AMCOM link flow control (see amcom_flow.h) over a simulated UART.
+ *
+ * Two ends are connected by a simulated full-duplex UART running on a simulated millisecond clock. Each end
+ * has a receive ring (-r) that drops the bytes arriving while it is full, like the USART receive ring, and a
+ * small transmit buffer. Both ends send a stream of packets from amcom_traffic.c through AMCOM_FlowWrite as
+ * fast as the flow control lets them and read their receive ring through AMCOM_FlowDeserialize every
+ * millisecond, except that the reader of the first end stalls for a while (-t) once it has sent a credit
+ * packet 500 ms into the run.
+ * The packets delivered by both ends are matched against the ground truth.
+ *
+ * Checks:
+ * - no byte is dropped by a receive ring, so no frame is damaged (no CRC error),
+ * - every packet is delivered and no false packet.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_flow_sim.c amcom_traffic.c ../amcom_flow.c ../amcom.c -lm -o amcom_flow_sim
+ *
+ * Usage:
+ *     amcom_flow_sim [-n packets] [-r rxBuffer] [-b baud] [-t stallMs] [-s seed]
+ *
+ *     -n  number of packets sent by each end (default 2000)
+ *     -r  size of the receive ring of both ends in bytes (default 1024)
+ *     -b  baud rate of the UART, 10 bits per byte (default 115200)
+ *     -t  duration of the reader stall of the first end [ms] (default 1500)
+ *     -s  seed (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_flow.h"
+#include "amcom_traffic.h"
+
+/// Size of the transmit buffer of both ends
+#define TX_BUFFER_SIZE				64
+/// Largest receive ring accepted by -r
+#define MAX_RX_BUFFER_SIZE			AMCOM_FLOW_MAX_BUFFER_SIZE
+/// Earliest start of the reader stall of the first end [ms]
+#define STALL_START_MS				500
+/// Simulated time after which the run is given up [ms]
+#define TIME_LIMIT_MS				600000
+
+/** Byte FIFO (transmit buffer or receive ring) */
+typedef struct {
+	uint8_t* data;
+	size_t capacity;
+	size_t head;
+	size_t size;
+} Fifo;
+
+/** One end of the link */
+typedef struct {
+	AMCOM_Flow flow;
+	AMCOM_Receiver receiver;
+	TrafficChecker checker;     ///< matches the packets of the other end
+	Fifo tx;
+	Fifo rx;
+	uint8_t* stream;            ///< serialized packets to send
+	size_t streamSize;
+	size_t streamOffset;        ///< bytes of the stream accepted by AMCOM_FlowWrite
+	TrafficRecord* records;     ///< ground truth of the stream
+	uint64_t bitBudget;         ///< bits the UART may still send in the current millisecond
+	uint64_t dropped;           ///< bytes dropped by the receive ring
+} End;
+
+static uint64_t simTime;
+
+static uint64_t GetTicks(void) {
+	return simTime;
+}
+
+static size_t FifoPush(Fifo* fifo, const uint8_t* data, size_t size) {
+	size_t n = 0;
+	while (n < size && fifo->size < fifo->capacity) {
+		fifo->data[(fifo->head + fifo->size++) % fifo->capacity] = data[n++];
+	}
+	return n;
+}
+
+static size_t FifoPop(Fifo* fifo, uint8_t* data, size_t size) {
+	size_t n = 0;
+	while (n < size && fifo->size > 0) {
+		data[n++] = fifo->data[fifo->head];
+		fifo->head = (fifo->head + 1) % fifo->capacity;
+		fifo->size--;
+	}
+	return n;
+}
+
+/** Write function of an end: takes what fits into the transmit buffer. */
+static size_t WriteTx(const void* data, size_t dataSize, void* userContext) {
+	return FifoPush(&((End*)userContext)->tx, (const uint8_t*)data, dataSize);
+}
+
+/** Packet handler of an end: credit packets go to the flow control, the rest to the checker. */
+static void HandlePacket(const AMCOM_Packet* packet, void* userContext) {
+	End* end = (End*)userContext;
+	if (packet->header.type == AMCOM_FLOW_CREDIT_PACKET_TYPE) {
+		AMCOM_FlowHandlePacket(packet, &end->flow);
+	} else {
+		Traffic_Check(&end->checker, packet);
+	}
+}
+
+/** Generates the packets of an end (none of the credit packet type). */
+static void Generate(End* end, const TrafficConfig* config, size_t packets) {
+	TrafficGenerator generator;
+	Traffic_Init(&generator, config);
+	end->stream = malloc(packets * AMCOM_MAX_PACKET_SIZE);
+	end->records = malloc(packets * sizeof(TrafficRecord));
+	if (!end->stream || !end->records) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	end->streamSize = 0;
+	for (size_t i = 0; i < packets; ) {
+		size_t size = Traffic_NextPacket(&generator, end->stream + end->streamSize, &end->records[i]);
+		if (end->stream[end->streamSize + 1] != AMCOM_FLOW_CREDIT_PACKET_TYPE) {
+			end->streamSize += size;
+			i++;
+		}
+	}
+}
+
+static bool InitEnd(End* end, size_t rxBufferSize) {
+	end->tx.data = malloc(TX_BUFFER_SIZE);
+	end->tx.capacity = TX_BUFFER_SIZE;
+	end->rx.data = malloc(rxBufferSize);
+	end->rx.capacity = rxBufferSize;
+	if (!end->tx.data || !end->rx.data) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	AMCOM_InitReceiver(&end->receiver, HandlePacket, end);
+	return AMCOM_InitFlow(&end->flow, WriteTx, end, GetTicks, rxBufferSize);
+}
+
+/** Moves the bytes the UART sends within a millisecond from the transmit buffer to the receive ring of the peer. */
+static void Transmit(End* from, End* to, unsigned baud) {
+	from->bitBudget += baud / 1000;
+	while (from->bitBudget >= 10 && from->tx.size > 0) {
+		uint8_t byte;
+		FifoPop(&from->tx, &byte, 1);
+		from->bitBudget -= 10;
+		if (FifoPush(&to->rx, &byte, 1) == 0) {
+			to->dropped++;
+		}
+	}
+	if (from->tx.size == 0) {
+		from->bitBudget = 0;
+	}
+}
+
+/** Runs the application of an end for a millisecond: reads the receive ring, sends and polls the flow control. */
+static void RunEnd(End* end, bool readerStalled) {
+	if (!readerStalled) {
+		uint8_t buffer[MAX_RX_BUFFER_SIZE];
+		size_t n = FifoPop(&end->rx, buffer, sizeof(buffer));
+		AMCOM_FlowDeserialize(&end->flow, &end->receiver, buffer, n);
+	}
+	end->streamOffset += AMCOM_FlowWrite(end->stream + end->streamOffset, end->streamSize - end->streamOffset,
+	                                     &end->flow);
+	AMCOM_FlowPoll(&end->flow);
+}
+
+int main(int argc, char** argv) {
+	TrafficConfig config = {
+		.seed = 1, .sizeDistribution = TRAFFIC_SIZE_UNIFORM, .minSize = 0, .maxSize = AMCOM_MAX_PAYLOAD_SIZE,
+		.sopRate = 0.02, .minChunk = 1, .maxChunk = 1
+	};
+	size_t packets = 2000, rxBufferSize = 1024;
+	unsigned baud = 115200;
+	uint64_t stallMs = 1500;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:b:t:s:")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'r': rxBufferSize = strtoul(optarg, NULL, 0); break;
+		case 'b': baud = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 't': stallMs = strtoull(optarg, NULL, 0); break;
+		case 's': config.seed = strtoull(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets] [-r rxBuffer] [-b baud] [-t stallMs] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (packets == 0 || rxBufferSize > MAX_RX_BUFFER_SIZE || baud < 10000) {
+		fprintf(stderr, "invalid arguments\n");
+		return 2;
+	}
+
+	static End ends[2];
+	for (int e = 0; e < 2; ++e) {
+		if (!InitEnd(&ends[e], rxBufferSize)) {
+			fprintf(stderr, "receive ring too small for the flow control\n");
+			return 2;
+		}
+		config.seed++;
+		Generate(&ends[e], &config, packets);
+	}
+	Traffic_InitChecker(&ends[0].checker, ends[1].records, packets);
+	Traffic_InitChecker(&ends[1].checker, ends[0].records, packets);
+
+	// the stall starts right after a credit packet of the first end, so the peer knows about every byte read
+	uint64_t stallStart = 0;
+	for (simTime = 1; simTime < TIME_LIMIT_MS; ++simTime) {
+		bool stalled = stallStart && simTime < stallStart + stallMs;
+		uint32_t creditsSent = ends[0].flow.stats.creditsSent;
+		RunEnd(&ends[0], stalled);
+		if (!stallStart && simTime >= STALL_START_MS && ends[0].flow.stats.creditsSent != creditsSent) {
+			stallStart = simTime + 1;
+		}
+		RunEnd(&ends[1], false);
+		Transmit(&ends[0], &ends[1], baud);
+		Transmit(&ends[1], &ends[0], baud);
+		if (ends[0].checker.delivered == packets && ends[1].checker.delivered == packets) {
+			break;
+		}
+	}
+
+	int failures = 0;
+	printf("%zu packets per end, %zu B receive rings, %u baud, reader stall %llu ms, done after %llu ms\n",
+	       packets, rxBufferSize, baud, (unsigned long long)stallMs, (unsigned long long)simTime);
+	for (int e = 0; e < 2; ++e) {
+		End* end = &ends[e];
+		Traffic_FinishChecker(&end->checker);
+		printf("  end %d%s: dropped %llu B, CRC errors %lu, delivered %llu, lost %llu, false %llu, "
+		       "credits sent %lu, window stalls %lu\n", e, e == 0 ? " (stalled)" : "",
+		       (unsigned long long)end->dropped, (unsigned long)end->receiver.stats.crcErrors,
+		       (unsigned long long)end->checker.delivered, (unsigned long long)end->checker.lost,
+		       (unsigned long long)end->checker.falsePackets, (unsigned long)end->flow.stats.creditsSent,
+		       (unsigned long)end->flow.stats.windowStalls);
+		if (end->dropped || end->receiver.stats.crcErrors) {
+			printf("FAIL: end %d dropped bytes or got damaged frames\n", e);
+			failures++;
+		}
+		if (end->checker.lost || end->checker.falsePackets || end->checker.delivered != packets) {
+			printf("FAIL: end %d did not get every packet exactly\n", e);
+			failures++;
+		}
+	}
+
+	for (int e = 0; e < 2; ++e) {
+		free(ends[e].stream);
+		free(ends[e].records);
+		free(ends[e].tx.data);
+		free(ends[e].rx.data);
+	}
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * Host regression check of the reassembler (amcom_fragment.h) after messages that lost their last fragment.
+ *
+ * Every channel sends a series of fragmented messages of random size, each channel with its own packet type
+ * and message ids. The fragments of the channels are interleaved round robin, serialized and fed in chunks
+ * of random size to AMCOM_Deserialize, which hands them to AMCOM_Reassemble. The reassembler has one slot per
+ * channel. The last fragment of some messages is lost (-l), so their slots are never completed, and other
+ * fragments are lost at random (-d). The messages delivered by the reassembler are matched against the
+ * messages sent by their channel.
+ *
+ * Checks:
+ * - every message that lost none of its fragments is delivered (a slot left behind by a lost last fragment
+ *   must not keep the following messages out),
+ * - no message is delivered that lost a fragment or was never sent.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_fragment_check.c amcom_traffic.c ../amcom_fragment.c ../amcom.c -lm -o amcom_fragment_check
+ *
+ * Usage:
+ *     amcom_fragment_check [-n messages] [-c channels] [-m maxMessageSize] [-l lostTailRate] [-d dropRate] [-s seed]
+ *
+ *     -n  number of messages per channel (default 20000)
+ *     -c  number of channels and reassembly slots (default 3)
+ *     -m  largest message size in bytes (default 1000)
+ *     -l  probability of a message losing its last fragment (default 0.05)
+ *     -d  probability of any other fragment being lost (default 0.001)
+ *     -s  seed (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_fragment.h"
+#include "amcom_traffic.h"
+
+/// Largest number of channels
+#define MAX_CHANNELS				8
+/// Packet type of the first channel
+#define FIRST_CHANNEL_TYPE			0x10
+/// Largest message size accepted by -m
+#define MAX_MESSAGE_SIZE			65536
+
+/** Ground truth of a sent message */
+typedef struct {
+	uint64_t hash;
+	bool intact;                ///< none of its fragments was lost
+} MessageRecord;
+
+/** Sending side of a channel */
+typedef struct {
+	uint8_t type;
+	MessageRecord* records;
+	size_t sent;                ///< messages started so far
+	size_t checked;             ///< first record not matched or passed yet
+	uint8_t message[MAX_MESSAGE_SIZE];
+	size_t size;
+	size_t index;               ///< next fragment of the current message
+	size_t count;               ///< fragments of the current message (0 if no message is in progress)
+	bool loseTail;
+} Channel;
+
+/** Result of matching the delivered messages against the sent ones */
+typedef struct {
+	Channel* channels;
+	size_t channelCount;
+	uint64_t delivered;
+	uint64_t lost;
+	uint64_t falseMessages;
+} Checker;
+
+static void CheckMessage(uint8_t packetType, const uint8_t* message, size_t messageSize, void* userContext) {
+	Checker* checker = (Checker*)userContext;
+	checker->delivered++;
+	if (packetType < FIRST_CHANNEL_TYPE || packetType >= FIRST_CHANNEL_TYPE + checker->channelCount) {
+		checker->falseMessages++;
+		return;
+	}
+	Channel* channel = &checker->channels[packetType - FIRST_CHANNEL_TYPE];
+	uint64_t hash = Traffic_Hash(packetType, message, messageSize);
+	for (size_t i = channel->checked; i < channel->sent; ++i) {
+		if (channel->records[i].hash == hash && channel->records[i].intact) {
+			// the intact messages passed on the way were lost
+			for (size_t k = channel->checked; k < i; ++k) {
+				checker->lost += channel->records[k].intact;
+			}
+			channel->checked = i + 1;
+			return;
+		}
+	}
+	checker->falseMessages++;
+}
+
+/** Starts the next message of the channel. */
+static void StartMessage(Channel* channel, TrafficGenerator* generator, size_t maxMessageSize, double lostTailRate) {
+	channel->size = (size_t)(Traffic_Random(generator) % (maxMessageSize + 1));
+	for (size_t i = 0; i < channel->size; ++i) {
+		channel->message[i] = (uint8_t)Traffic_Random(generator);
+	}
+	channel->index = 0;
+	channel->count = AMCOM_GetFragmentCount(channel->size);
+	channel->loseTail = channel->count > 1 && Traffic_Uniform(generator) < lostTailRate;
+	channel->records[channel->sent].hash = Traffic_Hash(channel->type, channel->message, channel->size);
+	channel->records[channel->sent].intact = !channel->loseTail;
+	channel->sent++;
+}
+
+int main(int argc, char** argv) {
+	TrafficConfig config = {
+		.seed = 1, .sizeDistribution = TRAFFIC_SIZE_UNIFORM, .minSize = 0, .maxSize = AMCOM_MAX_PAYLOAD_SIZE,
+		.minChunk = 1, .maxChunk = 64
+	};
+	size_t messages = 20000, channelCount = 3, maxMessageSize = 1000;
+	double lostTailRate = 0.05, dropRate = 0.001;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:c:m:l:d:s:")) != -1) {
+		switch (opt) {
+		case 'n': messages = strtoul(optarg, NULL, 0); break;
+		case 'c': channelCount = strtoul(optarg, NULL, 0); break;
+		case 'm': maxMessageSize = strtoul(optarg, NULL, 0); break;
+		case 'l': lostTailRate = atof(optarg); break;
+		case 'd': dropRate = atof(optarg); break;
+		case 's': config.seed = strtoull(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n messages] [-c channels] [-m maxMessageSize] [-l lostTailRate] "
+			        "[-d dropRate] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (messages == 0 || channelCount == 0 || channelCount > MAX_CHANNELS
+	    || maxMessageSize > MAX_MESSAGE_SIZE || lostTailRate < 0 || lostTailRate > 1
+	    || dropRate < 0 || dropRate > 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 2;
+	}
+
+	TrafficGenerator generator;
+	Traffic_Init(&generator, &config);
+	static Channel channels[MAX_CHANNELS];
+	for (size_t c = 0; c < channelCount; ++c) {
+		channels[c].type = (uint8_t)(FIRST_CHANNEL_TYPE + c);
+		channels[c].records = calloc(messages, sizeof(MessageRecord));
+		if (!channels[c].records) {
+			perror("malloc");
+			return EXIT_FAILURE;
+		}
+	}
+	Checker checker = { .channels = channels, .channelCount = channelCount };
+
+	AMCOM_ReassemblySlot slots[MAX_CHANNELS];
+	size_t poolSize = channelCount * (maxMessageSize ? maxMessageSize : 1);
+	uint8_t* pool = malloc(poolSize);
+	AMCOM_Reassembler reassembler;
+	AMCOM_Receiver receiver;
+	if (!pool || !AMCOM_InitReassembler(&reassembler, slots, channelCount, pool, poolSize, CheckMessage, &checker)) {
+		fprintf(stderr, "reassembler initialization failed\n");
+		return EXIT_FAILURE;
+	}
+	AMCOM_InitReceiver(&receiver, AMCOM_Reassemble, &reassembler);
+
+	uint64_t fragments = 0, lostFragments = 0;
+	bool busy = true;
+	while (busy) {
+		busy = false;
+		for (size_t c = 0; c < channelCount; ++c) {
+			Channel* channel = &channels[c];
+			if (channel->index == channel->count) {
+				if (channel->sent == messages) {
+					continue;
+				}
+				StartMessage(channel, &generator, maxMessageSize, lostTailRate);
+			}
+			busy = true;
+
+			size_t index = channel->index++;
+			bool lost = (index + 1 == channel->count) ? channel->loseTail : Traffic_Uniform(&generator) < dropRate;
+			fragments++;
+			if (lost) {
+				channel->records[channel->sent - 1].intact = false;
+				lostFragments++;
+				continue;
+			}
+			uint8_t wire[AMCOM_MAX_PACKET_SIZE];
+			size_t size = AMCOM_SerializeFragment(channel->type, (uint8_t)(channel->sent - 1), channel->message,
+			                                      channel->size, index, wire);
+			for (size_t offset = 0; offset < size; ) {
+				size_t chunk = Traffic_NextChunkSize(&generator);
+				if (chunk > size - offset) {
+					chunk = size - offset;
+				}
+				AMCOM_Deserialize(&receiver, wire + offset, chunk);
+				offset += chunk;
+			}
+		}
+	}
+
+	// every message has been sent in full, so an intact message not matched by now was lost
+	uint64_t intact = 0;
+	for (size_t c = 0; c < channelCount; ++c) {
+		for (size_t i = 0; i < channels[c].checked; ++i) {
+			intact += channels[c].records[i].intact;
+		}
+		for (size_t i = channels[c].checked; i < channels[c].sent; ++i) {
+			intact += channels[c].records[i].intact;
+			checker.lost += channels[c].records[i].intact;
+		}
+	}
+
+	int failures = 0;
+	printf("%zu channels, %llu fragments (%llu lost), %llu intact messages, delivered %llu, lost %llu, "
+	       "false %llu, dropped by the reassembler %lu\n", channelCount, (unsigned long long)fragments,
+	       (unsigned long long)lostFragments, (unsigned long long)intact, (unsigned long long)checker.delivered,
+	       (unsigned long long)checker.lost, (unsigned long long)checker.falseMessages,
+	       (unsigned long)reassembler.droppedMessages);
+	if (checker.lost) {
+		printf("FAIL: intact messages were not delivered\n");
+		failures++;
+	}
+	if (checker.falseMessages) {
+		printf("FAIL: messages were delivered that lost a fragment or were never sent\n");
+		failures++;
+	}
+
+	for (size_t c = 0; c < channelCount; ++c) {
+		free(channels[c].records);
+	}
+	free(pool);
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
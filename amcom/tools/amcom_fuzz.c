@@ -0,0 +1,201 @@
+/**
+ * libFuzzer entry point of the AMCOM receiver, driven by the traffic generator of amcom_stress.
+ *
+ * The first FUZZ_CONFIG_SIZE bytes of an input configure the generator (seed, payload sizes, SOP rate, bit flip
+ * and drop rates, chunk sizes, number of packets); the rest is raw data. Both the generated stream and the raw
+ * data are fed in chunks to AMCOM_Deserialize and to the pull-mode AMCOM_Parse, and the tool aborts when:
+ * - a delivered packet has an invalid LENGTH or CRC,
+ * - the receiver statistics disagree with the delivered packets or the bytes fed,
+ * - AMCOM_Parse delivers different packets than AMCOM_Deserialize,
+ * - an undamaged generated stream is not delivered exactly.
+ *
+ * Build (libFuzzer):
+ *     clang -g -O1 -fsanitize=fuzzer,address,undefined -I.. amcom_fuzz.c amcom_traffic.c ../amcom.c -lm -o amcom_fuzz
+ *
+ * Build (without libFuzzer, runs the given inputs or random inputs from a seed):
+ *     gcc -O2 -DAMCOM_FUZZ_MAIN -I.. amcom_fuzz.c amcom_traffic.c ../amcom.c -lm -o amcom_fuzz
+ *     amcom_fuzz [input...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "amcom.h"
+#include "amcom_traffic.h"
+
+/// Number of configuration bytes at the start of an input
+#define FUZZ_CONFIG_SIZE			16
+/// Maximum number of generated packets per input
+#define FUZZ_MAX_PACKETS			64
+/// Maximum number of packets delivered per input (raw data may hold more packets than bytes / 5)
+#define FUZZ_MAX_DELIVERED			4096
+
+#define FUZZ_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			abort(); \
+		} \
+	} while (0)
+
+/// Packets delivered by one receiver
+typedef struct {
+	uint64_t hashes[FUZZ_MAX_DELIVERED];
+	size_t count;
+	TrafficChecker* checker;
+} Delivery;
+
+static void CheckPacket(const AMCOM_Packet* packet) {
+	FUZZ_CHECK(packet->header.sop == 0xA1);
+	FUZZ_CHECK(packet->header.length <= AMCOM_MAX_PAYLOAD_SIZE);
+	FUZZ_CHECK(packet->header.crc == AMCOM_CalculateCRC(packet->header.type, packet->payload, packet->header.length));
+}
+
+static void Record(Delivery* delivery, const AMCOM_Packet* packet) {
+	CheckPacket(packet);
+	if (delivery->count < FUZZ_MAX_DELIVERED) {
+		delivery->hashes[delivery->count] = Traffic_Hash(packet->header.type, packet->payload, packet->header.length);
+	}
+	delivery->count++;
+	if (delivery->checker) {
+		Traffic_Check(delivery->checker, packet);
+	}
+}
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	Record((Delivery*)userContext, packet);
+}
+
+/** Feeds data in chunks to a push and a pull receiver and compares what they deliver. */
+static void FeedBoth(const TrafficConfig* config, const uint8_t* data, size_t size, TrafficChecker* checker) {
+	static Delivery pushed, pulled;
+	AMCOM_Receiver push, pull;
+	TrafficGenerator chunker;
+
+	memset(&pushed, 0, sizeof(pushed));
+	memset(&pulled, 0, sizeof(pulled));
+	pushed.checker = checker;
+	AMCOM_InitReceiver(&push, OnPacket, &pushed);
+	AMCOM_InitReceiver(&pull, NULL, NULL);
+	Traffic_Init(&chunker, config);
+
+	size_t offset = 0;
+	while (offset < size) {
+		size_t chunk = Traffic_NextChunkSize(&chunker);
+		if (chunk > size - offset) {
+			chunk = size - offset;
+		}
+		AMCOM_Deserialize(&push, data + offset, chunk);
+
+		size_t parsed = 0, consumed;
+		const AMCOM_Packet* packet;
+		while ((packet = AMCOM_Parse(&pull, data + offset + parsed, chunk - parsed, &consumed)) != NULL) {
+			parsed += consumed;
+			Record(&pulled, packet);
+		}
+		parsed += consumed;
+		FUZZ_CHECK(parsed == chunk);
+		offset += chunk;
+	}
+
+	FUZZ_CHECK(push.stats.bytesReceived == size);
+	FUZZ_CHECK(push.stats.packetsOk == pushed.count);
+	FUZZ_CHECK(pull.stats.packetsOk == pulled.count);
+	FUZZ_CHECK(pushed.count == pulled.count);
+	size_t compared = (pushed.count < FUZZ_MAX_DELIVERED) ? pushed.count : FUZZ_MAX_DELIVERED;
+	FUZZ_CHECK(memcmp(pushed.hashes, pulled.hashes, compared * sizeof(uint64_t)) == 0);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < FUZZ_CONFIG_SIZE) {
+		return 0;
+	}
+
+	TrafficConfig config = {0};
+	for (int i = 0; i < 8; ++i) {
+		config.seed |= (uint64_t)data[i] << (8 * i);
+	}
+	config.sizeDistribution = (TrafficSizeDistribution)(data[8] & 3);
+	config.minSize = data[9] % (AMCOM_MAX_PAYLOAD_SIZE + 1);
+	config.maxSize = data[10] % (AMCOM_MAX_PAYLOAD_SIZE + 1);
+	if (config.minSize > config.maxSize) {
+		unsigned swap = config.minSize;
+		config.minSize = config.maxSize;
+		config.maxSize = swap;
+	}
+	config.largeShare = (data[8] >> 2) / 63.0;
+	config.meanSize = config.minSize + (config.maxSize - config.minSize) / 4.0;
+	config.sopRate = data[11] / 255.0;
+	// damage at most one byte in 100, so some packets survive
+	config.bitFlipRate = (data[12] & 0x80) ? 0 : (data[12] & 0x7F) / 127.0 * 0.00125;
+	config.dropRate = (data[13] & 0x80) ? 0 : (data[13] & 0x7F) / 127.0 * 0.01;
+	config.minChunk = 1 + (data[14] & 0x0F);
+	config.maxChunk = config.minChunk + (data[14] >> 4) * 16;
+	size_t packets = 1 + data[15] % FUZZ_MAX_PACKETS;
+
+	static uint8_t stream[FUZZ_MAX_PACKETS * AMCOM_MAX_PACKET_SIZE];
+	static TrafficRecord records[FUZZ_MAX_PACKETS];
+	TrafficGenerator generator;
+	FUZZ_CHECK(Traffic_Init(&generator, &config));
+	size_t streamSize = 0;
+	for (size_t i = 0; i < packets; ++i) {
+		streamSize += Traffic_NextPacket(&generator, stream + streamSize, &records[i]);
+	}
+
+	TrafficChecker checker;
+	Traffic_InitChecker(&checker, records, packets);
+	FeedBoth(&config, stream, streamSize, &checker);
+	Traffic_FinishChecker(&checker);
+	if (config.bitFlipRate == 0 && config.dropRate == 0) {
+		FUZZ_CHECK(checker.matched == packets && checker.lost == 0 && checker.falsePackets == 0);
+	}
+
+	FeedBoth(&config, data + FUZZ_CONFIG_SIZE, size - FUZZ_CONFIG_SIZE, NULL);
+	return 0;
+}
+
+#ifdef AMCOM_FUZZ_MAIN
+/// Number of random inputs run when no input is given
+#define FUZZ_STANDALONE_RUNS		10000
+
+static int RunFile(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	static uint8_t input[1024 * 1024];
+	size_t size = fread(input, 1, sizeof(input), file);
+	fclose(file);
+	LLVMFuzzerTestOneInput(input, size);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+	if (argc > 1) {
+		for (int i = 1; i < argc; ++i) {
+			if (RunFile(argv[i]) != EXIT_SUCCESS) {
+				return EXIT_FAILURE;
+			}
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// no inputs: random inputs of random size
+	TrafficConfig seedConfig = { .seed = 1, .minChunk = 1, .maxChunk = 1 };
+	TrafficGenerator random;
+	Traffic_Init(&random, &seedConfig);
+	static uint8_t input[FUZZ_CONFIG_SIZE + 4096];
+	for (unsigned long n = 0; n < FUZZ_STANDALONE_RUNS; ++n) {
+		size_t size = FUZZ_CONFIG_SIZE + Traffic_Random(&random) % (sizeof(input) - FUZZ_CONFIG_SIZE);
+		for (size_t i = 0; i < size; ++i) {
+			// raw data rich in SOPs
+			input[i] = (i >= FUZZ_CONFIG_SIZE && (Traffic_Random(&random) & 3) == 0) ? 0xA1 : (uint8_t)Traffic_Random(&random);
+		}
+		LLVMFuzzerTestOneInput(input, size);
+	}
+	printf("%d inputs passed\n", FUZZ_STANDALONE_RUNS);
+	return EXIT_SUCCESS;
+}
+#endif
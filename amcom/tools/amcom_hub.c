@@ -0,0 +1,725 @@
+/**
+ * Host daemon serving many AMCOM links (serial ports or ptys) to local clients.
+ *
+ * One I/O thread waits for all links in a single epoll loop. Every wakeup is handled as a batch: each ready
+ * link is drained with one read of up to LINK_BUFFER_SIZE bytes into its own buffer, and the whole batch is
+ * handed over to the worker pool under a single lock. The links are registered with EPOLLONESHOT, so a link
+ * stays disarmed until a worker has decoded its buffer with the link's AMCOM_Receiver and re-armed it. This
+ * keeps the bytes of a link in order and lets the workers use the receivers without locking; a link whose
+ * board floods the hub is throttled by its own tty buffer instead of taking over the pool.
+ *
+ * Decoded packets are published on a local SOCK_SEQPACKET Unix socket, one message per packet:
+ *
+ * +-----------------+--------+--------+------------------------------------------------+
+ * | LINK            | TYPE   | LENGTH | PAYLOAD                                        |
+ * | 2B              | 1B     | 1B     | 0..200B                                        |
+ * +-----------------+--------+--------+------------------------------------------------+
+ *
+ * LINK - index of the link (little-endian) in the order of the command line.
+ *
+ * Every worker collects the packets of its batch and sends them to each client with one sendmmsg call.
+ * A client that does not keep up loses packets (counted as dropped) instead of stalling the links.
+ *
+ * Benchmark mode (-b) creates the given number of ptys, serves their slave ends and feeds the master ends
+ * from generator threads with numbered packets, at a given rate or as fast as the ptys take them. An internal
+ * client checks the sequence numbers of every link and the tool reports throughput and CPU time of the hub
+ * threads.
+ *
+ * Build (Linux):
+ *     gcc -O2 -pthread -I.. amcom_hub.c ../amcom.c -o amcom_hub
+ *
+ * Usage:
+ *     amcom_hub [-j workers] [-u socket] [-B baud] device...
+ *     amcom_hub -b links [-t seconds] [-p payload] [-r rate] [-j workers] [-u socket]
+ *
+ *     -j  number of decoding workers (default: number of CPUs)
+ *     -u  path of the Unix socket (default /tmp/amcom_hub.sock)
+ *     -B  baud rate of the serial ports (default 115200)
+ *     -b  benchmark with the given number of ptys
+ *     -t  benchmark duration in seconds (default 5)
+ *     -p  payload size of the benchmark packets, 6..200 (default 32)
+ *     -r  packets per second and link (default 0 - as fast as possible)
+ *
+ * The daemon runs until SIGINT or SIGTERM and prints the link statistics on exit.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "amcom.h"
+
+/// Maximum number of bytes read from a link per wakeup
+#define LINK_BUFFER_SIZE			4096
+/// Maximum number of epoll events handled as one batch
+#define MAX_EVENTS					256
+/// Maximum number of links a worker takes from the queue at once
+#define WORKER_BATCH				16
+/// Maximum number of packets sent to a client with one sendmmsg call
+#define SEND_BATCH					64
+/// Maximum number of clients of the Unix socket
+#define MAX_CLIENTS					16
+/// Requested send buffer of a client connection (limited by net.core.wmem_max)
+#define CLIENT_SEND_BUFFER			(4 * 1024 * 1024)
+/// Size of a message on the Unix socket
+#define MESSAGE_HEADER_SIZE			4
+#define MAX_MESSAGE_SIZE			(MESSAGE_HEADER_SIZE + AMCOM_MAX_PAYLOAD_SIZE)
+/// epoll tag of the listening socket (links use their index, clients CLIENT_TAG | fd)
+#define LISTEN_TAG					UINT64_MAX
+#define CLIENT_TAG					(1ULL << 62)
+/// Packet type of the benchmark packets
+#define BENCH_PACKET_TYPE			0x10
+
+struct Worker;
+
+/// A serial link served by the hub
+typedef struct {
+	int fd;
+	uint16_t id;
+	const char* name;
+	bool closed;
+	uint8_t buffer[LINK_BUFFER_SIZE];   // bytes read by the I/O thread, decoded by a worker
+	size_t size;
+	uint64_t bytesRead;
+	AMCOM_Receiver receiver;
+	struct Worker* worker;              // worker decoding the link at the moment
+} Link;
+
+/// Decoding worker
+typedef struct Worker {
+	pthread_t thread;
+	uint8_t messages[SEND_BATCH][MAX_MESSAGE_SIZE];
+	struct iovec iov[SEND_BATCH];
+	struct mmsghdr headers[SEND_BATCH];
+	size_t pending;                     // messages collected and not sent yet
+	uint64_t packets;
+	uint64_t dropped;
+	uint64_t cpuNs;
+} Worker;
+
+/// State shared by the I/O thread and the workers
+typedef struct {
+	int epoll;
+	int listenFd;
+	const char* socketPath;
+	Link* links;
+	size_t linkCount;
+	size_t openLinks;
+	Worker* workers;
+	size_t workerCount;
+	// queue of links waiting for decoding (a link is queued at most once thanks to EPOLLONESHOT)
+	pthread_mutex_t queueLock;
+	pthread_cond_t queueReady;
+	Link** queue;
+	size_t queueHead;
+	size_t queueSize;
+	bool stopping;
+	// clients of the Unix socket, workers send under the read lock
+	pthread_rwlock_t clientsLock;
+	int clients[MAX_CLIENTS];
+	size_t clientCount;
+	uint64_t ioCpuNs;
+	uint64_t batches;
+} Hub;
+
+static Hub hub;
+static volatile sig_atomic_t stopRequested;
+
+static void OnSignal(int signal) {
+	(void)signal;
+	stopRequested = 1;
+}
+
+static uint64_t NowNs(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static speed_t BaudToSpeed(unsigned long baud) {
+	static const struct { unsigned long baud; speed_t speed; } speeds[] = {
+		{ 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 }, { 115200, B115200 },
+		{ 230400, B230400 }, { 460800, B460800 }, { 921600, B921600 }, { 1000000, B1000000 },
+		{ 2000000, B2000000 }, { 3000000, B3000000 }, { 4000000, B4000000 }
+	};
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); ++i) {
+		if (speeds[i].baud == baud) {
+			return speeds[i].speed;
+		}
+	}
+	return B0;
+}
+
+/** Opens a link in raw non-blocking mode. Ptys ignore the baud rate. */
+static int OpenLink(const char* path, speed_t speed) {
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(fd, &tio) == 0) {
+		cfmakeraw(&tio);
+		tio.c_cflag |= CLOCAL | CREAD;
+		cfsetspeed(&tio, speed);
+		if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+			perror(path);
+		}
+	}
+	return fd;
+}
+
+static void ArmLink(Link* link) {
+	struct epoll_event event = { .events = EPOLLIN | EPOLLONESHOT, .data.u64 = link->id };
+	epoll_ctl(hub.epoll, EPOLL_CTL_MOD, link->fd, &event);
+}
+
+static void CloseLink(Link* link) {
+	fprintf(stderr, "%s: link closed\n", link->name);
+	epoll_ctl(hub.epoll, EPOLL_CTL_DEL, link->fd, NULL);
+	close(link->fd);
+	link->closed = true;
+	hub.openLinks--;
+}
+
+/** Sends the collected messages to all clients. */
+static void FlushMessages(Worker* worker) {
+	if (!worker->pending) {
+		return;
+	}
+	pthread_rwlock_rdlock(&hub.clientsLock);
+	for (size_t c = 0; c < hub.clientCount; ++c) {
+		int sent = sendmmsg(hub.clients[c], worker->headers, (unsigned)worker->pending, MSG_DONTWAIT | MSG_NOSIGNAL);
+		worker->dropped += worker->pending - (sent > 0 ? (size_t)sent : 0);
+	}
+	pthread_rwlock_unlock(&hub.clientsLock);
+	worker->pending = 0;
+}
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	Link* link = (Link*)userContext;
+	Worker* worker = link->worker;
+	worker->packets++;
+
+	uint8_t* message = worker->messages[worker->pending];
+	message[0] = (uint8_t)(link->id & 0xFF);
+	message[1] = (uint8_t)(link->id >> 8);
+	message[2] = packet->header.type;
+	message[3] = packet->header.length;
+	memcpy(message + MESSAGE_HEADER_SIZE, packet->payload, packet->header.length);
+	worker->iov[worker->pending].iov_len = MESSAGE_HEADER_SIZE + packet->header.length;
+	if (++worker->pending == SEND_BATCH) {
+		FlushMessages(worker);
+	}
+}
+
+static void* WorkerThread(void* arg) {
+	Worker* worker = (Worker*)arg;
+	for (size_t i = 0; i < SEND_BATCH; ++i) {
+		worker->iov[i].iov_base = worker->messages[i];
+		worker->headers[i].msg_hdr.msg_iov = &worker->iov[i];
+		worker->headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for (;;) {
+		Link* batch[WORKER_BATCH];
+		size_t count = 0;
+
+		pthread_mutex_lock(&hub.queueLock);
+		while (!hub.queueSize && !hub.stopping) {
+			pthread_cond_wait(&hub.queueReady, &hub.queueLock);
+		}
+		if (!hub.queueSize) {
+			pthread_mutex_unlock(&hub.queueLock);
+			break;
+		}
+		// leave a share of the queue for the other workers
+		size_t share = hub.queueSize / hub.workerCount + 1;
+		while (hub.queueSize && count < WORKER_BATCH && count < share) {
+			batch[count++] = hub.queue[hub.queueHead];
+			hub.queueHead = (hub.queueHead + 1) % hub.linkCount;
+			hub.queueSize--;
+		}
+		pthread_mutex_unlock(&hub.queueLock);
+
+		for (size_t i = 0; i < count; ++i) {
+			Link* link = batch[i];
+			link->worker = worker;
+			AMCOM_Deserialize(&link->receiver, link->buffer, link->size);
+			link->size = 0;
+			ArmLink(link);
+		}
+		FlushMessages(worker);
+	}
+	worker->cpuNs = NowNs(CLOCK_THREAD_CPUTIME_ID);
+	return NULL;
+}
+
+static void AddClient(int fd) {
+	pthread_rwlock_wrlock(&hub.clientsLock);
+	if (hub.clientCount == MAX_CLIENTS) {
+		pthread_rwlock_unlock(&hub.clientsLock);
+		close(fd);
+		return;
+	}
+	// the queued messages of a Unix socket are charged to the sender
+	int sendBuffer = CLIENT_SEND_BUFFER;
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+	hub.clients[hub.clientCount++] = fd;
+	pthread_rwlock_unlock(&hub.clientsLock);
+
+	struct epoll_event event = { .events = EPOLLIN, .data.u64 = CLIENT_TAG | (uint64_t)fd };
+	epoll_ctl(hub.epoll, EPOLL_CTL_ADD, fd, &event);
+}
+
+static void RemoveClient(int fd) {
+	epoll_ctl(hub.epoll, EPOLL_CTL_DEL, fd, NULL);
+	pthread_rwlock_wrlock(&hub.clientsLock);
+	for (size_t c = 0; c < hub.clientCount; ++c) {
+		if (hub.clients[c] == fd) {
+			hub.clients[c] = hub.clients[--hub.clientCount];
+			break;
+		}
+	}
+	close(fd);
+	pthread_rwlock_unlock(&hub.clientsLock);
+}
+
+static int OpenSocket(const char* path) {
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "%s: path too long\n", path);
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, MAX_CLIENTS) != 0) {
+		perror(path);
+		return -1;
+	}
+	return fd;
+}
+
+/** Runs the I/O loop until a stop is requested, the deadline passes (0 - none) or all links are closed. */
+static void RunHub(uint64_t deadlineNs) {
+	struct epoll_event events[MAX_EVENTS];
+
+	while (!stopRequested && hub.openLinks && (!deadlineNs || NowNs(CLOCK_MONOTONIC) < deadlineNs)) {
+		int n = epoll_wait(hub.epoll, events, MAX_EVENTS, 100);
+		if (n < 0 && errno != EINTR) {
+			perror("epoll_wait");
+			break;
+		}
+
+		Link* batch[MAX_EVENTS];
+		size_t ready = 0;
+		for (int i = 0; i < n; ++i) {
+			uint64_t tag = events[i].data.u64;
+			if (tag == LISTEN_TAG) {
+				int fd;
+				while ((fd = accept4(hub.listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+					AddClient(fd);
+				}
+			} else if (tag & CLIENT_TAG) {
+				// clients only listen: anything readable here is a hang-up
+				int fd = (int)(tag & ~CLIENT_TAG);
+				char dummy[64];
+				if (recv(fd, dummy, sizeof(dummy), MSG_DONTWAIT) <= 0 || (events[i].events & (EPOLLHUP | EPOLLERR))) {
+					RemoveClient(fd);
+				}
+			} else {
+				Link* link = &hub.links[tag];
+				ssize_t size = read(link->fd, link->buffer, sizeof(link->buffer));
+				if (size > 0) {
+					link->size = (size_t)size;
+					link->bytesRead += (size_t)size;
+					batch[ready++] = link;
+				} else if (size < 0 && (errno == EAGAIN || errno == EINTR)) {
+					ArmLink(link);
+				} else {
+					CloseLink(link);
+				}
+			}
+		}
+
+		if (ready) {
+			pthread_mutex_lock(&hub.queueLock);
+			for (size_t i = 0; i < ready; ++i) {
+				hub.queue[(hub.queueHead + hub.queueSize++) % hub.linkCount] = batch[i];
+			}
+			pthread_cond_broadcast(&hub.queueReady);
+			pthread_mutex_unlock(&hub.queueLock);
+			hub.batches++;
+		}
+	}
+}
+
+/** Opens the links and the socket and starts the workers. */
+static bool StartHub(char** paths, size_t linkCount, size_t workerCount, const char* socketPath, speed_t speed) {
+	hub.linkCount = linkCount;
+	hub.workerCount = workerCount;
+	hub.socketPath = socketPath;
+	hub.links = calloc(linkCount, sizeof(Link));
+	hub.queue = calloc(linkCount, sizeof(Link*));
+	hub.workers = calloc(workerCount, sizeof(Worker));
+	hub.epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (!hub.links || !hub.queue || !hub.workers || hub.epoll < 0) {
+		perror("hub");
+		return false;
+	}
+	pthread_mutex_init(&hub.queueLock, NULL);
+	pthread_cond_init(&hub.queueReady, NULL);
+	pthread_rwlock_init(&hub.clientsLock, NULL);
+
+	hub.listenFd = OpenSocket(socketPath);
+	if (hub.listenFd < 0) {
+		return false;
+	}
+	struct epoll_event event = { .events = EPOLLIN, .data.u64 = LISTEN_TAG };
+	epoll_ctl(hub.epoll, EPOLL_CTL_ADD, hub.listenFd, &event);
+
+	for (size_t i = 0; i < linkCount; ++i) {
+		Link* link = &hub.links[i];
+		link->id = (uint16_t)i;
+		link->name = paths[i];
+		link->fd = OpenLink(paths[i], speed);
+		if (link->fd < 0) {
+			return false;
+		}
+		AMCOM_InitReceiver(&link->receiver, OnPacket, link);
+		struct epoll_event linkEvent = { .events = EPOLLIN | EPOLLONESHOT, .data.u64 = i };
+		epoll_ctl(hub.epoll, EPOLL_CTL_ADD, link->fd, &linkEvent);
+		hub.openLinks++;
+	}
+
+	for (size_t i = 0; i < workerCount; ++i) {
+		if (pthread_create(&hub.workers[i].thread, NULL, WorkerThread, &hub.workers[i]) != 0) {
+			perror("pthread_create");
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Stops the workers and closes the socket. */
+static void StopHub(void) {
+	pthread_mutex_lock(&hub.queueLock);
+	hub.stopping = true;
+	pthread_cond_broadcast(&hub.queueReady);
+	pthread_mutex_unlock(&hub.queueLock);
+	for (size_t i = 0; i < hub.workerCount; ++i) {
+		pthread_join(hub.workers[i].thread, NULL);
+	}
+	hub.ioCpuNs = NowNs(CLOCK_THREAD_CPUTIME_ID);
+
+	pthread_rwlock_wrlock(&hub.clientsLock);
+	for (size_t c = 0; c < hub.clientCount; ++c) {
+		close(hub.clients[c]);
+	}
+	hub.clientCount = 0;
+	pthread_rwlock_unlock(&hub.clientsLock);
+	close(hub.listenFd);
+	unlink(hub.socketPath);
+}
+
+/** Prints the statistics and returns the CPU time of the hub threads [ns]. */
+static uint64_t PrintStats(bool perLink) {
+	AMCOM_ReceiverStats total = {0};
+	uint64_t bytes = 0, packets = 0, dropped = 0, workerCpuNs = 0;
+	for (size_t i = 0; i < hub.linkCount; ++i) {
+		const AMCOM_ReceiverStats* stats = &hub.links[i].receiver.stats;
+		if (perLink) {
+			printf("%s: bytes %llu, packets %u, CRC errors %u, length errors %u, discarded bytes %u\n",
+			       hub.links[i].name, (unsigned long long)hub.links[i].bytesRead, (unsigned)stats->packetsOk,
+			       (unsigned)stats->crcErrors, (unsigned)stats->lengthErrors, (unsigned)stats->bytesDiscarded);
+		}
+		bytes              += hub.links[i].bytesRead;
+		total.crcErrors    += stats->crcErrors;
+		total.lengthErrors += stats->lengthErrors;
+		total.bytesDiscarded += stats->bytesDiscarded;
+	}
+	for (size_t i = 0; i < hub.workerCount; ++i) {
+		packets     += hub.workers[i].packets;
+		dropped     += hub.workers[i].dropped;
+		workerCpuNs += hub.workers[i].cpuNs;
+	}
+	printf("links: %zu, workers: %zu, bytes: %llu, packets: %llu, CRC errors: %u, length errors: %u, "
+	       "discarded bytes: %u, dropped messages: %llu, read batches: %llu\n",
+	       hub.linkCount, hub.workerCount, (unsigned long long)bytes, (unsigned long long)packets,
+	       (unsigned)total.crcErrors, (unsigned)total.lengthErrors, (unsigned)total.bytesDiscarded,
+	       (unsigned long long)dropped, (unsigned long long)hub.batches);
+	printf("CPU time: I/O thread %.3f s, workers %.3f s\n", hub.ioCpuNs / 1e9, workerCpuNs / 1e9);
+	return hub.ioCpuNs + workerCpuNs;
+}
+
+/* ---------------------------------------------------------------------------------------------------------- */
+/* Benchmark                                                                                                  */
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/// Master end of a benchmark pty with the packet being written to it
+typedef struct {
+	int fd;
+	uint16_t link;
+	uint32_t sequence;
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+	size_t size;
+	size_t offset;
+} BenchPty;
+
+/// Generator thread feeding a range of ptys
+typedef struct {
+	pthread_t thread;
+	BenchPty* ptys;
+	size_t count;
+	size_t payloadSize;
+	double rate;
+	uint64_t packets;
+} BenchGenerator;
+
+/// Internal client checking the sequence numbers
+typedef struct {
+	pthread_t thread;
+	int fd;
+	uint32_t* expected;
+	size_t linkCount;
+	uint64_t messages;
+	uint64_t gaps;
+	uint64_t invalid;
+} BenchClient;
+
+static atomic_bool benchRunning;
+
+static void BenchNextPacket(BenchPty* pty, size_t payloadSize) {
+	uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE];
+	payload[0] = (uint8_t)(pty->link & 0xFF);
+	payload[1] = (uint8_t)(pty->link >> 8);
+	for (int i = 0; i < 4; ++i) {
+		payload[2 + i] = (uint8_t)(pty->sequence >> (8 * i));
+	}
+	for (size_t i = 6; i < payloadSize; ++i) {
+		// make the payload contain SOP bytes now and then
+		payload[i] = (uint8_t)(pty->sequence * 31 + i * 7);
+	}
+	pty->size = AMCOM_Serialize(BENCH_PACKET_TYPE, payload, payloadSize, pty->packet);
+	pty->offset = 0;
+	pty->sequence++;
+}
+
+static void* GeneratorThread(void* arg) {
+	BenchGenerator* generator = (BenchGenerator*)arg;
+	uint64_t start = NowNs(CLOCK_MONOTONIC);
+	while (atomic_load(&benchRunning)) {
+		bool progress = false;
+		// number of packets every link should have started by now
+		uint64_t due = (uint64_t)((NowNs(CLOCK_MONOTONIC) - start) / 1e9 * generator->rate) + 1;
+		for (size_t i = 0; i < generator->count; ++i) {
+			BenchPty* pty = &generator->ptys[i];
+			if (generator->rate > 0 && pty->offset == 0 && pty->sequence > due) {
+				continue;
+			}
+			ssize_t written = write(pty->fd, pty->packet + pty->offset, pty->size - pty->offset);
+			if (written <= 0) {
+				continue;
+			}
+			progress = true;
+			pty->offset += (size_t)written;
+			if (pty->offset == pty->size) {
+				generator->packets++;
+				BenchNextPacket(pty, generator->payloadSize);
+			}
+		}
+		if (!progress) {
+			usleep(200);
+		}
+	}
+	return NULL;
+}
+
+static void* ClientThread(void* arg) {
+	BenchClient* client = (BenchClient*)arg;
+	static uint8_t messages[SEND_BATCH][MAX_MESSAGE_SIZE];
+	struct iovec iov[SEND_BATCH];
+	struct mmsghdr headers[SEND_BATCH];
+	memset(headers, 0, sizeof(headers));
+	for (size_t i = 0; i < SEND_BATCH; ++i) {
+		iov[i].iov_base = messages[i];
+		iov[i].iov_len = MAX_MESSAGE_SIZE;
+		headers[i].msg_hdr.msg_iov = &iov[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	for (;;) {
+		int n = recvmmsg(client->fd, headers, SEND_BATCH, MSG_WAITFORONE, NULL);
+		// the hub has closed the connection (reported as an empty message)
+		if (n <= 0 || headers[0].msg_len == 0) {
+			break;
+		}
+		for (int i = 0; i < n; ++i) {
+			const uint8_t* m = messages[i];
+			uint16_t link = (uint16_t)(m[0] | (m[1] << 8));
+			if (headers[i].msg_len < MESSAGE_HEADER_SIZE + 6 || link >= client->linkCount || m[2] != BENCH_PACKET_TYPE
+			    || m[4] != m[0] || m[5] != m[1]) {
+				client->invalid++;
+				continue;
+			}
+			uint32_t sequence = (uint32_t)m[6] | ((uint32_t)m[7] << 8) | ((uint32_t)m[8] << 16) | ((uint32_t)m[9] << 24);
+			if (sequence != client->expected[link]) {
+				client->gaps++;
+			}
+			client->expected[link] = sequence + 1;
+			client->messages++;
+		}
+	}
+	return NULL;
+}
+
+static int RunBenchmark(size_t linkCount, double seconds, size_t payloadSize, double rate, size_t workerCount,
+                        const char* socketPath) {
+	// two descriptors per pty
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	BenchPty* ptys = calloc(linkCount, sizeof(BenchPty));
+	char** paths = calloc(linkCount, sizeof(char*));
+	if (!ptys || !paths) {
+		perror("calloc");
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < linkCount; ++i) {
+		int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+		if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+			perror("posix_openpt");
+			return EXIT_FAILURE;
+		}
+		ptys[i].fd = fd;
+		ptys[i].link = (uint16_t)i;
+		paths[i] = strdup(ptsname(fd));
+		BenchNextPacket(&ptys[i], payloadSize);
+	}
+	if (!StartHub(paths, linkCount, workerCount, socketPath, B115200)) {
+		return EXIT_FAILURE;
+	}
+
+	BenchClient client = { .linkCount = linkCount, .expected = calloc(linkCount, sizeof(uint32_t)) };
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	strcpy(address.sun_path, socketPath);
+	client.fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	int receiveBuffer = 8 * 1024 * 1024;
+	setsockopt(client.fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+	if (client.fd < 0 || connect(client.fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		perror(socketPath);
+		return EXIT_FAILURE;
+	}
+	pthread_create(&client.thread, NULL, ClientThread, &client);
+
+	size_t generatorCount = linkCount < 4 ? linkCount : 4;
+	BenchGenerator generators[4];
+	atomic_store(&benchRunning, true);
+	for (size_t g = 0; g < generatorCount; ++g) {
+		size_t first = linkCount * g / generatorCount, last = linkCount * (g + 1) / generatorCount;
+		generators[g] = (BenchGenerator){ .ptys = ptys + first, .count = last - first, .payloadSize = payloadSize,
+		                                  .rate = rate };
+		pthread_create(&generators[g].thread, NULL, GeneratorThread, &generators[g]);
+	}
+
+	uint64_t start = NowNs(CLOCK_MONOTONIC);
+	RunHub(start + (uint64_t)(seconds * 1e9));
+	atomic_store(&benchRunning, false);
+	uint64_t generated = 0;
+	for (size_t g = 0; g < generatorCount; ++g) {
+		pthread_join(generators[g].thread, NULL);
+		generated += generators[g].packets;
+	}
+	// drain what is left in the ptys
+	RunHub(NowNs(CLOCK_MONOTONIC) + 200000000ull);
+	double elapsed = (NowNs(CLOCK_MONOTONIC) - start) / 1e9;
+	StopHub();
+	pthread_join(client.thread, NULL);
+
+	uint64_t cpuNs = PrintStats(false);
+	uint64_t bytes = 0, packets = 0;
+	for (size_t i = 0; i < linkCount; ++i) {
+		bytes += hub.links[i].bytesRead;
+		packets += hub.links[i].receiver.stats.packetsOk;
+	}
+	printf("generated packets: %llu, received by client: %llu, sequence gaps: %llu, invalid: %llu\n",
+	       (unsigned long long)generated, (unsigned long long)client.messages, (unsigned long long)client.gaps,
+	       (unsigned long long)client.invalid);
+	printf("%.1f s: %.0f packets/s, %.1f MB/s, %.2f us CPU per packet\n", elapsed, packets / elapsed,
+	       bytes / elapsed / 1e6, packets ? cpuNs / 1e3 / packets : 0.0);
+
+	for (size_t i = 0; i < linkCount; ++i) {
+		close(ptys[i].fd);
+		free(paths[i]);
+	}
+	free(ptys);
+	free(paths);
+	free(client.expected);
+	return (client.invalid == 0 && packets == generated) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+	long workers = sysconf(_SC_NPROCESSORS_ONLN);
+	const char* socketPath = "/tmp/amcom_hub.sock";
+	unsigned long baud = 115200;
+	unsigned long benchLinks = 0;
+	double seconds = 5.0;
+	unsigned long payloadSize = 32;
+	double rate = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:u:B:b:t:p:r:")) != -1) {
+		switch (opt) {
+		case 'j': workers = strtol(optarg, NULL, 0); break;
+		case 'u': socketPath = optarg; break;
+		case 'B': baud = strtoul(optarg, NULL, 0); break;
+		case 'b': benchLinks = strtoul(optarg, NULL, 0); break;
+		case 't': seconds = atof(optarg); break;
+		case 'p': payloadSize = strtoul(optarg, NULL, 0); break;
+		case 'r': rate = atof(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-j workers] [-u socket] [-B baud] device...\n"
+			                "       %s -b links [-t seconds] [-p payload] [-r rate] [-j workers] [-u socket]\n", argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (workers < 1 || BaudToSpeed(baud) == B0 || payloadSize < 6 || payloadSize > AMCOM_MAX_PAYLOAD_SIZE
+	    || (benchLinks == 0 && optind == argc) || benchLinks > UINT16_MAX) {
+		fprintf(stderr, "usage: %s [-j workers] [-u socket] [-B baud] device...\n"
+		                "       %s -b links [-t seconds] [-p payload] [-r rate] [-j workers] [-u socket]\n", argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (benchLinks) {
+		return RunBenchmark(benchLinks, seconds, payloadSize, rate, (size_t)workers, socketPath);
+	}
+	if (!StartHub(argv + optind, (size_t)(argc - optind), (size_t)workers, socketPath, BaudToSpeed(baud))) {
+		return EXIT_FAILURE;
+	}
+	RunHub(0);
+	StopHub();
+	PrintStats(true);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+/**
+ * Host simulation of the AMCOM reliable transport (see amcom_reliable.h) over a lossy, delayed link.
+ *
+ * Two endpoints are connected by a simulated full-duplex UART running on a simulated millisecond clock.
+ * Each end writes into a transmit buffer of limited size (-b) that accepts as many bytes as fit, so frames
+ * are often accepted only in part. The buffer is drained at the baud rate (10 bits per byte); every byte then
+ * travels for a fixed one-way delay (-d) and may be lost (-l) or have a bit flipped (-f) on the way.
+ *
+ * The sender keeps the window full of messages carrying a sequence counter until all messages (-n) are
+ * delivered. The tool reports the goodput (message bytes delivered per second) against the line rate for
+ * the given window (-w) and, for comparison, for stop-and-wait (window 1) on the same link, and fails if:
+ * - a message is delivered out of order, twice or damaged, or not all messages are delivered in time,
+ * - on a clean link: a frame is damaged (e.g. truncated by a partial write), a packet is retransmitted, or
+ *   the goodput with the full window is below 90 % of the payload share of the line rate,
+ * - the full window is slower than stop-and-wait.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_reliable_sim.c ../amcom_reliable.c ../amcom.c -o amcom_reliable_sim
+ *
+ * Usage:
+ *     amcom_reliable_sim [-n messages] [-m size] [-w window] [-d delay] [-l loss] [-f bitFlipRate] [-b buffer]
+ *                        [-r baud] [-s seed]
+ *
+ *     -n  number of messages (default 2000)
+ *     -m  message size in bytes, 4..AMCOM_RELIABLE_MAX_DATA_SIZE (default 198)
+ *     -w  window (default AMCOM_RELIABLE_MAX_WINDOW)
+ *     -d  one-way delay [ms] (default 10)
+ *     -l  probability of losing a byte (default 0)
+ *     -f  probability of flipping a bit (default 0)
+ *     -b  size of the transmit buffer of each end in bytes (default 512)
+ *     -r  baud rate (default 115200)
+ *     -s  seed of the random generator (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_reliable.h"
+
+/// Message type of the simulation
+#define MESSAGE_TYPE			0x01
+/// Capacity of the delay line of one direction [bytes]
+#define DELAY_LINE_SIZE			(1u << 20)
+/// Simulated time limit [ms]
+#define TIME_LIMIT_MS			(3600u * 1000u)
+/// Smallest goodput on a clean link, relative to the payload share of the line rate
+#define MIN_CLEAN_EFFICIENCY	0.9
+
+/** Simulation parameters */
+typedef struct {
+	unsigned messages;
+	unsigned messageSize;
+	unsigned delay;
+	double lossRate;
+	double bitFlipRate;
+	size_t bufferSize;
+	unsigned baudRate;
+} SimConfig;
+
+/** Byte on its way through the delay line */
+typedef struct {
+	uint64_t arrival;
+	uint8_t byte;
+} WireByte;
+
+/** One end of the simulated link */
+typedef struct {
+	uint8_t* txBuffer;
+	size_t txSize, txHead, txLength;
+	double txCredit;              ///< bytes the transmitter may send in the current millisecond
+	WireByte* wire;               ///< bytes sent by this end, in order of arrival
+	size_t wireHead, wireLength;
+	AMCOM_Receiver receiver;
+	AMCOM_ReliableLink link;
+	uint32_t delivered;           ///< messages delivered in order
+	bool broken;                  ///< a message was delivered out of order, twice or damaged
+} Endpoint;
+
+static uint64_t simTime;
+
+static uint64_t GetTicks(void) {
+	return simTime;
+}
+
+/** Transmit buffer: accepts as many bytes as fit, like USART_WriteData */
+static size_t BufferWrite(const void* data, size_t dataSize, void* context) {
+	Endpoint* end = (Endpoint*)context;
+	const uint8_t* bytes = (const uint8_t*)data;
+	size_t n = end->txSize - end->txLength;
+	if (n > dataSize) {
+		n = dataSize;
+	}
+	for (size_t i = 0; i < n; ++i) {
+		end->txBuffer[(end->txHead + end->txLength++) % end->txSize] = bytes[i];
+	}
+	return n;
+}
+
+static void FillMessage(uint8_t* data, size_t size, uint32_t counter) {
+	memcpy(data, &counter, sizeof(counter));
+	for (size_t i = sizeof(counter); i < size; ++i) {
+		data[i] = (uint8_t)(counter * 31u + i);
+	}
+}
+
+static size_t expectedSize;
+
+static void OnMessage(uint8_t packetType, const uint8_t* message, size_t messageSize, void* userContext) {
+	Endpoint* end = (Endpoint*)userContext;
+	uint8_t expected[AMCOM_RELIABLE_MAX_DATA_SIZE];
+	FillMessage(expected, expectedSize, end->delivered);
+	if (packetType != MESSAGE_TYPE || messageSize != expectedSize || memcmp(message, expected, messageSize) != 0) {
+		end->broken = true;
+	}
+	end->delivered++;
+}
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	AMCOM_ReliableHandlePacket(packet, &((Endpoint*)userContext)->link);
+}
+
+/** Moves the bytes "from" sends within one millisecond into the delay line and delivers the arrived ones. */
+static void Transfer(const SimConfig* config, Endpoint* from, Endpoint* to) {
+	from->txCredit += config->baudRate / 10000.0;
+	while (from->txLength > 0 && from->txCredit >= 1.0) {
+		uint8_t b = from->txBuffer[from->txHead];
+		from->txHead = (from->txHead + 1) % from->txSize;
+		from->txLength--;
+		from->txCredit -= 1.0;
+		if (config->lossRate > 0 && rand() < config->lossRate * RAND_MAX) {
+			continue;
+		}
+		for (int bit = 0; config->bitFlipRate > 0 && bit < 8; ++bit) {
+			if (rand() < config->bitFlipRate * RAND_MAX) {
+				b ^= (uint8_t)(1u << bit);
+			}
+		}
+		WireByte* slot = &from->wire[(from->wireHead + from->wireLength++) % DELAY_LINE_SIZE];
+		slot->arrival = simTime + config->delay;
+		slot->byte = b;
+	}
+	if (from->txLength == 0 && from->txCredit > 1.0) {
+		from->txCredit = 1.0;
+	}
+
+	uint8_t arrived[256];
+	size_t count = 0;
+	while (from->wireLength > 0 && from->wire[from->wireHead].arrival <= simTime) {
+		arrived[count++] = from->wire[from->wireHead].byte;
+		from->wireHead = (from->wireHead + 1) % DELAY_LINE_SIZE;
+		from->wireLength--;
+		if (count == sizeof(arrived)) {
+			AMCOM_Deserialize(&to->receiver, arrived, count);
+			count = 0;
+		}
+	}
+	if (count) {
+		AMCOM_Deserialize(&to->receiver, arrived, count);
+	}
+}
+
+static bool InitEndpoint(Endpoint* end, const SimConfig* config, uint8_t window) {
+	memset(end, 0, sizeof(*end));
+	end->txSize = config->bufferSize;
+	end->txBuffer = malloc(end->txSize);
+	end->wire = malloc(DELAY_LINE_SIZE * sizeof(WireByte));
+	if (!end->txBuffer || !end->wire) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	AMCOM_InitReceiver(&end->receiver, OnPacket, end);
+	return AMCOM_InitReliableLink(&end->link, window, BufferWrite, end, GetTicks, OnMessage, end);
+}
+
+static void FreeEndpoint(Endpoint* end) {
+	free(end->txBuffer);
+	free(end->wire);
+}
+
+/** Result of one run */
+typedef struct {
+	bool ok;
+	double seconds;
+	double goodput;               ///< message bytes per second
+	AMCOM_ReliableStats stats;    ///< statistics of the sender
+	AMCOM_ReceiverStats receiverStats; ///< statistics of the receiver of the data packets
+} RunResult;
+
+static RunResult Run(const SimConfig* config, uint8_t window) {
+	static Endpoint sender, receiver;
+	RunResult result = { 0 };
+	expectedSize = config->messageSize;
+	simTime = 0;
+	if (!InitEndpoint(&sender, config, window) || !InitEndpoint(&receiver, config, window)) {
+		fprintf(stderr, "invalid window %u\n", window);
+		exit(2);
+	}
+
+	uint32_t sent = 0;
+	uint8_t message[AMCOM_RELIABLE_MAX_DATA_SIZE];
+	while (receiver.delivered < config->messages && !receiver.broken && simTime < TIME_LIMIT_MS) {
+		while (sent < config->messages && AMCOM_ReliableCanSend(&sender.link)) {
+			FillMessage(message, config->messageSize, sent);
+			if (!AMCOM_ReliableSend(&sender.link, MESSAGE_TYPE, message, config->messageSize)) {
+				break;
+			}
+			sent++;
+		}
+		AMCOM_ReliableProc(&sender.link);
+		AMCOM_ReliableProc(&receiver.link);
+		Transfer(config, &sender, &receiver);
+		Transfer(config, &receiver, &sender);
+		simTime++;
+	}
+
+	result.ok = !receiver.broken && receiver.delivered == config->messages;
+	result.seconds = simTime / 1000.0;
+	result.goodput = (double)receiver.delivered * config->messageSize / result.seconds;
+	result.stats = sender.link.stats;
+	result.receiverStats = receiver.receiver.stats;
+	FreeEndpoint(&sender);
+	FreeEndpoint(&receiver);
+	return result;
+}
+
+static void Report(const char* name, const SimConfig* config, const RunResult* result) {
+	double lineRate = config->baudRate / 10.0;
+	printf("%-14s %s: %.2f s, goodput %.0f B/s (%.1f %% of the line rate), retransmissions %u, "
+	       "crc errors %u, length errors %u\n", name, result->ok ? "ok" : "FAILED", result->seconds,
+	       result->goodput, 100.0 * result->goodput / lineRate, (unsigned)result->stats.retransmissions,
+	       (unsigned)result->receiverStats.crcErrors, (unsigned)result->receiverStats.lengthErrors);
+}
+
+static void Usage(const char* name) {
+	fprintf(stderr, "usage: %s [-n messages] [-m size] [-w window] [-d delay] [-l loss] [-f bitFlipRate] "
+	                "[-b buffer] [-r baud] [-s seed]\n", name);
+}
+
+int main(int argc, char** argv) {
+	SimConfig config = {
+		.messages = 2000, .messageSize = AMCOM_RELIABLE_MAX_DATA_SIZE, .delay = 10, .bufferSize = 512,
+		.baudRate = 115200
+	};
+	unsigned window = AMCOM_RELIABLE_MAX_WINDOW;
+	unsigned seed = 1;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:m:w:d:l:f:b:r:s:")) != -1) {
+		switch (opt) {
+		case 'n': config.messages = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'm': config.messageSize = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'w': window = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'd': config.delay = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'l': config.lossRate = atof(optarg); break;
+		case 'f': config.bitFlipRate = atof(optarg); break;
+		case 'b': config.bufferSize = strtoul(optarg, NULL, 0); break;
+		case 'r': config.baudRate = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+		default:
+			Usage(argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc || config.messages == 0 || config.messageSize < sizeof(uint32_t)
+	    || config.messageSize > AMCOM_RELIABLE_MAX_DATA_SIZE || window == 0 || window > AMCOM_RELIABLE_MAX_WINDOW
+	    || config.bufferSize == 0 || config.baudRate < 10000) {
+		Usage(argv[0]);
+		return 2;
+	}
+
+	printf("%u messages of %u bytes, delay %u ms, loss %g, bit flips %g, buffer %zu B, %u baud\n",
+	       config.messages, config.messageSize, config.delay, config.lossRate, config.bitFlipRate,
+	       config.bufferSize, config.baudRate);
+	int failures = 0;
+
+	srand(seed);
+	RunResult windowed = Run(&config, (uint8_t)window);
+	char name[32];
+	snprintf(name, sizeof(name), "window %u", window);
+	Report(name, &config, &windowed);
+	srand(seed);
+	RunResult stopAndWait = Run(&config, 1);
+	Report("stop-and-wait", &config, &stopAndWait);
+	printf("speedup %.2fx\n", windowed.goodput / stopAndWait.goodput);
+
+	if (!windowed.ok || !stopAndWait.ok) {
+		printf("FAIL: messages were lost, duplicated, reordered or damaged\n");
+		failures++;
+	}
+	if (config.lossRate == 0 && config.bitFlipRate == 0) {
+		double payloadShare = (double)config.messageSize / (config.messageSize + 2 + sizeof(AMCOM_PacketHeader));
+		double lineRate = config.baudRate / 10.0;
+		if (windowed.receiverStats.crcErrors || windowed.receiverStats.lengthErrors || windowed.stats.retransmissions) {
+			printf("FAIL: damaged frames or retransmissions on a clean link\n");
+			failures++;
+		}
+		if (window == AMCOM_RELIABLE_MAX_WINDOW && windowed.goodput < MIN_CLEAN_EFFICIENCY * payloadShare * lineRate) {
+			printf("FAIL: goodput on a clean link below %.0f %% of %.0f B/s\n", 100 * MIN_CLEAN_EFFICIENCY,
+			       payloadShare * lineRate);
+			failures++;
+		}
+	}
+	if (window > 1 && windowed.goodput < stopAndWait.goodput) {
+		printf("FAIL: the window is slower than stop-and-wait\n");
+		failures++;
+	}
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * Host tool replaying AMCOM captures (see amcom_capture.h) through AMCOM_Deserialize.
+ *
+ * Every record is fed to the receiver as the very same chunk it was recorded as, so the receiver goes
+ * through the same states as it did on the device. By default the records are replayed as fast as possible
+ * and the decode throughput is reported, which makes captures usable as a decode benchmark corpus. With -p
+ * the original gaps between the records are reproduced.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_replay.c ../amcom.c ../amcom_capture.c -o amcom_replay
+ *
+ * Usage:
+ *     amcom_replay [-p] [-t] [-n repeats] [-v] capture.amcp
+ *
+ *     -p  replay at the original pace
+ *     -t  replay the transmitted records instead of the received ones
+ *     -n  replay the capture several times (benchmarking)
+ *     -v  list the received packets
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "amcom.h"
+#include "amcom_capture.h"
+
+typedef struct {
+	bool verbose;
+	uint64_t typeCounts[256];
+} ReplayContext;
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	ReplayContext* context = (ReplayContext*)userContext;
+	context->typeCounts[packet->header.type]++;
+
+	if (context->verbose) {
+		printf("%02X %3u:", packet->header.type, packet->header.length);
+		for (size_t i = 0; i < packet->header.length; ++i) {
+			printf(" %02X", packet->payload[i]);
+		}
+		putchar('\n');
+	}
+}
+
+static uint64_t NowUs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void SleepUntilUs(uint64_t deadline) {
+	uint64_t now = NowUs();
+	if (deadline > now) {
+		struct timespec ts = { (time_t)((deadline - now) / 1000000u), (long)((deadline - now) % 1000000u) * 1000 };
+		nanosleep(&ts, NULL);
+	}
+}
+
+int main(int argc, char** argv) {
+	bool paced = false;
+	AMCOM_CaptureDirection direction = AMCOM_CAPTURE_RX;
+	long repeats = 1;
+	ReplayContext context = {0};
+	int opt;
+
+	while ((opt = getopt(argc, argv, "ptn:v")) != -1) {
+		switch (opt) {
+		case 'p':
+			paced = true;
+			break;
+		case 't':
+			direction = AMCOM_CAPTURE_TX;
+			break;
+		case 'n':
+			repeats = strtol(optarg, NULL, 0);
+			break;
+		case 'v':
+			context.verbose = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-p] [-t] [-n repeats] [-v] capture.amcp\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || repeats < 1) {
+		fprintf(stderr, "usage: %s [-p] [-t] [-n repeats] [-v] capture.amcp\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int fd = open(argv[optind], O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		perror(argv[optind]);
+		return EXIT_FAILURE;
+	}
+	size_t size = (size_t)st.st_size;
+	const uint8_t* capture = NULL;
+	if (size > 0) {
+		capture = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (capture == MAP_FAILED) {
+			perror("mmap");
+			return EXIT_FAILURE;
+		}
+	}
+	close(fd);
+
+	AMCOM_CaptureReader reader;
+	if (!AMCOM_InitCaptureReader(&reader, capture, size)) {
+		fprintf(stderr, "%s: not an AMCOM capture\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+
+	AMCOM_Receiver receiver;
+	AMCOM_InitReceiver(&receiver, OnPacket, &context);
+
+	uint64_t records = 0, bytes = 0;
+	uint64_t start = NowUs();
+	for (long r = 0; r < repeats; ++r) {
+		AMCOM_CaptureRecord record;
+		uint64_t captureTime = 0;
+		uint32_t lastTimestamp = 0;
+		bool first = true;
+		uint64_t replayStart = NowUs();
+
+		AMCOM_InitCaptureReader(&reader, capture, size);
+		while (AMCOM_ReadCaptureRecord(&reader, &record)) {
+			if (paced) {
+				// unsigned difference handles the wrap-around of the 32-bit timestamps
+				captureTime += first ? 0 : (uint32_t)(record.timestampUs - lastTimestamp);
+				lastTimestamp = record.timestampUs;
+				first = false;
+				SleepUntilUs(replayStart + captureTime);
+			}
+			if (record.direction == direction) {
+				AMCOM_Deserialize(&receiver, record.data, record.dataSize);
+				bytes += record.dataSize;
+			}
+			records++;
+		}
+		if (reader.offset != size) {
+			fprintf(stderr, "%s: truncated record at offset %zu\n", argv[optind], reader.offset);
+		}
+	}
+	uint64_t elapsed = NowUs() - start;
+
+	AMCOM_ReceiverStats stats;
+	AMCOM_GetStats(&receiver, &stats);
+	printf("records: %llu, bytes: %llu, time: %.3f s", (unsigned long long)records, (unsigned long long)bytes,
+	       (double)elapsed / 1e6);
+	if (!paced && elapsed > 0) {
+		printf(", throughput: %.1f MB/s", (double)bytes / (double)elapsed);
+	}
+	printf("\npackets: %u, payload bytes: %u, discarded bytes: %u, CRC errors: %u, length errors: %u\n",
+	       stats.packetsOk, stats.payloadBytes, stats.bytesDiscarded, stats.crcErrors, stats.lengthErrors);
+	for (int t = 0; t < 256; ++t) {
+		if (context.typeCounts[t]) {
+			printf("type 0x%02X: %llu\n", t, (unsigned long long)context.typeCounts[t]);
+		}
+	}
+
+	if (capture) {
+		munmap((void*)capture, size);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,211 @@
+/**
+ * Host regression check of the resynchronisation of the AMCOM receiver after a rejected frame.
+ *
+ * A stream of packets with SOP-laden payloads is generated with amcom_traffic.c. Before some packets a false
+ * frame is inserted: a SOP with a random TYPE and LENGTH followed by fewer bytes than the LENGTH claims, so
+ * the false frame swallows the start of the real packet behind it. The stream is fed in chunks of random size
+ * to AMCOM_Deserialize and to a reference receiver that drops a rejected frame and hunts for SOP from the next
+ * incoming byte (the receiver before the rescan of rejected frames). Two passes are run:
+ * - without bit flips: the receiver must deliver every packet, since each real packet starts inside a
+ *   rejected frame and is found by the rescan (unless a false frame passes the CRC check and is accepted),
+ * - with bit flips (-f) and no false frames: the receiver must not lose more packets than the reference
+ *   receiver (a corrupted LENGTH or a false SOP in a corrupted packet no longer swallows the packets behind it).
+ * The packet loss of both receivers is reported for both passes.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_rescan_check.c amcom_traffic.c ../amcom.c -lm -o amcom_rescan_check
+ *
+ * Usage:
+ *     amcom_rescan_check [-n packets] [-j falseFrameRate] [-f bitFlipRate] [-s seed]
+ *
+ *     -n  number of packets per pass (default 100000)
+ *     -j  probability of a false frame in front of a packet (default 0.2)
+ *     -f  probability of a bit flip on the wire in the second pass (default 0.0002)
+ *     -s  seed (default 1)
+ *
+ * Exit status is 0 if all checks pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_traffic.h"
+
+/// Start of packet character
+#define SOP							0xA1
+/// Largest number of bytes of a false frame that follow its LENGTH
+#define FALSE_FRAME_MAX_TAIL		8
+/// Seed offset of the chunking generator (keeps the chunking independent of the stream)
+#define CHUNK_SEED_OFFSET			0x5EED
+
+/** Receiver that drops a rejected frame and continues with the next incoming byte */
+typedef struct {
+	AMCOM_Packet packet;
+	size_t received;
+	TrafficChecker* checker;
+} ReferenceReceiver;
+
+static void ReferenceDeserialize(ReferenceReceiver* receiver, const uint8_t* data, size_t dataSize) {
+	uint8_t* raw = (uint8_t*)&receiver->packet;
+	for (size_t i = 0; i < dataSize; ++i) {
+		uint8_t b = data[i];
+		if (receiver->received == 0 && b != SOP) {
+			continue;
+		}
+		raw[receiver->received++] = b;
+		if (receiver->received == 3 && b > AMCOM_MAX_PAYLOAD_SIZE) {
+			receiver->received = 0;
+			continue;
+		}
+		if (receiver->received < sizeof(AMCOM_PacketHeader)
+		    || receiver->received < sizeof(AMCOM_PacketHeader) + receiver->packet.header.length) {
+			continue;
+		}
+		const AMCOM_Packet* packet = &receiver->packet;
+		if (packet->header.crc == AMCOM_CalculateCRC(packet->header.type, packet->payload, packet->header.length)) {
+			Traffic_Check(receiver->checker, packet);
+		}
+		receiver->received = 0;
+	}
+}
+
+static void CheckPacket(const AMCOM_Packet* packet, void* userContext) {
+	Traffic_Check((TrafficChecker*)userContext, packet);
+}
+
+/** Packet loss of one receiver in one pass */
+typedef struct {
+	uint64_t lost;
+	uint64_t falsePackets;
+} PassResult;
+
+/**
+ * Generates a stream with false frames, feeds it to both receivers and reports the packet loss.
+ * @return number of intact packets generated
+ */
+static size_t RunPass(const TrafficConfig* config, size_t packets, double falseFrameRate,
+		PassResult* rescan, PassResult* reference) {
+	TrafficGenerator generator, chunker;
+	TrafficConfig chunkConfig = *config;
+	chunkConfig.seed += CHUNK_SEED_OFFSET;
+	Traffic_Init(&generator, config);
+	Traffic_Init(&chunker, &chunkConfig);
+
+	uint8_t* stream = malloc(packets * (AMCOM_MAX_PACKET_SIZE + 3 + FALSE_FRAME_MAX_TAIL));
+	TrafficRecord* records = malloc(packets * sizeof(TrafficRecord));
+	if (!stream || !records) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	size_t size = 0, intact = 0;
+	for (size_t i = 0; i < packets; ++i) {
+		if (Traffic_Uniform(&generator) < falseFrameRate) {
+			uint8_t length = (uint8_t)(Traffic_Random(&generator) % (AMCOM_MAX_PAYLOAD_SIZE + 1));
+			size_t tail = Traffic_Random(&generator) % (FALSE_FRAME_MAX_TAIL + 1);
+			// fewer bytes than the false frame claims, so it reaches into the next packet
+			if (tail > (size_t)length + 1) {
+				tail = (size_t)length + 1;
+			}
+			stream[size++] = SOP;
+			stream[size++] = (uint8_t)Traffic_Random(&generator);
+			stream[size++] = length;
+			for (size_t k = 0; k < tail; ++k) {
+				stream[size++] = (uint8_t)Traffic_Random(&generator);
+			}
+		}
+		size += Traffic_NextPacket(&generator, stream + size, &records[i]);
+		intact += records[i].intact;
+	}
+
+	TrafficChecker rescanChecker, referenceChecker;
+	Traffic_InitChecker(&rescanChecker, records, packets);
+	Traffic_InitChecker(&referenceChecker, records, packets);
+	AMCOM_Receiver receiver;
+	AMCOM_InitReceiver(&receiver, CheckPacket, &rescanChecker);
+	ReferenceReceiver referenceReceiver = { .checker = &referenceChecker };
+
+	for (size_t offset = 0; offset < size; ) {
+		size_t chunk = Traffic_NextChunkSize(&chunker);
+		if (chunk > size - offset) {
+			chunk = size - offset;
+		}
+		AMCOM_Deserialize(&receiver, stream + offset, chunk);
+		ReferenceDeserialize(&referenceReceiver, stream + offset, chunk);
+		offset += chunk;
+	}
+	// a false frame at the end may still hold back the last packet
+	static const uint8_t flush[AMCOM_MAX_PACKET_SIZE];
+	AMCOM_Deserialize(&receiver, flush, sizeof(flush));
+	ReferenceDeserialize(&referenceReceiver, flush, sizeof(flush));
+
+	Traffic_FinishChecker(&rescanChecker);
+	Traffic_FinishChecker(&referenceChecker);
+	rescan->lost = rescanChecker.lost;
+	rescan->falsePackets = rescanChecker.falsePackets;
+	reference->lost = referenceChecker.lost;
+	reference->falsePackets = referenceChecker.falsePackets;
+	free(stream);
+	free(records);
+	return intact;
+}
+
+static void Report(const char* name, size_t intact, const PassResult* rescan, const PassResult* reference) {
+	printf("%s: %zu intact packets, lost with rescan %llu (%.3f%%), without rescan %llu (%.3f%%), "
+	       "false packets %llu / %llu\n", name, intact,
+	       (unsigned long long)rescan->lost, intact ? 100.0 * rescan->lost / intact : 0.0,
+	       (unsigned long long)reference->lost, intact ? 100.0 * reference->lost / intact : 0.0,
+	       (unsigned long long)rescan->falsePackets, (unsigned long long)reference->falsePackets);
+}
+
+int main(int argc, char** argv) {
+	TrafficConfig config = {
+		.seed = 1, .sizeDistribution = TRAFFIC_SIZE_UNIFORM, .minSize = 0, .maxSize = AMCOM_MAX_PAYLOAD_SIZE,
+		.sopRate = 0.02, .minChunk = 1, .maxChunk = 64
+	};
+	size_t packets = 100000;
+	double falseFrameRate = 0.2, bitFlipRate = 0.0002;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:j:f:s:")) != -1) {
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'j': falseFrameRate = atof(optarg); break;
+		case 'f': bitFlipRate = atof(optarg); break;
+		case 's': config.seed = strtoull(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-n packets] [-j falseFrameRate] [-f bitFlipRate] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (packets == 0 || falseFrameRate < 0 || falseFrameRate > 1 || bitFlipRate < 0 || bitFlipRate > 1) {
+		fprintf(stderr, "invalid arguments\n");
+		return 2;
+	}
+	int failures = 0;
+	PassResult rescan, reference;
+
+	// 1. false frames only: every packet must be found by the rescan
+	size_t intact = RunPass(&config, packets, falseFrameRate, &rescan, &reference);
+	Report("false frames", intact, &rescan, &reference);
+	// only a false frame that happens to pass the CRC check (1 in 65536) may swallow packets
+	if (rescan.lost > 0 && rescan.falsePackets == 0) {
+		printf("FAIL: the receiver lost packets that started inside rejected frames\n");
+		failures++;
+	}
+
+	// 2. bit flips only: the rescan must not lose more than dropping the rejected frames
+	config.bitFlipRate = bitFlipRate;
+	config.seed++;
+	intact = RunPass(&config, packets, 0, &rescan, &reference);
+	Report("bit flips", intact, &rescan, &reference);
+	if (rescan.lost > reference.lost) {
+		printf("FAIL: the receiver lost more packets than the reference receiver\n");
+		failures++;
+	}
+
+	printf(failures ? "FAILED\n" : "PASSED\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+/**
+ * Host simulation of the AMCOM link speed negotiation (see amcom_speed.h) over a simulated UART.
+ *
+ * A host and a device endpoint are connected by a simulated full-duplex UART running on a simulated
+ * millisecond clock. Every byte takes its time on the wire at the sender's baud rate and arrives intact
+ * only if the receiver runs at the same configuration; otherwise it arrives as garbage. Bytes may also be
+ * lost at random (-l). The transmit buffer of both ends is small (-b), so the negotiation packets are also
+ * written in part and resumed. Both ends send a heartbeat every 10 ms so that a negotiated link keeps running (sparser
+ * traffic lets a LENGTH corrupted by a lost byte stall the receiver for longer than the fallback timeout).
+ *
+ * The host cycles through a list of configurations. No configuration above the device limit (-m) may be
+ * switched to, and no configuration below it may be rejected. After every negotiation the tool waits for
+ * the fallback to settle and checks that both ends run at the same configuration and that heartbeats get
+ * through. The host must get a reply to at least the given share of its proposals (-r), as it repeats a
+ * proposal that got no reply.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. -I../../myProject/Core/Inc amcom_speed_sim.c ../amcom_speed.c ../amcom.c \
+ *         ../../myProject/Core/Src/event_manager.c -o amcom_speed_sim
+ *
+ * Usage:
+ *     amcom_speed_sim [-n negotiations] [-l loss] [-m maxBaud] [-b txBuffer] [-r maxNoReply] [-s seed] [-v]
+ *
+ *     -n  number of negotiations (default 100)
+ *     -l  probability of losing a byte (default 0.005)
+ *     -m  highest baud rate supported by the device (default 4000000)
+ *     -b  size of the transmit buffer of both ends in bytes (default 8, at most 4096)
+ *     -r  largest share of negotiations that may end without a reply (default 0.05)
+ *     -s  seed of the random generator (default 1)
+ *     -v  print every negotiation result
+ *
+ * Exit status is 0 if both ends always agree on the configuration and no more negotiations than allowed end
+ * without a reply.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_speed.h"
+#include "event_manager.h"
+
+/// Heartbeat packet type of the simulation
+#define HEARTBEAT_PACKET_TYPE	0x01
+/// Heartbeat interval [ms]
+#define HEARTBEAT_INTERVAL_MS	10
+/// Fallback timeout of both ends [ms]
+#define FALLBACK_TIMEOUT_MS		1000
+
+static uint64_t simTime;
+static double lossRate = 0.005;
+static uint32_t deviceMaxBaud = 4000000;
+static size_t txCapacity = 8;
+static bool verbose;
+
+static uint64_t GetTicks(void) {
+	return simTime;
+}
+
+/** One end of the simulated link */
+typedef struct {
+	const char* name;
+	uint8_t txQueue[4096];        ///< transmit buffer (txCapacity bytes of it are used)
+	size_t txHead, txTail;
+	double txCredit;              ///< bytes the transmitter may send in the current millisecond
+	AMCOM_SpeedConfig uart;       ///< configuration of the UART
+	AMCOM_Receiver receiver;
+	AMCOM_SpeedNegotiator speed;
+	uint32_t heartbeats;          ///< heartbeats received
+	uint32_t results[AMCOM_SPEED_FELL_BACK + 1];
+	bool finished;                ///< a negotiation result arrived
+} Endpoint;
+
+static Endpoint host = { .name = "host" };
+static Endpoint device = { .name = "device" };
+
+static size_t UartWrite(const void* data, size_t dataSize, void* context) {
+	Endpoint* end = (Endpoint*)context;
+	const uint8_t* bytes = (const uint8_t*)data;
+	// takes as much as fits, like USART_WriteData
+	size_t free = txCapacity - (end->txTail - end->txHead);
+	if (dataSize > free) {
+		dataSize = free;
+	}
+	for (size_t i = 0; i < dataSize; ++i) {
+		end->txQueue[end->txTail++ % sizeof(end->txQueue)] = bytes[i];
+	}
+	return dataSize;
+}
+
+/**
+ * Writes a heartbeat if it fits into the transmit buffer as a whole and does not split a negotiation packet
+ * that is being written in part (an application would send both through one writer, e.g. the scheduler).
+ */
+static void SendHeartbeat(Endpoint* end) {
+	uint8_t buffer[AMCOM_MAX_PACKET_SIZE];
+	size_t size = AMCOM_Serialize(HEARTBEAT_PACKET_TYPE, NULL, 0, buffer);
+	if (end->speed.packetOffset == end->speed.packetSize && txCapacity - (end->txTail - end->txHead) >= size) {
+		UartWrite(buffer, size, end);
+	}
+}
+
+static bool UartTxIdle(void* context) {
+	Endpoint* end = (Endpoint*)context;
+	return end->txHead == end->txTail;
+}
+
+static bool UartSetSpeed(uint32_t baudRate, uint8_t overSampling, void* context) {
+	Endpoint* end = (Endpoint*)context;
+	end->uart.baudRate = baudRate;
+	end->uart.overSampling = overSampling;
+	end->txCredit = 0;
+	return true;
+}
+
+static bool DeviceCheckSpeed(uint32_t baudRate, uint8_t overSampling, void* context) {
+	(void)overSampling;
+	(void)context;
+	return baudRate <= deviceMaxBaud;
+}
+
+static void OnPacket(const AMCOM_Packet* packet, void* userContext) {
+	Endpoint* end = (Endpoint*)userContext;
+	AMCOM_SpeedNotifyActivity(&end->speed);
+	if (packet->header.type == AMCOM_SPEED_PACKET_TYPE) {
+		AMCOM_SpeedHandlePacket(packet, &end->speed);
+	} else if (packet->header.type == HEARTBEAT_PACKET_TYPE) {
+		end->heartbeats++;
+	}
+}
+
+static const char* ResultName(AMCOM_SpeedResult result) {
+	static const char* names[] = { "switched", "rejected", "no reply", "probe failed", "fell back" };
+	return names[result];
+}
+
+static void OnResult(AMCOM_SpeedResult result, const AMCOM_SpeedConfig* config, void* userContext) {
+	Endpoint* end = (Endpoint*)userContext;
+	end->results[result]++;
+	end->finished = true;
+	if (verbose) {
+		printf("%8llu ms %-6s %-12s -> %u/%u\n", (unsigned long long)simTime, end->name, ResultName(result),
+				(unsigned)config->baudRate, config->overSampling);
+	}
+}
+
+/** Moves the bytes the transmitter of "from" sends within one millisecond to the receiver of "to". */
+static void Transfer(Endpoint* from, Endpoint* to) {
+	// 10 bits per byte (start, 8 data bits, stop)
+	from->txCredit += from->uart.baudRate / 10000.0;
+	while (from->txHead != from->txTail && from->txCredit >= 1.0) {
+		uint8_t b = from->txQueue[from->txHead++ % sizeof(from->txQueue)];
+		from->txCredit -= 1.0;
+		if (lossRate > 0 && rand() < lossRate * RAND_MAX) {
+			continue;
+		}
+		if (to->uart.baudRate != from->uart.baudRate || to->uart.overSampling != from->uart.overSampling) {
+			b = (uint8_t)rand();
+		}
+		AMCOM_Deserialize(&to->receiver, &b, 1);
+	}
+	if (from->txHead == from->txTail) {
+		from->txCredit = 0;
+	}
+}
+
+static void Step(void) {
+	simTime++;
+	Transfer(&host, &device);
+	Transfer(&device, &host);
+	if (simTime % HEARTBEAT_INTERVAL_MS == 0) {
+		SendHeartbeat(&host);
+		SendHeartbeat(&device);
+	}
+	EVENT_MANAGER_Proc(simTime);
+}
+
+static void InitEndpoint(Endpoint* end, const AMCOM_SpeedPort* port, const AMCOM_SpeedConfig* base) {
+	end->uart = *base;
+	AMCOM_InitReceiver(&end->receiver, OnPacket, end);
+	AMCOM_InitSpeedNegotiator(&end->speed, port, GetTicks, base, FALLBACK_TIMEOUT_MS, OnResult, end);
+}
+
+int main(int argc, char** argv) {
+	unsigned long negotiations = 100;
+	unsigned seed = 1;
+	double maxNoReply = 0.05;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:l:m:b:r:s:v")) != -1) {
+		switch (opt) {
+		case 'n': negotiations = strtoul(optarg, NULL, 0); break;
+		case 'l': lossRate = atof(optarg); break;
+		case 'm': deviceMaxBaud = (uint32_t)strtoul(optarg, NULL, 0); break;
+		case 'b': txCapacity = strtoul(optarg, NULL, 0); break;
+		case 'r': maxNoReply = atof(optarg); break;
+		case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+		case 'v': verbose = true; break;
+		default:
+			fprintf(stderr, "usage: %s [-n negotiations] [-l loss] [-m maxBaud] [-b txBuffer] [-r maxNoReply] [-s seed] "
+					"[-v]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (txCapacity == 0 || txCapacity > sizeof(host.txQueue)) {
+		fprintf(stderr, "the transmit buffer must be 1..%zu bytes\n", sizeof(host.txQueue));
+		return 2;
+	}
+	srand(seed);
+
+	static const AMCOM_SpeedConfig configs[] = {
+		{ 921600, 16 }, { 2000000, 8 }, { 115200, 16 }, { 5000000, 8 }, { 460800, 16 }, { 4000000, 8 }
+	};
+	const AMCOM_SpeedConfig base = { 115200, 16 };
+	const AMCOM_SpeedPort hostPort = { UartWrite, UartTxIdle, UartSetSpeed, NULL, &host };
+	const AMCOM_SpeedPort devicePort = { UartWrite, UartTxIdle, UartSetSpeed, DeviceCheckSpeed, &device };
+
+	EVENT_MANAGER_Init();
+	InitEndpoint(&host, &hostPort, &base);
+	InitEndpoint(&device, &devicePort, &base);
+
+	unsigned long disagreements = 0, deadHeartbeats = 0, wrongRejects = 0;
+	for (unsigned long n = 0; n < negotiations; ++n) {
+		const AMCOM_SpeedConfig* config = &configs[n % (sizeof(configs) / sizeof(configs[0]))];
+		uint32_t rejectedBefore = host.results[AMCOM_SPEED_REJECTED];
+		uint32_t switchedBefore = host.results[AMCOM_SPEED_SWITCHED];
+		host.finished = false;
+		while (!AMCOM_ProposeSpeed(&host.speed, config)) {
+			Step();
+		}
+		while (!host.finished) {
+			Step();
+		}
+		bool rejected = host.results[AMCOM_SPEED_REJECTED] != rejectedBefore;
+		bool switched = host.results[AMCOM_SPEED_SWITCHED] != switchedBefore;
+		if ((config->baudRate > deviceMaxBaud) ? switched : rejected) {
+			wrongRejects++;
+		}
+
+		// let the fallback settle, then both ends must agree and heartbeats must get through
+		for (int t = 0; t < 3 * FALLBACK_TIMEOUT_MS; ++t) {
+			Step();
+		}
+		const AMCOM_SpeedConfig* h = AMCOM_GetLinkSpeed(&host.speed);
+		const AMCOM_SpeedConfig* d = AMCOM_GetLinkSpeed(&device.speed);
+		if (h->baudRate != d->baudRate || h->overSampling != d->overSampling) {
+			disagreements++;
+			printf("negotiation %lu: host at %u/%u, device at %u/%u\n", n, (unsigned)h->baudRate, h->overSampling,
+					(unsigned)d->baudRate, d->overSampling);
+		}
+		uint32_t heartbeats = device.heartbeats;
+		for (int t = 0; t < 50 * HEARTBEAT_INTERVAL_MS; ++t) {
+			Step();
+		}
+		if (device.heartbeats == heartbeats) {
+			deadHeartbeats++;
+		}
+	}
+
+	for (int e = 0; e < 2; ++e) {
+		const Endpoint* end = e ? &device : &host;
+		printf("%-6s:", end->name);
+		for (int r = 0; r <= AMCOM_SPEED_FELL_BACK; ++r) {
+			printf(" %s %u%s", ResultName((AMCOM_SpeedResult)r), end->results[r], r < AMCOM_SPEED_FELL_BACK ? "," : "\n");
+		}
+	}
+	unsigned long noReply = host.results[AMCOM_SPEED_NO_REPLY];
+	printf("%lu negotiations, %lu disagreements, %lu dead links, %lu wrong rejects, %lu without reply\n", negotiations,
+			disagreements, deadHeartbeats, wrongRejects, noReply);
+	if (noReply > maxNoReply * negotiations) {
+		printf("too many negotiations without a reply (more than %.1f%%)\n", 100.0 * maxNoReply);
+	}
+	bool ok = !disagreements && !deadHeartbeats && !wrongRejects && noReply <= maxNoReply * negotiations;
+	printf(ok ? "PASSED\n" : "FAILED\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+/**
+ * Host stress harness of the AMCOM receiver.
+ *
+ * The tool generates a stream of AMCOM packets with amcom_traffic.c (payload size distribution, SOP-laden
+ * payloads, bit flips, dropped bytes), then feeds it to AMCOM_Deserialize in chunks of random size twice:
+ * - a timed pass with a handler that only counts, reporting packets/s and bytes/s of the receiver alone,
+ * - a checking pass that matches every delivered packet against the ground truth of the generator,
+ *   reporting the intact packets the receiver lost and the damaged packets it accepted (false packets).
+ *
+ * The same seed always gives the same stream and the same chunking. The stream can be saved (-o) to feed
+ * other tools, e.g. amcom_decode.
+ *
+ * Build (Linux):
+ *     gcc -O2 -I.. amcom_stress.c amcom_traffic.c ../amcom.c -lm -o amcom_stress
+ *
+ * Usage:
+ *     amcom_stress [-n packets] [-p sizes] [-a sopRate] [-f bitFlipRate] [-l dropRate] [-c chunks] [-s seed]
+ *                  [-o stream.bin]
+ *
+ *     -n  number of packets (default 1000000)
+ *     -p  payload sizes: N (fixed), A-B (uniform), A,B,P (A or, with probability P, B), A-B:M (A plus an
+ *         exponential tail with mean M, cut at B) (default 0-200)
+ *     -a  probability of a payload byte being SOP (default 0)
+ *     -f  probability of a bit flip on the wire (default 0)
+ *     -l  probability of a dropped byte on the wire (default 0)
+ *     -c  chunk sizes handed to AMCOM_Deserialize: N or A-B (default 1-64)
+ *     -s  seed (default 1)
+ *     -o  file to save the generated stream to
+ *
+ * Exit status is 1 if a packet is lost or accepted falsely on an undamaged stream.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "amcom.h"
+#include "amcom_traffic.h"
+
+/// Seed offset of the chunking generator (keeps the chunking independent of the stream)
+#define CHUNK_SEED_OFFSET			0x5EED
+
+static uint64_t countedPackets;
+
+static void CountPacket(const AMCOM_Packet* packet, void* userContext) {
+	(void)packet;
+	(void)userContext;
+	countedPackets++;
+}
+
+static void CheckPacket(const AMCOM_Packet* packet, void* userContext) {
+	Traffic_Check((TrafficChecker*)userContext, packet);
+}
+
+static bool ParseSizes(const char* text, TrafficConfig* config) {
+	unsigned a, b;
+	double x;
+	char end;
+	if (sscanf(text, "%u-%u:%lf%c", &a, &b, &x, &end) == 3) {
+		config->sizeDistribution = TRAFFIC_SIZE_GEOMETRIC;
+		config->meanSize = x;
+	} else if (sscanf(text, "%u,%u,%lf%c", &a, &b, &x, &end) == 3) {
+		config->sizeDistribution = TRAFFIC_SIZE_BIMODAL;
+		config->largeShare = x;
+	} else if (sscanf(text, "%u-%u%c", &a, &b, &end) == 2) {
+		config->sizeDistribution = TRAFFIC_SIZE_UNIFORM;
+	} else if (sscanf(text, "%u%c", &a, &end) == 1) {
+		config->sizeDistribution = TRAFFIC_SIZE_FIXED;
+		b = a;
+	} else {
+		return false;
+	}
+	config->minSize = a;
+	config->maxSize = b;
+	return true;
+}
+
+static bool ParseChunks(const char* text, TrafficConfig* config) {
+	unsigned a, b;
+	char end;
+	if (sscanf(text, "%u-%u%c", &a, &b, &end) != 2) {
+		if (sscanf(text, "%u%c", &a, &end) != 1) {
+			return false;
+		}
+		b = a;
+	}
+	config->minChunk = a;
+	config->maxChunk = b;
+	return true;
+}
+
+/** Feeds the stream to the receiver in chunks. Returns the time spent in AMCOM_Deserialize [s]. */
+static double FeedReceiver(AMCOM_Receiver* receiver, const TrafficConfig* config, const uint8_t* stream, size_t size) {
+	TrafficGenerator chunker;
+	TrafficConfig chunkConfig = *config;
+	chunkConfig.seed += CHUNK_SEED_OFFSET;
+	Traffic_Init(&chunker, &chunkConfig);
+
+	struct timespec start, stop;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	size_t offset = 0;
+	while (offset < size) {
+		size_t chunk = Traffic_NextChunkSize(&chunker);
+		if (chunk > size - offset) {
+			chunk = size - offset;
+		}
+		AMCOM_Deserialize(receiver, stream + offset, chunk);
+		offset += chunk;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	return (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void Usage(const char* name) {
+	fprintf(stderr, "usage: %s [-n packets] [-p sizes] [-a sopRate] [-f bitFlipRate] [-l dropRate] [-c chunks] "
+	                "[-s seed] [-o stream.bin]\n", name);
+}
+
+int main(int argc, char** argv) {
+	TrafficConfig config = {
+		.seed = 1, .sizeDistribution = TRAFFIC_SIZE_UNIFORM, .minSize = 0, .maxSize = AMCOM_MAX_PAYLOAD_SIZE,
+		.minChunk = 1, .maxChunk = 64
+	};
+	size_t packets = 1000000;
+	const char* outputPath = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:p:a:f:l:c:s:o:")) != -1) {
+		bool ok = true;
+		switch (opt) {
+		case 'n': packets = strtoul(optarg, NULL, 0); break;
+		case 'p': ok = ParseSizes(optarg, &config); break;
+		case 'a': config.sopRate = atof(optarg); break;
+		case 'f': config.bitFlipRate = atof(optarg); break;
+		case 'l': config.dropRate = atof(optarg); break;
+		case 'c': ok = ParseChunks(optarg, &config); break;
+		case 's': config.seed = strtoull(optarg, NULL, 0); break;
+		case 'o': outputPath = optarg; break;
+		default: ok = false; break;
+		}
+		if (!ok) {
+			Usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	TrafficGenerator generator;
+	if (optind != argc || packets == 0 || !Traffic_Init(&generator, &config)) {
+		Usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// generate the whole stream first, so the timed pass measures the receiver only
+	size_t capacity = packets * 64, size = 0;
+	uint8_t* stream = malloc(capacity);
+	TrafficRecord* records = malloc(packets * sizeof(TrafficRecord));
+	if (!stream || !records) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+	size_t intact = 0;
+	for (size_t i = 0; i < packets; ++i) {
+		if (capacity - size < AMCOM_MAX_PACKET_SIZE) {
+			capacity *= 2;
+			stream = realloc(stream, capacity);
+			if (!stream) {
+				perror("realloc");
+				return EXIT_FAILURE;
+			}
+		}
+		size += Traffic_NextPacket(&generator, stream + size, &records[i]);
+		intact += records[i].intact;
+	}
+
+	if (outputPath) {
+		FILE* file = fopen(outputPath, "wb");
+		if (!file || fwrite(stream, 1, size, file) != size || fclose(file) != 0) {
+			perror(outputPath);
+			return EXIT_FAILURE;
+		}
+	}
+
+	AMCOM_Receiver receiver;
+	AMCOM_InitReceiver(&receiver, CountPacket, NULL);
+	double seconds = FeedReceiver(&receiver, &config, stream, size);
+
+	TrafficChecker checker;
+	Traffic_InitChecker(&checker, records, packets);
+	AMCOM_InitReceiver(&receiver, CheckPacket, &checker);
+	FeedReceiver(&receiver, &config, stream, size);
+	Traffic_FinishChecker(&checker);
+
+	const AMCOM_ReceiverStats* stats = &receiver.stats;
+	printf("generated: %zu packets (%zu intact), %zu bytes\n", packets, intact, size);
+	printf("receiver: %.0f packets/s, %.1f MB/s (%llu packets in %.3f s)\n", countedPackets / seconds,
+	       size / seconds / 1e6, (unsigned long long)countedPackets, seconds);
+	printf("stats: packets %u, CRC errors %u, length errors %u, discarded bytes %u\n", (unsigned)stats->packetsOk,
+	       (unsigned)stats->crcErrors, (unsigned)stats->lengthErrors, (unsigned)stats->bytesDiscarded);
+	printf("ground truth: delivered %llu, matched %llu, lost intact %llu (%.4f%%), false packets %llu, "
+	       "damaged delivered %llu\n", (unsigned long long)checker.delivered, (unsigned long long)checker.matched,
+	       (unsigned long long)checker.lost, intact ? 100.0 * checker.lost / intact : 0.0,
+	       (unsigned long long)checker.falsePackets, (unsigned long long)checker.corruptDelivered);
+
+	free(stream);
+	free(records);
+	bool damaged = config.bitFlipRate > 0 || config.dropRate > 0;
+	return (!damaged && (checker.lost || checker.falsePackets)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
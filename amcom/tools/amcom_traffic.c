@@ -0,0 +1,142 @@
+#include <math.h>
+#include <string.h>
+#include "amcom_traffic.h"
+
+/// Start of packet character
+#define SOP							0xA1
+
+bool Traffic_Init(TrafficGenerator* generator, const TrafficConfig* config) {
+	if (config->minSize > config->maxSize || config->maxSize > AMCOM_MAX_PAYLOAD_SIZE
+	    || config->minChunk == 0 || config->minChunk > config->maxChunk
+	    || config->sopRate < 0 || config->sopRate > 1 || config->bitFlipRate < 0 || config->bitFlipRate > 1
+	    || config->dropRate < 0 || config->dropRate > 1 || config->largeShare < 0 || config->largeShare > 1) {
+		return false;
+	}
+	generator->config = *config;
+	generator->state = config->seed;
+	generator->byteHitRate = 1.0 - pow(1.0 - config->bitFlipRate, 8);
+	return true;
+}
+
+uint64_t Traffic_Random(TrafficGenerator* generator) {
+	// splitmix64
+	uint64_t z = (generator->state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+double Traffic_Uniform(TrafficGenerator* generator) {
+	return (Traffic_Random(generator) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Returns a number in min..max (inclusive). */
+static unsigned Traffic_Range(TrafficGenerator* generator, unsigned min, unsigned max) {
+	return min + (unsigned)(Traffic_Random(generator) % ((uint64_t)max - min + 1));
+}
+
+uint64_t Traffic_Hash(uint8_t type, const uint8_t* payload, size_t length) {
+	// FNV-1a
+	uint64_t hash = 0xCBF29CE484222325ull;
+	hash = (hash ^ type) * 0x100000001B3ull;
+	hash = (hash ^ (uint8_t)length) * 0x100000001B3ull;
+	for (size_t i = 0; i < length; ++i) {
+		hash = (hash ^ payload[i]) * 0x100000001B3ull;
+	}
+	return hash;
+}
+
+static size_t Traffic_NextPayloadSize(TrafficGenerator* generator) {
+	const TrafficConfig* config = &generator->config;
+	switch (config->sizeDistribution) {
+	case TRAFFIC_SIZE_UNIFORM:
+		return Traffic_Range(generator, config->minSize, config->maxSize);
+	case TRAFFIC_SIZE_BIMODAL:
+		return (Traffic_Uniform(generator) < config->largeShare) ? config->maxSize : config->minSize;
+	case TRAFFIC_SIZE_GEOMETRIC: {
+		double tail = -log(1.0 - Traffic_Uniform(generator)) * (config->meanSize - config->minSize);
+		double size = config->minSize + (tail > 0 ? floor(tail) : 0);
+		return (size > config->maxSize) ? config->maxSize : (size_t)size;
+	}
+	case TRAFFIC_SIZE_FIXED:
+	default:
+		return config->maxSize;
+	}
+}
+
+size_t Traffic_NextPacket(TrafficGenerator* generator, uint8_t* wire, TrafficRecord* record) {
+	const TrafficConfig* config = &generator->config;
+	uint8_t payload[AMCOM_MAX_PAYLOAD_SIZE] = {0};
+	uint8_t packet[AMCOM_MAX_PACKET_SIZE];
+
+	uint8_t type = (uint8_t)Traffic_Random(generator);
+	size_t length = Traffic_NextPayloadSize(generator);
+	for (size_t i = 0; i < length; ++i) {
+		payload[i] = (config->sopRate > 0 && Traffic_Uniform(generator) < config->sopRate)
+		           ? SOP : (uint8_t)Traffic_Random(generator);
+	}
+	size_t size = AMCOM_Serialize(type, payload, length, packet);
+
+	record->hash = Traffic_Hash(type, payload, length);
+	record->length = (uint8_t)length;
+	record->intact = true;
+
+	size_t wireSize = 0;
+	for (size_t i = 0; i < size; ++i) {
+		uint8_t byte = packet[i];
+		if (config->dropRate > 0 && Traffic_Uniform(generator) < config->dropRate) {
+			record->intact = false;
+			continue;
+		}
+		if (generator->byteHitRate > 0 && Traffic_Uniform(generator) < generator->byteHitRate) {
+			byte ^= (uint8_t)(1u << (Traffic_Random(generator) & 7));
+			record->intact = false;
+		}
+		wire[wireSize++] = byte;
+	}
+	return wireSize;
+}
+
+size_t Traffic_NextChunkSize(TrafficGenerator* generator) {
+	return Traffic_Range(generator, generator->config.minChunk, generator->config.maxChunk);
+}
+
+void Traffic_InitChecker(TrafficChecker* checker, const TrafficRecord* records, size_t count) {
+	memset(checker, 0, sizeof(*checker));
+	checker->records = records;
+	checker->count = count;
+}
+
+void Traffic_Check(TrafficChecker* checker, const AMCOM_Packet* packet) {
+	uint64_t hash = Traffic_Hash(packet->header.type, packet->payload, packet->header.length);
+	size_t end = checker->next + TRAFFIC_CHECK_WINDOW;
+	if (end > checker->count) {
+		end = checker->count;
+	}
+
+	checker->delivered++;
+	// equal packets are common (e.g. empty ones), so the intact ones are tried first
+	for (int pass = 0; pass < 2; ++pass) {
+		for (size_t i = checker->next; i < end; ++i) {
+			const TrafficRecord* record = &checker->records[i];
+			if (record->hash != hash || record->length != packet->header.length || record->intact != !pass) {
+				continue;
+			}
+			for (size_t j = checker->next; j < i; ++j) {
+				checker->lost += checker->records[j].intact;
+			}
+			checker->matched++;
+			checker->corruptDelivered += !record->intact;
+			checker->next = i + 1;
+			return;
+		}
+	}
+	checker->falsePackets++;
+}
+
+void Traffic_FinishChecker(TrafficChecker* checker) {
+	for (size_t j = checker->next; j < checker->count; ++j) {
+		checker->lost += checker->records[j].intact;
+	}
+	checker->next = checker->count;
+}
@@ -0,0 +1,107 @@
+#ifndef AMCOM_TRAFFIC_H_
+#define AMCOM_TRAFFIC_H_
+
+/**
+ * AMCOM traffic generator shared by the host stress tools (amcom_stress.c, amcom_fuzz.c).
+ *
+ * The generator produces a reproducible stream of AMCOM packets from a seed:
+ * - payload sizes follow a configurable distribution,
+ * - every payload byte is SOP with a configurable probability (payloads full of false SOPs stress the resync),
+ * - on the wire, every bit is flipped and every byte is dropped with configurable probabilities,
+ * - the stream is handed to the receiver in chunks of random size.
+ *
+ * Every packet leaves a ground truth record. A checker matches the packets delivered by a receiver against
+ * the records, so lost and falsely accepted packets can be counted.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "amcom.h"
+
+/// Number of records the checker looks ahead for a delivered packet
+#define TRAFFIC_CHECK_WINDOW		256
+
+/** Payload size distributions */
+typedef enum {
+	TRAFFIC_SIZE_FIXED = 0,     ///< always maxSize
+	TRAFFIC_SIZE_UNIFORM,       ///< uniform in minSize..maxSize
+	TRAFFIC_SIZE_BIMODAL,       ///< maxSize with probability largeShare, minSize otherwise
+	TRAFFIC_SIZE_GEOMETRIC      ///< minSize plus an exponential tail with the given mean, cut at maxSize
+} TrafficSizeDistribution;
+
+/** Configuration of the generator */
+typedef struct {
+	uint64_t seed;
+	TrafficSizeDistribution sizeDistribution;
+	unsigned minSize;
+	unsigned maxSize;
+	double largeShare;          ///< TRAFFIC_SIZE_BIMODAL only
+	double meanSize;            ///< TRAFFIC_SIZE_GEOMETRIC only
+	double sopRate;             ///< probability of a payload byte being SOP
+	double bitFlipRate;         ///< probability of flipping a bit on the wire
+	double dropRate;            ///< probability of dropping a byte on the wire
+	unsigned minChunk;          ///< smallest chunk handed to the receiver (at least 1)
+	unsigned maxChunk;          ///< largest chunk handed to the receiver
+} TrafficConfig;
+
+/** Ground truth of a generated packet */
+typedef struct {
+	uint64_t hash;              ///< hash of TYPE, LENGTH and PAYLOAD
+	uint8_t length;
+	bool intact;                ///< no bit of the packet was flipped or dropped
+} TrafficRecord;
+
+/** Generator state */
+typedef struct {
+	TrafficConfig config;
+	uint64_t state;
+	double byteHitRate;         ///< probability of a byte having at least one bit flipped
+} TrafficGenerator;
+
+/** Result of matching the delivered packets against the ground truth */
+typedef struct {
+	const TrafficRecord* records;
+	size_t count;
+	size_t next;                ///< first record not matched or passed yet
+	uint64_t delivered;         ///< packets delivered by the receiver
+	uint64_t matched;           ///< delivered packets equal to a generated one
+	uint64_t falsePackets;      ///< delivered packets that were never generated (corruption the CRC missed)
+	uint64_t lost;              ///< intact packets that were not delivered
+	uint64_t corruptDelivered;  ///< delivered packets matching a corrupted record (e.g. the damage hit a lost byte)
+} TrafficChecker;
+
+/** Initializes the generator. Returns false if the configuration is invalid. */
+bool Traffic_Init(TrafficGenerator* generator, const TrafficConfig* config);
+
+/** Returns a uniformly distributed 64-bit number and advances the generator. */
+uint64_t Traffic_Random(TrafficGenerator* generator);
+
+/** Returns a uniformly distributed number in [0, 1). */
+double Traffic_Uniform(TrafficGenerator* generator);
+
+/** Returns the hash identifying a packet. */
+uint64_t Traffic_Hash(uint8_t type, const uint8_t* payload, size_t length);
+
+/**
+ * Generates the next packet and damages it as configured.
+ *
+ * @param wire place to store the bytes as they arrive at the receiver (at least AMCOM_MAX_PACKET_SIZE bytes)
+ * @param record place to store the ground truth of the packet
+ * @return number of bytes stored in wire
+ */
+size_t Traffic_NextPacket(TrafficGenerator* generator, uint8_t* wire, TrafficRecord* record);
+
+/** Returns the size of the next chunk handed to the receiver. */
+size_t Traffic_NextChunkSize(TrafficGenerator* generator);
+
+/** Starts matching delivered packets against the given records. */
+void Traffic_InitChecker(TrafficChecker* checker, const TrafficRecord* records, size_t count);
+
+/** Matches a delivered packet against the records. */
+void Traffic_Check(TrafficChecker* checker, const AMCOM_Packet* packet);
+
+/** Counts the intact packets after the last delivered one as lost. */
+void Traffic_FinishChecker(TrafficChecker* checker);
+
+#endif /* AMCOM_TRAFFIC_H_ */
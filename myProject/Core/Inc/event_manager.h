@@ -58,6 +58,13 @@ void EVENT_MANAGER_UnregisterEvent(Event* event);
  */
 bool EVENT_MANAGER_ScheduleEvent(Event* event, uint64_t time);
 
+/**
+ * Cancels a scheduled event. The event stays registered and can be scheduled again.
+ *
+ * @param[in] pointer to the Event description structure
+ */
+void EVENT_MANAGER_CancelEvent(Event* event);
+
 /**
  * Processes the events and executes event handlers. This function should be called within main program loop.
  *
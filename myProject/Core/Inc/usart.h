@@ -5,6 +5,14 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+/// Baud rate set by USART_Init (with oversampling by 16)
+#define USART_DEFAULT_BAUD_RATE		115200u
+
+/// Size of the USART transmit buffer
+#define USART_TX_BUFFER_SIZE		1024u
+
+/// Size of the USART receive buffer (e.g. the window of the AMCOM flow control)
+#define USART_RX_BUFFER_SIZE		1024u
 
 /**
  * Initializes the USART interface.
@@ -37,6 +45,39 @@ size_t USART_WriteData(const void *data, size_t dataSize);
 */
 size_t USART_WriteString(const char *string);
 
+/**
+ * Gets the number of bytes waiting in the USART transmit buffer.
+ *
+ * @return number of bytes that have not been sent yet
+*/
+size_t USART_GetTxLength(void);
+
+/**
+ * Checks if all bytes written to the USART have been sent (including the stop bit of the last one).
+ *
+ * @return true if the transmit buffer is empty and the transmission is complete, false otherwise
+*/
+bool USART_IsTxIdle(void);
+
+/**
+ * Checks if a baud rate can be generated within 1% from the USART clock.
+ *
+ * @param[in] baudRate baud rate
+ * @param[in] overSampling oversampling (8 or 16)
+ * @return true if the configuration is supported, false otherwise
+*/
+bool USART_IsBaudRateSupported(uint32_t baudRate, uint32_t overSampling);
+
+/**
+ * Switches the USART to another baud rate. Bytes still being sent or received at that time are lost,
+ * so wait for USART_IsTxIdle first.
+ *
+ * @param[in] baudRate baud rate
+ * @param[in] overSampling oversampling (8 or 16)
+ * @return true if the USART was reconfigured, false if the configuration is not supported
+*/
+bool USART_SetBaudRate(uint32_t baudRate, uint32_t overSampling);
+
 /**
  * Pulls out a single character from the USART receive buffer.
  *
@@ -54,5 +95,13 @@ bool USART_GetChar(char *c);
 */
 size_t USART_ReadData(void *data, size_t maxSize);
 
+/**
+ * Gets the number of received bytes lost because the receive buffer was full or the
+ * USART overran (a byte arrived before the previous one was read).
+ *
+ * @return number of lost bytes since USART_Init
+*/
+uint32_t USART_GetRxOverruns(void);
+
 
 #endif // _USART_H_
@@ -82,6 +82,12 @@ bool EVENT_MANAGER_ScheduleEvent(Event* event, uint64_t time) {
     return true;
 }
 
+void EVENT_MANAGER_CancelEvent(Event* event) {
+    if (event != NULL) {
+        event->isScheduled = false;
+    }
+}
+
 void EVENT_MANAGER_Proc(uint64_t currentTime) {
     Event* current = head;
     while (current != NULL) {
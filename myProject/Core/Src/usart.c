@@ -12,12 +12,14 @@
 // UART transmit buffer descriptor
 static RingBuffer USART_RingBuffer_Tx;
 // UART transmit buffer memory pool
-static char RingBufferData_Tx[1024];
+static char RingBufferData_Tx[USART_TX_BUFFER_SIZE];
 
 // UART receive buffer descriptor
 static RingBuffer USART_RingBuffer_Rx;
 // UART receive buffer memory pool
-static char RingBufferData_Rx[1024];
+static char RingBufferData_Rx[USART_RX_BUFFER_SIZE];
+// number of received bytes lost (updated by the interrupt only)
+static volatile uint32_t USART_RxOverruns;
 
 
 bool USART_PutChar(char c) {
@@ -46,6 +48,66 @@ size_t USART_WriteString(const char *string){
 }
 
 
+size_t USART_GetTxLength(void) {
+	__disable_irq();
+	size_t length = RingBuffer_GetLen(&USART_RingBuffer_Tx);
+	__enable_irq();
+
+	return length;
+}
+
+
+bool USART_IsTxIdle(void) {
+	// TC is cleared by every write to DR, so it is only set once the last byte has left the shift register
+	return USART_GetTxLength() == 0 && LL_USART_IsActiveFlag_TC(USART1);
+}
+
+
+/**
+ * Calculates the baud rate generator divider (USARTDIV scaled by the oversampling), 0 if the baud rate
+ * cannot be generated within 1% from the peripheral clock.
+ */
+static uint32_t USART_GetDivider(uint32_t baudRate, uint32_t overSampling) {
+	if ((overSampling != 8 && overSampling != 16) || baudRate == 0) {
+		return 0;
+	}
+
+	LL_RCC_ClocksTypeDef clocks;
+	LL_RCC_GetSystemClocksFreq(&clocks);
+	// for both oversampling modes the BRR resolution is 1/overSampling of USARTDIV
+	uint32_t divider = (clocks.PCLK2_Frequency + baudRate / 2) / baudRate;
+	if (divider < overSampling) {
+		return 0;
+	}
+	uint32_t actualBaudRate = clocks.PCLK2_Frequency / divider;
+	uint32_t error = (actualBaudRate > baudRate) ? (actualBaudRate - baudRate) : (baudRate - actualBaudRate);
+	return (error * 100u <= baudRate) ? divider : 0;
+}
+
+
+bool USART_IsBaudRateSupported(uint32_t baudRate, uint32_t overSampling) {
+	return USART_GetDivider(baudRate, overSampling) != 0;
+}
+
+
+bool USART_SetBaudRate(uint32_t baudRate, uint32_t overSampling) {
+	if (!USART_IsBaudRateSupported(baudRate, overSampling)) {
+		return false;
+	}
+
+	LL_RCC_ClocksTypeDef clocks;
+	LL_RCC_GetSystemClocksFreq(&clocks);
+	uint32_t mode = (overSampling == 8) ? LL_USART_OVERSAMPLING_8 : LL_USART_OVERSAMPLING_16;
+
+	// OVER8 and BRR may only be changed while the USART is disabled
+	LL_USART_Disable(USART1);
+	LL_USART_SetOverSampling(USART1, mode);
+	LL_USART_SetBaudRate(USART1, clocks.PCLK2_Frequency, mode, baudRate);
+	LL_USART_Enable(USART1);
+	return true;
+}
+
+
 bool USART_GetChar(char *c) {
 	__disable_irq();
 	bool success = RingBuffer_GetChar(&USART_RingBuffer_Rx, c);
@@ -65,6 +127,11 @@ size_t USART_ReadData(void *data, size_t maxSize){
 }
 
 
+uint32_t USART_GetRxOverruns(void) {
+	return USART_RxOverruns;
+}
+
+
 void USART1_IRQHandler(void) {
 	if (LL_USART_IsActiveFlag_TXE(USART1) && LL_USART_IsEnabledIT_TXE(USART1)) {
 		char c;
@@ -76,8 +143,14 @@ void USART1_IRQHandler(void) {
 	}
 
 	if (LL_USART_IsActiveFlag_RXNE(USART1)) {
+		// ORE is cleared by reading SR (above) followed by DR
+		if (LL_USART_IsActiveFlag_ORE(USART1)) {
+			USART_RxOverruns++;
+		}
 		char c = LL_USART_ReceiveData8(USART1);
-		RingBuffer_PutChar(&USART_RingBuffer_Rx, c);
+		if (!RingBuffer_PutChar(&USART_RingBuffer_Rx, c)) {
+			USART_RxOverruns++;
+		}
 	}
 }
 
@@ -88,6 +161,7 @@ void USART_Init(void){
 	// initialize ring buffers
 	RingBuffer_Init(&USART_RingBuffer_Tx, RingBufferData_Tx, sizeof(RingBufferData_Tx));
 	RingBuffer_Init(&USART_RingBuffer_Rx, RingBufferData_Rx, sizeof(RingBufferData_Rx));
+	USART_RxOverruns = 0;
 
 	// Peripheral clock enable
 	LL_APB2_GRP1_EnableClock(LL_APB2_GRP1_PERIPH_USART1);
@@ -109,7 +183,7 @@ void USART_Init(void){
 
 	// USART1 peripheral init
 	LL_USART_InitTypeDef USART_InitStruct = {0};
-	USART_InitStruct.BaudRate = 115200;
+	USART_InitStruct.BaudRate = USART_DEFAULT_BAUD_RATE;
 	USART_InitStruct.DataWidth = LL_USART_DATAWIDTH_8B;
 	USART_InitStruct.StopBits = LL_USART_STOPBITS_1;
 	USART_InitStruct.Parity = LL_USART_PARITY_NONE;